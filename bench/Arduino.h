@@ -0,0 +1,60 @@
+/**
+ * @file Arduino.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Minimal Arduino core for the host benchmarks, only what the portable modules use
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef ARDUINO_SHIM_h
+#define ARDUINO_SHIM_h
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include "hal.h"
+
+using std::min;
+using std::max;
+using std::isnan;
+using std::isinf;
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+class String {
+    public:
+        String(const char *value = "") : value(value) {}
+        const char *c_str() const { return value.c_str(); }
+        size_t length() const { return value.size(); }
+
+    private:
+        std::string value;
+};
+
+class Print;
+class Printable {
+    public:
+        virtual ~Printable() {}
+        virtual size_t printTo(Print &p) const = 0;
+};
+
+class Print {
+    public:
+        virtual ~Print() {}
+        virtual size_t write(uint8_t c) = 0;
+        virtual size_t write(const uint8_t *data, size_t len) {
+            size_t written = 0;
+            while (len--) written += write(*data++);
+            return written;
+        }
+};
+
+#endif // ARDUINO_SHIM_h
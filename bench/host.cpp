@@ -0,0 +1,126 @@
+/**
+ * @file host.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Benchmarks of the portable firmware code paths on the build host
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <ArduinoJson.h>
+#include <chrono>
+#include "bench.h"
+#include "climatesensor.h"
+#include "control.h"
+#include "dht22decoder.h"
+#include "pid.h"
+#include "pins.h"
+#include "status.h"
+
+// Same defaults as global.h and main.cpp
+unsigned long runMixerAfter = 24*60*60*1000;
+uint64_t lastMixerRun = 0;
+int8_t noMixerBelowTempC = 10;
+unsigned int targetPwmSpeed = PWM_MAX_DUTY_CYCLE * 0.25;
+bool overrideSpeedPoti = false;
+uint8_t overrideSpeed = 25;
+uint8_t humidityThr = 75;
+uint8_t humiditySpeed = 80;
+
+float currentTemperature = 21.5;
+float currentHumidity = 65.25;
+bool stateMixer = false;
+bool stateDplus = false;
+uint8_t statePoti = 0;
+bool stateDehumidification = false;
+
+bool otaRunning = false;
+bool closedLoop = false;
+uint32_t maxFanRpm = 3000;
+bool fanOpenLoop = false;
+PidController FanPid;
+
+// Inputs are constant, so the benchmark measures the decision logic only
+int digitalRead(uint8_t pin) { return LOW; }
+void digitalWrite(uint8_t pin, uint8_t value) {}
+uint16_t analogRead(uint8_t pin) { return 1024; }
+void ledcWrite(uint8_t channel, uint32_t duty) {}
+unsigned long millis() { return 0; }
+unsigned long micros() { return 0; }
+uint64_t runtime() { return 0; }
+void activateMixer() {}
+bool readClimate(float &temperature, float &humidity) { return false; }
+uint32_t readFanRpm() { return 0; }
+bool isFanStalled() { return true; }
+void setPowerBusy(bool busy) {}
+
+static uint64_t nanoseconds() {
+  using namespace std::chrono;
+  return duration_cast<std::chrono::nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char **argv) {
+  BenchRunner bench("ns", nanoseconds);
+  status_t status = { 1234, false, 3600000, false, true, 42, 80, 21.5, 65.25, false };
+
+  StatusSerializer serializer;
+  bench.run("statusSerialize", 100000, [&]() -> uint32_t {
+    return serializer.serialize(status);
+  });
+
+  // Payload of a live dashboard subscription, see TelemetryClass
+  statusmask_t live = StatusSerializer::fieldMask("stateFanRpm") | StatusSerializer::fieldMask("statePwmSpeed");
+  bench.run("statusSerializeFields", 100000, [&]() -> uint32_t {
+    char json[STATUS_JSON_SIZE];
+    return StatusSerializer::serializeFields(status, live, json, sizeof(json));
+  });
+
+  bench.run("configParse", 100000, []() -> uint32_t {
+    DynamicJsonDocument json(1024);
+    deserializeJson(json, BENCH_SAMPLE_CONFIG);
+    return json["humidityThr"] == 75 ? json.memoryUsage() : 0;
+  });
+
+  bench.run("controlSpeed", 1000000, []() -> uint32_t {
+    controlSpeed();
+    return 0;
+  });
+
+  PidController pid;
+  pid.setTunings(0.5, 0.5, 0, 1);
+  uint32_t now = 0;
+  bench.run("pidUpdate", 1000000, [&]() -> uint32_t {
+    now += 250;
+    return pid.update(0.5, 0.45, 0.25, now) > 0 ? sizeof(float) : 0;
+  });
+
+  // 40 bits of 0x028C 0x0065 with their checksum, as captured by the RMT
+  const uint8_t data[5] = { 0x02, 0x8C, 0x00, 0x65, 0xF3 };
+  dhtpulse_t pulses[2 * DHT22_BITS + 1];
+  size_t count = 0;
+  for (uint8_t bit = 0; bit < DHT22_BITS; bit++) {
+    pulses[count++] = { 0, 50 };
+    pulses[count++] = { 1, (uint16_t)(data[bit / 8] & (0x80 >> (bit % 8)) ? 70 : 26) };
+  }
+  pulses[count++] = { 0, 50 };
+  bench.run("dht22Decode", 1000000, [&]() -> uint32_t {
+    dhtreading_t reading;
+    return dht22Decode(pulses, count, reading) == DHT_OK ? sizeof(reading) : 0;
+  });
+
+  climatesample_t samples[3];
+  for (uint8_t i = 0; i < 3; i++) samples[i] = { 20.f + i, 60.f + i, 0, SENSOR_QUALITY_GOOD };
+  bench.run("climateAggregate", 1000000, [&]() -> uint32_t {
+    float temperature, humidity;
+    return climateAggregate(samples, 3, SENSOR_AGGREGATE_MEAN, 1000, temperature, humidity) ? 8 : 0;
+  });
+
+  static char output[BENCH_JSON_SIZE];
+  bench.toJson(output, sizeof(output), argc > 1 ? argv[1] : "host");
+  puts(output);
+  return 0;
+}
@@ -0,0 +1,75 @@
+/**
+ * @file hal.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief HAL shim of the native environment, connects the control logic to the plant model
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include "control.h"
+#include "pins.h"
+#include "sim.h"
+
+simstate_t Sim;
+
+int digitalRead(uint8_t pin) {
+  if (pin == MIXER_STATUS_PIN) return Sim.plant->isMixerRunning(Sim.now);
+  if (pin == DPLUS_PIN) return Sim.plant->dplus;
+  return LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin == MIXER_START_PIN) {
+    // The relay starts the mixer on the rising edge
+    if (value && !Sim.mixerStartPin) Sim.plant->startMixer(Sim.now);
+    Sim.mixerStartPin = value;
+  } else if (pin == LED_BUILTIN) Sim.led = value;
+}
+
+uint16_t analogRead(uint8_t pin) {
+  return pin == SPEED_PIN ? Sim.plant->poti : 0;
+}
+
+void ledcWrite(uint8_t channel, uint32_t duty) {
+  if (channel != PWM_CHANNEL) return;
+  Sim.plant->duty = (float)duty / PWM_MAX_DUTY_CYCLE;
+  Sim.pwmWrites++;
+}
+
+void sampleTacho() {
+  uint64_t pulses = Sim.tachoConnected ? (uint64_t)(Sim.plant->revolutions * SIM_TACHO_PPR) : 0;
+  uint32_t count = pulses - Sim.lastPulses;
+  Sim.lastPulses = pulses;
+  if (count) Sim.lastPulseTime = Sim.now;
+
+  Sim.windows[Sim.window] = count;
+  Sim.window = (Sim.window + 1) % SIM_TACHO_WINDOWS;
+  uint32_t sum = 0;
+  for (uint32_t window : Sim.windows) sum += window;
+  Sim.rpm = sum * 60000ULL / (SIM_TACHO_PPR * SIM_TACHO_WINDOWS * SIM_TACHO_WINDOW_MS);
+}
+
+uint32_t readFanRpm() {
+  return isFanStalled() ? 0 : Sim.rpm;
+}
+
+bool isFanStalled() {
+  return Sim.now - Sim.lastPulseTime > SIM_TACHO_STALL_MS || Sim.lastPulses == 0;
+}
+
+uint64_t runtime() {
+  return Sim.now + Sim.clockOffset;
+}
+
+unsigned long millis() {
+  return (unsigned long)runtime();
+}
+
+unsigned long micros() {
+  return (unsigned long)(runtime() * 1000);
+}
@@ -0,0 +1,118 @@
+/**
+ * @file plant.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Simple physical model of the toilet, the fan and the mixer
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef PLANT_h
+#define PLANT_h
+
+#include <math.h>
+#include <stdint.h>
+#include <random>
+
+#define PLANT_DAY_MS            (24ULL * 60 * 60 * 1000)
+
+struct plantconfig_t {
+  float meanTemperature = 12;     // °C over the year
+  float seasonAmplitude = 10;     // °C between summer and winter
+  float dayAmplitude = 6;         // °C between day and night
+  float temperatureTau = 3600;    // s until the toilet follows the ambient temperature by 63%
+  float ambientHumidity = 55;     // % of the air drawn in by the fan
+  float compostSource = 2;        // % per hour of moisture from the compost at 20°C
+  float usesPerDay = 5;           // Toilet uses between 7:00 and 23:00
+  float humidityPerUse = 8;       // %
+  float manualMixerChance = 0.3;  // Probability that a use is followed by turning the mixer by hand
+  uint32_t mixerRunMs = 20000;    // A mixer run once started
+  float airExchange = 0.0015;     // 1/s at full fan speed
+  float fanMaxRpm = 2700;         // RPM at 100% duty, below the rated 3000 RPM due to voltage drop and wear
+  float fanStartDuty = 0.1;       // The fan stands still below this duty
+  float fanTau = 1.2;             // s until the fan follows a duty change by 63%
+  float leakage = 0.0001;         // 1/s without the fan
+  float tripChance = 0.3;         // Probability of a 3h drive at 10:00 with the engine (D+) on
+};
+
+class Plant {
+    public:
+        plantconfig_t config;
+        float temperature;
+        float humidity;
+        float duty = 0;                 // Fan PWM duty 0-1
+        float fanRpm = 0;
+        double revolutions = 0;         // Of the fan since the start, read by the tacho shim
+        bool fanBlocked = false;
+        uint16_t poti = 1024;           // ADC value of the speed potentiometer
+        bool dplus = false;
+
+        uint32_t uses = 0;
+        uint32_t manualMixerRuns = 0;
+
+        Plant(uint32_t seed) : rng(seed) {
+            temperature = config.meanTemperature;
+            humidity = config.ambientHumidity;
+        }
+
+        // RPM the fan settles at with the current duty, nonlinear so the feed-forward alone is off
+        float getSteadyRpm() const {
+            if (fanBlocked || duty < config.fanStartDuty) return 0;
+            return config.fanMaxRpm * (duty - config.fanStartDuty) / (1 - config.fanStartDuty);
+        }
+
+        bool isMixerRunning(uint64_t now) const { return now < mixerUntil; }
+        void startMixer(uint64_t now) { if (!isMixerRunning(now)) mixerUntil = now + config.mixerRunMs; }
+
+        // Advance the model from now by dt ms
+        void step(uint64_t now, uint32_t dt) {
+            float seconds = dt / 1000.f;
+            uint64_t day = now / PLANT_DAY_MS;
+            float hour = (now % PLANT_DAY_MS) / 3600000.f;
+
+            if (day != currentDay) {
+                currentDay = day;
+                tripToday = chance(config.tripChance);
+            }
+            dplus = tripToday && hour >= 10 && hour < 13;
+
+            float ambient = config.meanTemperature
+                + config.seasonAmplitude * sinf(2 * M_PI * (day - 110) / 365.f)
+                + config.dayAmplitude * sinf(2 * M_PI * (hour - 9) / 24.f);
+            temperature += (ambient - temperature) * (1 - expf(-seconds / config.temperatureTau));
+
+            if (hour >= 7 && hour < 23 && chance(config.usesPerDay / 16.f / 3600.f * seconds)) {
+                uses++;
+                humidity += config.humidityPerUse;
+                if (chance(config.manualMixerChance)) {
+                    manualMixerRuns++;
+                    startMixer(now);
+                }
+            }
+
+            // First order response of the fan
+            fanRpm += (getSteadyRpm() - fanRpm) * (1 - expf(-seconds / config.fanTau));
+            revolutions += fanRpm / 60.f * seconds;
+
+            // The compost evaporates more when it is warm, the fan exchanges the air with the outside
+            humidity += config.compostSource / 3600.f * seconds * fmaxf(temperature, 0) / 20.f;
+            float exchange = config.leakage + config.airExchange * fanRpm / config.fanMaxRpm;
+            humidity += (config.ambientHumidity - humidity) * (1 - expf(-exchange * seconds));
+            humidity = fminf(fmaxf(humidity, 0), 100);
+        }
+
+    private:
+        std::mt19937 rng;
+        std::uniform_real_distribution<float> uniform{0, 1};
+        uint64_t mixerUntil = 0;
+        uint64_t currentDay = UINT64_MAX;
+        bool tripToday = false;
+
+        bool chance(float p) { return uniform(rng) < p; }
+};
+
+#endif // PLANT_h
@@ -0,0 +1,47 @@
+/**
+ * @file sim.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief State shared by the HAL shim and the simulator
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef SIM_h
+#define SIM_h
+
+#include <stdint.h>
+#include "plant.h"
+
+#define SIM_TACHO_WINDOW_MS     250     // Same windows as TachoClass, without its median filter
+#define SIM_TACHO_WINDOWS       4
+#define SIM_TACHO_PPR           2
+#define SIM_TACHO_STALL_MS      1500
+
+struct simstate_t {
+  Plant *plant = nullptr;
+  uint64_t now = 0;             // Simulated time in ms since the start of the simulation
+  uint64_t clockOffset = 0;     // runtime() = now + clockOffset, changes with every restart
+  bool mixerStartPin = false;
+  bool led = false;
+  uint32_t pwmWrites = 0;
+
+  // Pulse counter of the tacho, sampled every SIM_TACHO_WINDOW_MS
+  bool tachoConnected = true;
+  uint64_t lastPulses = 0;
+  uint64_t lastPulseTime = 0;
+  uint32_t windows[SIM_TACHO_WINDOWS] = {};
+  uint8_t window = 0;
+  uint32_t rpm = 0;
+};
+
+extern simstate_t Sim;
+
+// Count the tacho pulses of the last window, the esp_timer of TachoClass
+void sampleTacho();
+
+#endif // SIM_h
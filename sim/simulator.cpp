@@ -0,0 +1,313 @@
+/**
+ * @file simulator.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Accelerated-time simulation of the control logic against the plant model
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "climatesensor.h"
+#include "control.h"
+#include "pins.h"
+#include "scheduler.h"
+#include "sim.h"
+
+// Same defaults as global.h and main.cpp
+unsigned long runMixerAfter = 24*60*60*1000;
+uint64_t lastMixerRun = 0;
+int8_t noMixerBelowTempC = 10;
+unsigned int targetPwmSpeed = PWM_MAX_DUTY_CYCLE * 0.25;
+bool overrideSpeedPoti = false;
+uint8_t overrideSpeed = 25;
+uint8_t humidityThr = 75;
+uint8_t humiditySpeed = 80;
+
+float currentTemperature = 0;
+float currentHumidity = 0;
+bool stateMixer = false;
+bool stateDplus = false;
+uint8_t statePoti = 0;
+bool stateDehumidification = false;
+
+bool otaRunning = false;
+bool closedLoop = true;
+uint32_t maxFanRpm = 3000;
+bool fanOpenLoop = false;
+PidController FanPid;
+
+#define SIM_MIXER_PULSE_MS      500     // Pulse length of the hardware timer in activateMixer()
+#define SIM_SENSOR_INTERVAL_MS  10000   // DHT_task reads every 10s
+#define SIM_OTA_MS              90000   // Length of the daily OTA update
+#define SIM_SETTLE_LIMIT_MS     15000   // A reachable RPM setpoint has to be met within this time
+#define SIM_SETTLE_BAND         0.05f   // ... within +/- 5% of the setpoint
+
+struct simstats_t {
+  uint32_t autoMixerRuns = 0;
+  uint32_t restarts = 0;
+  uint32_t violations = 0;
+  uint64_t lastMixerActivity = 0;
+  uint64_t dehumidificationMs = 0;
+  uint64_t maxMixerGapMs = 0;
+  double dutySum = 0;
+  uint64_t speedRuns = 0;
+  float maxHumidity = 0;
+  uint32_t otaUpdates = 0;
+  uint32_t setpointSteps = 0;
+  uint32_t worstSettlingMs = 0;
+  float worstOvershoot = 0;
+  uint64_t openLoopMs = 0;
+};
+
+static simstats_t Stats;
+static uint64_t mixerPulseEnd = 0;
+static uint64_t lastSpeedUpdate = 0;
+static uint64_t lastMixerUpdate = 0;
+static uint64_t lastSensorUpdate = 0;
+static uint64_t lastTachoUpdate = 0;
+static climatesample_t dhtSample;
+static unsigned int lastSetpoint = 0;
+static uint64_t setpointSince = 0;
+static bool wasSettled = true;
+
+static void violation(const char *message) {
+  Stats.violations++;
+  if (Stats.violations <= 10) {
+    fprintf(stderr, "[SIM] day %.3f, runtime %llu: %s\n", Sim.now / (double)PLANT_DAY_MS,
+      (unsigned long long)runtime(), message);
+  }
+}
+
+// Shim of the hardware timer driven pulse in global.h
+void activateMixer() {
+  if (otaRunning) violation("mixer started during an OTA");
+  if (currentTemperature <= noMixerBelowTempC) violation("mixer started below noMixerBelowTempC");
+  // The mixer job runs every 250ms, so the deadline is met within one period
+  if (Sim.now - Stats.lastMixerActivity + 250 < runMixerAfter) violation("mixer started before runMixerAfter");
+  Stats.autoMixerRuns++;
+  digitalWrite(MIXER_START_PIN, HIGH);
+  mixerPulseEnd = Sim.now + SIM_MIXER_PULSE_MS;
+}
+
+// The DHT22 is the only sensor, aggregated like SensorsClass::aggregate()
+bool readClimate(float &temperature, float &humidity) {
+  return climateAggregate(&dhtSample, 1, SENSOR_AGGREGATE_MEAN, millis(), temperature, humidity);
+}
+
+void setPowerBusy(bool busy) {}
+
+// DHT_task shim, the sensor reports with 0.1 resolution
+static void sensorJob() {
+  dhtSample.temperature = roundf(Sim.plant->temperature * 10) / 10;
+  dhtSample.humidity = roundf(Sim.plant->humidity * 10) / 10;
+  dhtSample.timestamp = millis();
+  dhtSample.quality = SENSOR_QUALITY_GOOD;
+}
+
+static void mixerJob() {
+  runMixerControl();
+  if (stateMixer) {
+    uint64_t gap = Sim.now - Stats.lastMixerActivity;
+    if (gap > Stats.maxMixerGapMs && Stats.lastMixerActivity) Stats.maxMixerGapMs = gap;
+    Stats.lastMixerActivity = Sim.now;
+  }
+}
+
+// Closed loop: a reachable setpoint is met in time, also after the PID was saturated.
+// Without a tacho signal the fan runs open loop at the requested duty.
+static void checkFan() {
+  if (targetPwmSpeed != lastSetpoint) {
+    lastSetpoint = targetPwmSpeed;
+    setpointSince = Sim.now;
+    Stats.setpointSteps++;
+  }
+  if (!closedLoop) return;
+
+  if (fanOpenLoop) {
+    Stats.openLoopMs += 250;
+    if (Sim.plant->duty > (float)targetPwmSpeed / PWM_MAX_DUTY_CYCLE + 0.01f) violation("fan output wound up without a tacho signal");
+    return;
+  }
+
+  bool settled = FanPid.isSettled();
+  if (settled && !wasSettled) {
+    if (FanPid.getSettlingTimeMs() > Stats.worstSettlingMs) Stats.worstSettlingMs = FanPid.getSettlingTimeMs();
+    if (FanPid.getOvershootPercent() > Stats.worstOvershoot) Stats.worstOvershoot = FanPid.getOvershootPercent();
+  }
+  wasSettled = settled;
+
+  float setpoint = (float)targetPwmSpeed * maxFanRpm / PWM_MAX_DUTY_CYCLE;
+  // A blocked fan is only detected after SIM_TACHO_STALL_MS without pulses
+  bool reachable = !Sim.plant->fanBlocked && setpoint < Sim.plant->config.fanMaxRpm * (1 - SIM_SETTLE_BAND);
+  if (reachable && Sim.now - setpointSince > SIM_SETTLE_LIMIT_MS
+    && fabsf(Sim.plant->fanRpm - setpoint) > setpoint * SIM_SETTLE_BAND) {
+    violation("fan RPM did not settle at the setpoint");
+  }
+}
+
+static void speedJob() {
+  uint32_t writes = Sim.pwmWrites;
+  // Time since the previous deadline, capped for the first run after boot, as in main.cpp
+  runSpeedControl(fminf((runtime() - lastSpeedUpdate) / 1000.f, 1.f));
+  if (otaRunning) {
+    if (Sim.pwmWrites != writes) violation("fan output changed during an OTA");
+    return;
+  }
+
+  if ((stateDplus || stateMixer) && targetPwmSpeed != (unsigned int)PWM_MAX_DUTY_CYCLE) {
+    violation("no full speed with D+ or a running mixer");
+  } else if (!stateDplus && !stateMixer && humidityThr > 0 && currentHumidity >= humidityThr
+    && targetPwmSpeed != (unsigned int)map(humiditySpeed, 0, 100, 0, PWM_MAX_DUTY_CYCLE)) {
+    violation("humidity override not applied");
+  }
+  checkFan();
+  Stats.speedRuns++;
+  Stats.dutySum += Sim.plant->duty;
+  if (stateDehumidification) Stats.dehumidificationMs += 250;
+  if (Sim.plant->humidity > Stats.maxHumidity) Stats.maxHumidity = Sim.plant->humidity;
+}
+
+static uint64_t virtualMs() {
+  return runtime();
+}
+
+static uint64_t realUs() {
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Equivalent of ESP.restart() and setup(), the RTC_DATA_ATTR timing is initialized again
+static void restart() {
+  Stats.restarts++;
+  Sim.clockOffset = 0 - Sim.now;
+  lastSpeedUpdate = lastMixerUpdate = lastSensorUpdate = lastTachoUpdate = 0;
+  lastMixerRun = runtime();
+}
+
+static void usage(const char *name) {
+  fprintf(stderr,
+    "Usage: %s [options]\n"
+    "  --days <n>           Simulated days (default 90)\n"
+    "  --start <ms>         Initial runtime(), e.g. 18446744073623151615 to test the overflow restart\n"
+    "  --seed <n>           Random seed of the plant model (default 1)\n"
+    "  --poti <0-100>       Potentiometer position in %% (default 25)\n"
+    "  --threshold <0-100>  humidityThr (default 75)\n"
+    "  --min-temp <C>       noMixerBelowTempC (default 10)\n"
+    "  --closed-loop <0|1>  Regulate the fan RPM with the PID (default 1)\n"
+    "  --no-tacho <0|1>     Run without a tacho wire (default 0)\n"
+    "  --block-fan <day>    Block the fan from this day on (default never)\n"
+    "  --ota-hour <h>       Daily %u s OTA update at this hour, -1 to disable (default 3)\n"
+    "  --csv <file>         Write a trace of the plant and the control state\n"
+    "  --csv-interval <min> Trace interval in minutes (default 15)\n", name, SIM_OTA_MS / 1000);
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  double days = 90;
+  uint64_t start = 0;
+  uint32_t seed = 1;
+  uint8_t poti = 25;
+  const char *csvFile = nullptr;
+  uint32_t csvInterval = 15;
+  double blockDay = -1;
+  int otaHour = 3;
+
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) usage(argv[0]);
+    const char *value = argv[++i];
+    if (!strcmp(argv[i - 1], "--days")) days = atof(value);
+    else if (!strcmp(argv[i - 1], "--start")) start = strtoull(value, nullptr, 10);
+    else if (!strcmp(argv[i - 1], "--seed")) seed = atoi(value);
+    else if (!strcmp(argv[i - 1], "--poti")) poti = atoi(value);
+    else if (!strcmp(argv[i - 1], "--threshold")) humidityThr = atoi(value);
+    else if (!strcmp(argv[i - 1], "--min-temp")) noMixerBelowTempC = atoi(value);
+    else if (!strcmp(argv[i - 1], "--closed-loop")) closedLoop = atoi(value);
+    else if (!strcmp(argv[i - 1], "--no-tacho")) Sim.tachoConnected = !atoi(value);
+    else if (!strcmp(argv[i - 1], "--block-fan")) blockDay = atof(value);
+    else if (!strcmp(argv[i - 1], "--ota-hour")) otaHour = atoi(value);
+    else if (!strcmp(argv[i - 1], "--csv")) csvFile = value;
+    else if (!strcmp(argv[i - 1], "--csv-interval")) csvInterval = atoi(value);
+    else usage(argv[0]);
+  }
+
+  Plant plant(seed);
+  plant.poti = map(poti, 0, 100, 0, MAX_ADC_VALUE);
+  Sim.plant = &plant;
+  Sim.clockOffset = start;
+  lastMixerRun = runtime();
+
+  FILE *csv = csvFile ? fopen(csvFile, "w") : nullptr;
+  if (csv) fprintf(csv, "time,runtime,temperature,humidity,pwm,duty,rpm,mixer,dplus,dehumidification\n");
+  uint64_t nextCsv = 0;
+
+  // Same jobs and intervals as setup(), the clock is virtual while the job cost is measured in real time
+  SchedulerClass scheduler;
+  scheduler.begin(virtualMs, realUs);
+  scheduler.add("speed", 250, 3, speedJob, &lastSpeedUpdate);
+  scheduler.add("mixer", 250, 2, mixerJob, &lastMixerUpdate);
+  scheduler.add("sensor", SIM_SENSOR_INTERVAL_MS, 1, sensorJob, &lastSensorUpdate);
+  scheduler.add("tacho", SIM_TACHO_WINDOW_MS, 4, sampleTacho, &lastTachoUpdate);
+
+  uint64_t end = days * PLANT_DAY_MS;
+  uint64_t wallStart = realUs();
+  while (Sim.now < end) {
+    // loop()
+    if (runtimeNearOverflow(runtime())) restart();
+    if (blockDay >= 0 && Sim.now >= blockDay * PLANT_DAY_MS) plant.fanBlocked = true;
+    // The jobs pause while the OTA_task writes the update
+    bool ota = otaHour >= 0 && Sim.now % PLANT_DAY_MS - otaHour * 3600000ULL < SIM_OTA_MS;
+    if (ota && !otaRunning) Stats.otaUpdates++;
+    otaRunning = ota;
+    uint32_t idle = scheduler.runDue();
+
+    // Advance to the next deadline, but stop at the end of the mixer pulse like the timer ISR
+    uint64_t advance = idle ? idle : 1;
+    if (Sim.mixerStartPin) {
+      if (mixerPulseEnd <= Sim.now) digitalWrite(MIXER_START_PIN, LOW);
+      else if (mixerPulseEnd - Sim.now < advance) advance = mixerPulseEnd - Sim.now;
+    }
+    plant.step(Sim.now, advance);
+    Sim.now += advance;
+
+    if (csv && Sim.now >= nextCsv) {
+      fprintf(csv, "%llu,%llu,%.2f,%.2f,%u,%.1f,%.0f,%u,%u,%u\n", (unsigned long long)(Sim.now / 1000),
+        (unsigned long long)runtime(), plant.temperature, plant.humidity,
+        (unsigned int)(targetPwmSpeed * 100 / PWM_MAX_DUTY_CYCLE), plant.duty * 100, plant.fanRpm,
+        stateMixer, stateDplus, stateDehumidification);
+      nextCsv = Sim.now + csvInterval * 60000ULL;
+    }
+  }
+  double wall = (realUs() - wallStart) / 1e6;
+  if (csv) fclose(csv);
+
+  printf("Simulated %.1f days in %.2f s (%.0fx real time)\n", days, wall, days * 86400 / wall);
+  printf("Scheduler: %u wakeups, %.0f ns per wakeup\n", scheduler.getWakeups(),
+    wall * 1e9 / scheduler.getWakeups());
+  for (uint8_t i = 0; i < scheduler.getJobCount(); i++) {
+    const schedulerjob_t &job = scheduler.getJob(i);
+    printf("  %-8s %10u runs, avg %u us, worst %u us\n", job.name, job.runs, scheduler.getAverageUs(i), job.worstUs);
+  }
+  printf("Toilet uses:            %u\n", plant.uses);
+  printf("Mixer runs:             %u manual, %u automatic\n", plant.manualMixerRuns, Stats.autoMixerRuns);
+  printf("Longest mixer pause:    %.1f h\n", Stats.maxMixerGapMs / 3600000.0);
+  printf("Dehumidification:       %.1f %% of the time\n", Stats.dehumidificationMs * 100.0 / end);
+  printf("Mean fan duty:          %.1f %%\n", Stats.speedRuns ? Stats.dutySum * 100 / Stats.speedRuns : 0);
+  printf("Max humidity:           %.1f %%\n", Stats.maxHumidity);
+  if (closedLoop) {
+    printf("Fan setpoint steps:     %u, worst settling %u ms, worst overshoot %.1f %%\n", Stats.setpointSteps,
+      Stats.worstSettlingMs, Stats.worstOvershoot);
+    printf("Fan open loop:          %.1f %% of the time\n", Stats.openLoopMs * 100.0 / end);
+  }
+  printf("OTA updates:            %u\n", Stats.otaUpdates);
+  printf("Overflow restarts:      %u\n", Stats.restarts);
+  printf("Violations:             %u\n", Stats.violations);
+  return Stats.violations ? 1 : 0;
+}
@@ -9,6 +9,7 @@
 #include "log.h"
 
 #include "MQTTclient.h"
+#include "format.h"
 
 bool enableMqtt = false;                    // Enable Mqtt, disable to reduce power consumtion, stored in NVS
 
@@ -18,20 +19,56 @@ MQTTclient::MQTTclient() {
 MQTTclient::~MQTTclient() {}
 
 bool MQTTclient::isConnected() {
-  return client.connected();
+  return state == MQTT_STATE_CONNECTED;
 }
 
 bool MQTTclient::isReady() {
-  if (mqttTopic.length() > 0 && isConnected()) return true;
+  if (hasTopic && isConnected()) return true;
   else return false;
 }
 
-void MQTTclient::prepare(String host, uint16_t port, String topic, String user, String pass) {
-  mqttHost = host;
-  mqttPort = port;
-  mqttTopic = topic;
-  mqttUser = user;
-  mqttPass = pass;
+// Hand new broker settings to the MQTT_task, never blocks the caller (e.g. the async_tcp task)
+void MQTTclient::prepare(const char *host, uint16_t port, const char *topic, const char *user, const char *pass) {
+  begin();
+  portENTER_CRITICAL(&settingsLock);
+  strlcpy(pendingSettings.host, host, sizeof(pendingSettings.host));
+  pendingSettings.port = port;
+  strlcpy(pendingSettings.topic, topic, sizeof(pendingSettings.topic));
+  strlcpy(pendingSettings.user, user, sizeof(pendingSettings.user));
+  strlcpy(pendingSettings.pass, pass, sizeof(pendingSettings.pass));
+  settingsPending = true;
+  portEXIT_CRITICAL(&settingsLock);
+  connect();
+}
+
+// Take over the settings from prepare(), only ever executed by the MQTT_task
+void MQTTclient::applySettings() {
+  mqttsettings_t settings;
+  portENTER_CRITICAL(&settingsLock);
+  settings = pendingSettings;
+  settingsPending = false;
+  portEXIT_CRITICAL(&settingsLock);
+
+  // publish() uses the client and the topics from other tasks while holding the lock
+  xSemaphoreTake(lock, portMAX_DELAY);
+  if (state == MQTT_STATE_CONNECTED) client.disconnect();
+  mqttHost = settings.host;
+  mqttPort = settings.port ? settings.port : 1883;
+  mqttTopic = settings.topic;
+  mqttUser = settings.user;
+  mqttPass = settings.pass;
+  hasTopic = mqttTopic.length() > 0;
+
+  // Full topic strings are built once here instead of on every publish
+  for (uint8_t i = 0; i < slotCount; i++) buildTopic(slots[i]);
+  resetSlots();
+
+  IPAddress ip;
+  bool isIp = ip.fromString(mqttHost);
+  if (isIp) client.setServer(ip, mqttPort);
+  else client.setServer(mqttHost.c_str(), mqttPort);
+  xSemaphoreGive(lock);
+  if (state == MQTT_STATE_CONNECTED) state = MQTT_STATE_DISABLED;
 
   // username+password will be used on connect()
   if (mqttUser.length() > 0 && mqttPass.length() > 0) {
@@ -40,79 +77,246 @@ void MQTTclient::prepare(String host, uint16_t port, String topic, String user,
       LOG_INFO_LN(F("[MQTT] Configured broker pass: **hidden**"));
   } else LOG_INFO_LN(F("[MQTT] Configured broker without user and password!"));
 
-  if (mqttPort == 0 || mqttPort < 0 || mqttPort > 65535) mqttPort = 1883;
   LOG_INFO(F("[MQTT] Configured broker port: "));
   LOG_INFO_LN(mqttPort);
 
-  IPAddress ip;
-  if (ip.fromString(mqttHost)) { // this is a valid IP
+  if (isIp) { // this is a valid IP
     LOG_INFO(F("[MQTT] Configured broker IP: "));
     LOG_INFO_LN(ip);
-    client.setServer(ip, mqttPort);
   } else {
     LOG_INFO(F("[MQTT] Configured broker host: "));
     LOG_INFO_LN(mqttHost);
-    client.setServer(mqttHost.c_str(), mqttPort);
   }
 }
 
+// Start the background task that owns the connection to the broker
+void MQTTclient::begin() {
+  if (lock != NULL) return;
+  lock = xSemaphoreCreateMutex();
+  xTaskCreate(&MQTTclient::task, "MQTT_task", 4096, this, 1, NULL);
+}
+
+void MQTTclient::task(void *pvParameter) {
+  MQTTclient *mqtt = (MQTTclient *)pvParameter;
+  while(1) {
+    mqtt->handle();
+    vTaskDelay(MQTT_TASK_INTERVAL_MS / portTICK_RATE_MS);
+  }
+}
+
+// Connection state machine, only ever executed by the MQTT_task
+void MQTTclient::handle() {
+  if (disconnectRequested) {
+    disconnectRequested = false;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    client.disconnect();
+    xSemaphoreGive(lock);
+    state = MQTT_STATE_DISABLED;
+    LOG_INFO_LN(F("[MQTT] Disconnected"));
+    // Stays disconnected until connect() is called again
+    return;
+  }
+  if (settingsPending) applySettings();
+
+  if (!enableMqtt || mqttHost.length() == 0) {
+    state = MQTT_STATE_DISABLED;
+    return;
+  }
+  if (state == MQTT_STATE_DISABLED && !connectRequested) return;
+  if (WiFi.status() != WL_CONNECTED || !(WiFi.getMode() & WIFI_MODE_STA)) {
+    if (state == MQTT_STATE_CONNECTED) LOG_INFO_LN(F("[MQTT] WiFi lost, waiting for reconnect"));
+    state = MQTT_STATE_WAITING;
+    return;
+  }
+
+  if (state == MQTT_STATE_CONNECTED) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool alive = client.loop();
+    xSemaphoreGive(lock);
+    if (!alive) {
+      LOG_INFO_LN(F("[MQTT] Connection lost"));
+      state = MQTT_STATE_WAITING;
+      retryDelay = MQTT_BACKOFF_MIN_MS;
+      lastAttempt = millis();
+    }
+    return;
+  }
+
+  if (connectRequested) {
+    connectRequested = false;
+    retryDelay = 0;
+  }
+  if (state == MQTT_STATE_WAITING && millis() - lastAttempt < retryDelay) return;
+
+  state = MQTT_STATE_CONNECTING;
+  LOG_INFO_LN(F("[MQTT] Connecting to MQTT..."));
+  uint32_t start = millis();
+  xSemaphoreTake(lock, portMAX_DELAY);
+  bool connected = client.connect(
+    mqttClientId.c_str(),
+    mqttUser.length() > 0 ? mqttUser.c_str() : NULL,
+    mqttPass.length() > 0 ? mqttPass.c_str() : NULL,
+    0,
+    0,
+    1,
+    0,
+    1
+  );
+  int result = client.state();
+  xSemaphoreGive(lock);
+  lastAttempt = millis();
+  recordLatency(lastAttempt - start, connected);
+  logState(result);
+
+  if (connected) {
+    resetSlots();
+    retryDelay = 0;
+    state = MQTT_STATE_CONNECTED;
+  } else {
+    // exponential backoff with +-25% jitter, so a fleet does not reconnect in lockstep
+    uint32_t backoff = constrain(retryDelay * 2, MQTT_BACKOFF_MIN_MS, MQTT_BACKOFF_MAX_MS);
+    retryDelay = backoff - backoff / 4 + esp_random() % (backoff / 2 + 1);
+    LOG_INFO_F("[MQTT] Next connection attempt in %u ms\n", retryDelay);
+    state = MQTT_STATE_WAITING;
+  }
+}
+
+void MQTTclient::recordLatency(uint32_t ms, bool success) {
+  static const uint16_t limits[MQTT_LATENCY_BUCKETS - 1] = MQTT_LATENCY_LIMITS;
+  uint8_t bucket = 0;
+  while (bucket < MQTT_LATENCY_BUCKETS - 1 && ms >= limits[bucket]) bucket++;
+  latencyHistogram[bucket]++;
+  lastLatency = ms;
+  connectAttempts++;
+  if (!success) connectFailures++;
+}
+
+// Request a connection attempt as soon as possible, never blocks
 void MQTTclient::connect() {
   if (!enableMqtt) {
     LOG_INFO_LN(F("[MQTT] disabled!"));
   } else {
-    LOG_INFO_LN(F("[MQTT] Connecting to MQTT..."));
-    client.connect(
-      mqttClientId.c_str(),
-      mqttUser.length() > 0 ? mqttUser.c_str() : NULL,
-      mqttPass.length() > 0 ? mqttPass.c_str() : NULL,
-      0,
-      0,
-      1,
-      0,
-      1
-    );
-    sleep(0.5);
-
-    switch (client.state()) {
-    case MQTT_CONNECTION_TIMEOUT:
-      LOG_INFO_LN(F("[MQTT] ... connection time out"));
-      break;
-    case MQTT_CONNECTION_LOST:
-      LOG_INFO_LN(F("[MQTT] ... connection lost"));
-      break;
-    case MQTT_CONNECT_FAILED:
-      LOG_INFO_LN(F("[MQTT] ... connection failed"));
-      break;
-    case MQTT_DISCONNECTED:
-      LOG_INFO_LN(F("[MQTT] ... disconnected"));
-      break;
-    case MQTT_CONNECTED:
-      LOG_INFO_LN(F("[MQTT] ... connected"));
-      break;
-    case MQTT_CONNECT_BAD_PROTOCOL:
-      LOG_INFO_LN(F("[MQTT] ... connection error: bad protocol"));
-      break;
-    case MQTT_CONNECT_BAD_CLIENT_ID:
-      LOG_INFO_LN(F("[MQTT] ... connection error: bad client ID"));
-      break;
-    case MQTT_CONNECT_UNAVAILABLE:
-      LOG_INFO_LN(F("[MQTT] ... connection error: unavailable"));
-      break;
-    case MQTT_CONNECT_BAD_CREDENTIALS:
-      LOG_INFO_LN(F("[MQTT] ... connection error: bad credentials"));
-      break;
-    case MQTT_CONNECT_UNAUTHORIZED:
-      LOG_INFO_LN(F("[MQTT] ... connection error: unauthorized"));
-      break;
-    default:
-      LOG_INFO(F("[MQTT] ... connection error: unknown code "));
-      LOG_INFO_LN(client.state());
-      break;
-    }
+    begin();
+    connectRequested = true;
   }
 }
+
+// Request a disconnect, there is no reconnect until the next connect()
 void MQTTclient::disconnect() {
-  client.disconnect();
+  connectRequested = false;
+  disconnectRequested = true;
+}
+
+void MQTTclient::logState(int result) {
+  switch (result) {
+  case MQTT_CONNECTION_TIMEOUT:
+    LOG_INFO_LN(F("[MQTT] ... connection time out"));
+    break;
+  case MQTT_CONNECTION_LOST:
+    LOG_INFO_LN(F("[MQTT] ... connection lost"));
+    break;
+  case MQTT_CONNECT_FAILED:
+    LOG_INFO_LN(F("[MQTT] ... connection failed"));
+    break;
+  case MQTT_DISCONNECTED:
+    LOG_INFO_LN(F("[MQTT] ... disconnected"));
+    break;
+  case MQTT_CONNECTED:
+    LOG_INFO_LN(F("[MQTT] ... connected"));
+    break;
+  case MQTT_CONNECT_BAD_PROTOCOL:
+    LOG_INFO_LN(F("[MQTT] ... connection error: bad protocol"));
+    break;
+  case MQTT_CONNECT_BAD_CLIENT_ID:
+    LOG_INFO_LN(F("[MQTT] ... connection error: bad client ID"));
+    break;
+  case MQTT_CONNECT_UNAVAILABLE:
+    LOG_INFO_LN(F("[MQTT] ... connection error: unavailable"));
+    break;
+  case MQTT_CONNECT_BAD_CREDENTIALS:
+    LOG_INFO_LN(F("[MQTT] ... connection error: bad credentials"));
+    break;
+  case MQTT_CONNECT_UNAUTHORIZED:
+    LOG_INFO_LN(F("[MQTT] ... connection error: unauthorized"));
+    break;
+  default:
+    LOG_INFO(F("[MQTT] ... connection error: unknown code "));
+    LOG_INFO_LN(result);
+    break;
+  }
+}
+
+bool MQTTclient::addSlot(uint8_t id, const char *suffix, float deadband, uint32_t maxSilence) {
+  if (id >= MQTT_MAX_SLOTS) return false;
+  slots[id].suffix = suffix;
+  slots[id].deadband = deadband;
+  slots[id].maxSilence = maxSilence;
+  slots[id].published = false;
+  buildTopic(slots[id]);
+  if (id >= slotCount) slotCount = id + 1;
+  return true;
+}
+
+void MQTTclient::buildTopic(mqttslot_t &slot) {
+  if (slot.suffix == NULL) slot.topic[0] = '\0';
+  else snprintf(slot.topic, sizeof(slot.topic), "%s/%s", mqttTopic.c_str(), slot.suffix);
+}
+
+// Forget the last published values, all slots get published on the next call
+void MQTTclient::resetSlots() {
+  for (uint8_t i = 0; i < slotCount; i++) slots[i].published = false;
+}
+
+bool MQTTclient::isDue(mqttslot_t &slot, bool changed) {
+  if (slot.suffix == NULL) return false;
+  if (!changed && slot.published && millis() - slot.lastPublish < slot.maxSilence) {
+    suppressed++;
+    return false;
+  }
+  return true;
+}
+
+// Publish a numeric value as retained message, if it changed by more than the slot's deadband
+bool MQTTclient::publishValue(uint8_t id, float value, uint8_t digits) {
+  if (id >= slotCount) return false;
+  mqttslot_t &slot = slots[id];
+
+  float delta = fabsf(value - slot.lastValue);
+  bool changed = slot.deadband > 0 ? delta >= slot.deadband : delta > 0;
+  if (!isDue(slot, changed)) return false;
+
+  char payload[FORMAT_SCRATCH_SIZE];
+  BufferWriter writer(payload, sizeof(payload));
+  writer.printFloat(value, digits);
+  if (!publish(slot.topic, payload)) return false;
+
+  published++;
+  slot.lastValue = value;
+  slot.lastPublish = millis();
+  slot.published = true;
+  return true;
+}
+
+// Publish a preformatted payload as retained message, the caller decides if it changed
+bool MQTTclient::publishPayload(uint8_t id, const char *payload, bool changed) {
+  if (id >= slotCount) return false;
+  mqttslot_t &slot = slots[id];
+  if (!isDue(slot, changed)) return false;
+  if (!publish(slot.topic, payload)) return false;
+
+  published++;
+  slot.lastPublish = millis();
+  slot.published = true;
+  return true;
+}
+
+// Publish a retained message, skipped if the MQTT_task is busy with the connection
+bool MQTTclient::publish(const char *topic, const char *payload) {
+  if (state != MQTT_STATE_CONNECTED || lock == NULL) return false;
+  if (xSemaphoreTake(lock, 0) != pdTRUE) return false;
+  bool result = client.publish(topic, payload, true);
+  xSemaphoreGive(lock);
+  return result;
 }
 
 /*
@@ -171,4 +375,4 @@ void onMqttMessage(char* topic, char* payload, AsyncMqttClientMessageProperties
 17:37:11.225 > 
 17:37:11.225 > Backtrace:0x400f769d:0x3ffd08700x400f7945:0x3ffd0890 0x400f7a22:0x3ffd08c0 0x400dd9f1:0x3ffd08f0 0x401151a9:0x3ffd0e30 
 17:37:11.279 >   #0  0x400f769d:0x3ffd08700 in PubSubClient::connect(char const*, char const*, char const*, char const*, unsigned char, bool, char const*, bool) at .pio/libdeps/esp32dev/PubSubClient/src/PubSubClient.cpp:245
-*/
\ No newline at end of file
+*/
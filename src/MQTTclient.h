@@ -17,8 +17,49 @@
 
 extern bool enableMqtt;
 
+#define MQTT_MAX_SLOTS        12      // Max number of topics in the publish table
+#define MQTT_TOPIC_SIZE       96      // Max length of a full topic string
+#define MQTT_SETTING_SIZE     65      // Buffer size of the broker host, topic, user and password
+#define MQTT_MAX_SILENCE_MS   300000  // Republish unchanged values after 5 minutes
+
+#define MQTT_TASK_INTERVAL_MS 100     // Interval of the MQTT_task state machine
+#define MQTT_BACKOFF_MIN_MS   1000    // First retry delay after a failed connection attempt
+#define MQTT_BACKOFF_MAX_MS   300000  // Upper limit of the exponential backoff
+
+#define MQTT_LATENCY_BUCKETS  8       // Connect latency histogram, upper bucket limits in ms
+#define MQTT_LATENCY_LIMITS   { 50, 100, 250, 500, 1000, 2500, 5000 }
+
+enum mqtt_state_t : uint8_t {
+  MQTT_STATE_DISABLED,
+  MQTT_STATE_WAITING,
+  MQTT_STATE_CONNECTING,
+  MQTT_STATE_CONNECTED
+};
+
+// Broker settings from prepare(), applied by the MQTT_task
+struct mqttsettings_t {
+  char host[MQTT_SETTING_SIZE];
+  uint16_t port;
+  char topic[MQTT_SETTING_SIZE];
+  char user[MQTT_SETTING_SIZE];
+  char pass[MQTT_SETTING_SIZE];
+};
+
+// A topic that is only published if its value changed by more than the deadband,
+// or if it was silent for longer than maxSilence milliseconds.
+struct mqttslot_t {
+  const char *suffix;
+  char topic[MQTT_TOPIC_SIZE];
+  float deadband;
+  uint32_t maxSilence;
+  float lastValue;
+  uint32_t lastPublish;
+  bool published;
+};
+
 class MQTTclient {
     public:
+        // Owned by the MQTT_task, use prepare() to change them
         String mqttTopic;
         String mqttUser;
         String mqttPass;
@@ -31,13 +72,64 @@ class MQTTclient {
 
         bool isConnected();
         bool isReady();
-        void prepare(String host, uint16_t port, String topic, String user, String pass);
+        void begin();
+        void prepare(const char *host, uint16_t port, const char *topic, const char *user, const char *pass);
         void connect();
         void disconnect();
 
+        mqtt_state_t getState() { return state; }
+        uint32_t getConnectAttempts() { return connectAttempts; }
+        uint32_t getConnectFailures() { return connectFailures; }
+        uint32_t getLastLatency() { return lastLatency; }
+        uint32_t getLatencyHistogram(uint8_t bucket) { return bucket < MQTT_LATENCY_BUCKETS ? latencyHistogram[bucket] : 0; }
+
+        bool addSlot(uint8_t id, const char *suffix, float deadband = 0, uint32_t maxSilence = MQTT_MAX_SILENCE_MS);
+        bool publishValue(uint8_t id, float value, uint8_t digits = 0);
+        bool publishPayload(uint8_t id, const char *payload, bool changed);
+        void resetSlots();
+
+        uint32_t getPublished() { return published; }
+        uint32_t getSuppressed() { return suppressed; }
+
+        // One step of the connection state machine, run by the MQTT_task (and the host tests)
+        void handle();
+
         PubSubClient client;
     private:
         WiFiClient ethClient;
+
+        mqttslot_t slots[MQTT_MAX_SLOTS];
+        uint8_t slotCount = 0;
+        uint32_t published = 0;
+        uint32_t suppressed = 0;
+
+        void buildTopic(mqttslot_t &slot);
+        bool isDue(mqttslot_t &slot, bool changed);
+        bool publish(const char *topic, const char *payload);
+
+        // Connection handling, owned by the MQTT_task
+        SemaphoreHandle_t lock = NULL;
+        volatile mqtt_state_t state = MQTT_STATE_DISABLED;
+        volatile bool connectRequested = false;
+        volatile bool disconnectRequested = false;
+        volatile bool hasTopic = false;
+        uint32_t lastAttempt = 0;
+        uint32_t retryDelay = 0;
+
+        uint32_t connectAttempts = 0;
+        uint32_t connectFailures = 0;
+        uint32_t lastLatency = 0;
+        uint32_t latencyHistogram[MQTT_LATENCY_BUCKETS] = {};
+
+        // New settings are copied here, so prepare() never waits for a connection attempt
+        portMUX_TYPE settingsLock = portMUX_INITIALIZER_UNLOCKED;
+        mqttsettings_t pendingSettings;
+        volatile bool settingsPending = false;
+
+        void applySettings();
+        void logState(int result);
+        void recordLatency(uint32_t ms, bool success);
+        static void task(void *pvParameter);
 };
 
 /*
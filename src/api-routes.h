@@ -18,6 +18,7 @@
 #include <LittleFS.h>
 #include <Update.h>
 #include <esp_ota_ops.h>
+#include "jsonbody.h"
 
 extern bool otaRunning;
 extern bool enableWifi;
@@ -33,9 +34,263 @@ uint8_t temprature_sens_read();
 }
 #endif
 uint8_t temprature_sens_read();
+#ifdef BENCHMARK
+size_t runBenchmarks(char *buffer, size_t size);
+#endif
+
+// Content of /api/esp, also used by the benchmark suite. The members of the objects with
+// a fixed layout are counted by hand, the arrays are sized by their maximum length.
+#define API_ESP_INFO_MEMBERS    160
+#define API_ESP_INFO_STRINGS    256   // Copied strings, e.g. the sketch MD5 and the F() values
+#define API_ESP_INFO_SIZE       (JSON_OBJECT_SIZE(API_ESP_INFO_MEMBERS) + API_ESP_INFO_STRINGS \
+  + JSON_ARRAY_SIZE(MQTT_LATENCY_BUCKETS) + MQTT_LATENCY_BUCKETS * JSON_OBJECT_SIZE(2) \
+  + JSON_ARRAY_SIZE(HISTORY_TIERS) + HISTORY_TIERS * JSON_OBJECT_SIZE(2) \
+  + JSON_ARRAY_SIZE(SENSORS_MAX) + SENSORS_MAX * JSON_OBJECT_SIZE(7) \
+  + JSON_ARRAY_SIZE(SCHEDULER_MAX_JOBS) + SCHEDULER_MAX_JOBS * JSON_OBJECT_SIZE(6))
+
+// State and throughput of the update pulled from the manifest, see OtaPull
+void APIOtaPullJson(JsonObject json) {
+  otapullstats_t stats = OtaPull.getStats();
+  json["state"] = stats.state;
+  json["version"] = OtaPull.getCurrentVersion();
+  json["available"] = OtaPull.getAvailableVersion();
+  json["checks"] = stats.checks;
+  json["downloads"] = stats.downloads;
+  json["resumes"] = stats.resumes;
+  json["bytes"] = stats.bytes;
+  json["size"] = stats.size;
+  json["durationMs"] = stats.durationMs;
+  json["kbps"] = stats.kbps;
+  if (stats.error) json["error"] = stats.error;
+}
+
+void APIBuildEspInfo(JsonDocument &json) {
+  JsonObject booting = json.createNestedObject("booting");
+  booting["rebootReason"] = esp_reset_reason();
+  booting["partitionCount"] = esp_ota_get_app_partition_count();
+
+  auto partition = esp_ota_get_boot_partition();
+  JsonObject bootPartition = json.createNestedObject("bootPartition");
+  bootPartition["address"] = partition->address;
+  bootPartition["size"] = partition->size;
+  bootPartition["label"] = partition->label;
+  bootPartition["encrypted"] = partition->encrypted;
+  switch (partition->type) {
+    case ESP_PARTITION_TYPE_APP:  bootPartition["type"] = "app"; break;
+    case ESP_PARTITION_TYPE_DATA: bootPartition["type"] = "data"; break;
+    default: bootPartition["type"] = "any";
+  }
+  bootPartition["subtype"] = partition->subtype;
+
+  partition = esp_ota_get_running_partition();
+  JsonObject runningPartition = json.createNestedObject("runningPartition");
+  runningPartition["address"] = partition->address;
+  runningPartition["size"] = partition->size;
+  runningPartition["label"] = partition->label;
+  runningPartition["encrypted"] = partition->encrypted;
+  switch (partition->type) {
+    case ESP_PARTITION_TYPE_APP:  runningPartition["type"] = "app"; break;
+    case ESP_PARTITION_TYPE_DATA: runningPartition["type"] = "data"; break;
+    default: runningPartition["type"] = "any";
+  }
+  runningPartition["subtype"] = partition->subtype;
+
+  JsonObject build = json.createNestedObject("build");
+  build["date"] = __DATE__;
+  build["time"] = __TIME__;
+
+  JsonObject ram = json.createNestedObject("ram");
+  ram["heapSize"] = ESP.getHeapSize();
+  ram["freeHeap"] = ESP.getFreeHeap();
+  ram["usagePercent"] = (float)ESP.getFreeHeap() / (float)ESP.getHeapSize() * 100.f;
+  ram["minFreeHeap"] = ESP.getMinFreeHeap();
+  ram["maxAllocHeap"] = ESP.getMaxAllocHeap();
+
+  JsonObject spi = json.createNestedObject("spi");
+  spi["psramSize"] = ESP.getPsramSize();
+  spi["freePsram"] = ESP.getFreePsram();
+  spi["minFreePsram"] = ESP.getMinFreePsram();
+  spi["maxAllocPsram"] = ESP.getMaxAllocPsram();
+
+  JsonObject chip = json.createNestedObject("chip");
+  chip["revision"] = ESP.getChipRevision();
+  chip["model"] = ESP.getChipModel();
+  chip["cores"] = ESP.getChipCores();
+  chip["cpuFreqMHz"] = ESP.getCpuFreqMHz();
+  chip["cycleCount"] = ESP.getCycleCount();
+  chip["sdkVersion"] = ESP.getSdkVersion();
+  chip["efuseMac"] = ESP.getEfuseMac();
+  chip["temperature"] = (temprature_sens_read() - 32) / 1.8;
+
+  JsonObject flash = json.createNestedObject("flash");
+  flash["flashChipSize"] = ESP.getFlashChipSize();
+  flash["flashChipRealSize"] = spi_flash_get_chip_size();
+  flash["flashChipSpeedMHz"] = ESP.getFlashChipSpeed() / 1000000;
+  flash["flashChipMode"] = ESP.getFlashChipMode();
+  flash["sdkVersion"] = ESP.getFlashChipSize();
+
+  JsonObject sketch = json.createNestedObject("sketch");
+  sketch["size"] = ESP.getSketchSize();
+  sketch["maxSize"] = ESP.getFreeSketchSpace();
+  sketch["usagePercent"] = (float)ESP.getSketchSize() / (float)ESP.getFreeSketchSpace() * 100.f;
+  sketch["md5"] = ESP.getSketchMD5();
+
+  JsonObject logging = json.createNestedObject("log");
+  logging["written"] = LogSink.getWritten();
+  logging["dropped"] = LogSink.getDropped();
+
+  JsonObject webserial = json.createNestedObject("webserial");
+  webserial["framesPerSecond"] = WebSerial.getFramesPerSecond();
+  webserial["bytesPerSecond"] = WebSerial.getBytesPerSecond();
+  webserial["framesSent"] = WebSerial.getFramesSent();
+  webserial["bytesSent"] = WebSerial.getBytesSent();
+  webserial["framesSkipped"] = WebSerial.getFramesSkipped();
+  webserial["clientsDropped"] = WebSerial.getClientsDropped();
+
+  JsonObject mqtt = json.createNestedObject("mqtt");
+  mqtt["published"] = Mqtt.getPublished();
+  mqtt["suppressed"] = Mqtt.getSuppressed();
+  mqtt["state"] = Mqtt.getState();
+  mqtt["connectAttempts"] = Mqtt.getConnectAttempts();
+  mqtt["connectFailures"] = Mqtt.getConnectFailures();
+  mqtt["lastConnectLatencyMs"] = Mqtt.getLastLatency();
+  const uint16_t latencyLimits[] = MQTT_LATENCY_LIMITS;
+  JsonArray latency = mqtt.createNestedArray("connectLatencyHistogram");
+  for (uint8_t i = 0; i < MQTT_LATENCY_BUCKETS; i++) {
+    JsonObject bucket = latency.createNestedObject();
+    if (i < MQTT_LATENCY_BUCKETS - 1) bucket["leMs"] = latencyLimits[i];
+    bucket["count"] = Mqtt.getLatencyHistogram(i);
+  }
+
+  JsonObject controller = json.createNestedObject("fanController");
+  controller["closedLoop"] = closedLoop;
+  controller["setpointRpm"] = targetPwmSpeed * maxFanRpm / PWM_MAX_DUTY_CYCLE;
+  controller["measuredRpm"] = Tacho.getRpm();
+  controller["outputPercent"] = FanPid.getOutput() * 100.f;
+  controller["settled"] = FanPid.isSettled();
+  controller["settlingTimeMs"] = FanPid.getSettlingTimeMs();
+  controller["overshootPercent"] = FanPid.getOvershootPercent();
+
+  JsonObject history = json.createNestedObject("history");
+  history["memoryBytes"] = History.getMemoryUsage();
+  JsonArray historyTiers = history.createNestedArray("tiers");
+  for (uint8_t i = 0; i < HISTORY_TIERS; i++) {
+    JsonObject tier = historyTiers.createNestedObject();
+    tier["resolution"] = History.getResolution(i);
+    tier["samples"] = History.getCount(i);
+  }
+  history["logSegments"] = HistoryLog.getSegments();
+  history["logRecords"] = HistoryLog.getRecords();
+  history["logDropped"] = HistoryLog.getDropped();
+  history["logFlashWrites"] = HistoryLog.getFlashWrites();
+
+  JsonObject power = json.createNestedObject("power");
+  power["mode"] = Power.getMode();
+  power["state"] = Power.getState();
+  power["cpuFreqMHz"] = getCpuFrequencyMhz();
+  power["dynamicClock"] = Power.isDfsEnabled();
+  power["lightSleep"] = Power.isLightSleepSupported();
+  power["transitions"] = Power.getTransitions();
+  // Time in each policy state, not the time the chip actually slept, see PowerClass
+  JsonObject policy = power.createNestedObject("policyMs");
+  policy["active"] = Power.getPolicyMs(POWER_STATE_ACTIVE);
+  policy["modemSleep"] = Power.getPolicyMs(POWER_STATE_MODEM_SLEEP);
+  policy["lightSleep"] = Power.getPolicyMs(POWER_STATE_LIGHT_SLEEP);
+
+  uint32_t now = millis();
+  JsonArray sensors = json.createNestedArray("sensors");
+  for (uint8_t i = 0; i < Sensors.getCount(); i++) {
+    climatesample_t sample = Sensors.getSample(i);
+    JsonObject sensor = sensors.createNestedObject();
+    sensor["name"] = Sensors.getName(i);
+    sensor["temperature"] = sample.temperature;
+    sensor["humidity"] = sample.humidity;
+    sensor["quality"] = sample.quality;
+    sensor["ageMs"] = sample.quality == SENSOR_QUALITY_NONE ? 0 : sample.getAgeMs(now);
+    sensor["stale"] = sample.isStale(now);
+    sensor["errors"] = Sensors.getErrors(i);
+  }
+
+  JsonObject dht22 = json.createNestedObject("dht22");
+  dht22["reads"] = Dht.getReads();
+  dht22["retries"] = Dht.getRetries();
+  dht22["timeouts"] = Dht.getTimeouts();
+  dht22["pulseErrors"] = Dht.getPulseErrors();
+  dht22["crcErrors"] = Dht.getCrcErrors();
+
+  JsonObject scheduler = json.createNestedObject("scheduler");
+  scheduler["wakeups"] = Scheduler.getWakeups();
+  JsonArray jobs = scheduler.createNestedArray("jobs");
+  for (uint8_t i = 0; i < Scheduler.getJobCount(); i++) {
+    const schedulerjob_t &job = Scheduler.getJob(i);
+    JsonObject entry = jobs.createNestedObject();
+    entry["name"] = job.name;
+    entry["periodMs"] = job.period;
+    entry["runs"] = job.runs;
+    entry["avgUs"] = Scheduler.getAverageUs(i);
+    entry["worstUs"] = job.worstUs;
+    entry["maxLateMs"] = job.maxLateMs;
+  }
+
+  JsonObject ota = json.createNestedObject("ota");
+  otaprogress_t progress = OtaWriter.getProgress();
+  ota["state"] = progress.state;
+  ota["bytes"] = progress.bytes;
+  ota["kbps"] = progress.kbps;
+  ota["stallMs"] = progress.stallMs;
+  ota["sha256"] = OtaWriter.getDigest();
+  ota["format"] = OtaWriter.getFormat();
+  ota["imageBytes"] = OtaWriter.getImageBytes();
+  if (progress.error) ota["error"] = progress.error;
+
+  APIOtaPullJson(json.createNestedObject("pull"));
+
+  JsonObject telemetry = json.createNestedObject("telemetry");
+  telemetrystats_t stats = Telemetry.getStats();
+  telemetry["clients"] = stats.clients;
+  telemetry["frames"] = stats.frames;
+  telemetry["messages"] = stats.messages;
+  telemetry["skipped"] = stats.skipped;
+  telemetry["dropped"] = stats.dropped;
+  telemetry["rejected"] = stats.rejected;
+  telemetry["starved"] = stats.starved;
+
+  JsonObject config = json.createNestedObject("config");
+  config["source"] = Config.getSource() == CONFIG_SOURCE_MIGRATED ? F("migrated") : Config.getSource() == CONFIG_SOURCE_BLOB ? F("blob") : F("defaults");
+  config["writes"] = Config.getWrites();
+  config["skippedWrites"] = Config.getSkippedWrites();
+
+  if (Assets) {
+    JsonObject assets = json.createNestedObject("assets");
+    assets["source"] = Assets->isBundled() ? F("bundle") : F("littlefs");
+    assets["files"] = Assets->getEntryCount();
+    assets["requests"] = Assets->getRequests();
+    assets["notModified"] = Assets->getNotModified();
+    assets["gzipped"] = Assets->getGzipped();
+  }
+
+  JsonObject fs = json.createNestedObject("filesystem");
+  fs["type"] = F("LittleFS");
+  fs["totalBytes"] = LittleFS.totalBytes();
+  fs["usedBytes"] = LittleFS.usedBytes();
+  fs["usagePercent"] = (float)LittleFS.usedBytes() / (float)LittleFS.totalBytes() * 100.f;
+}
+
+// {"state":1,"bytes":..,"total":..,"kbps":..,"stallMs":..,"error":".."}
+size_t APIOtaProgressJson(char *buffer, size_t size, const otaprogress_t &progress) {
+  return snprintf(buffer, size, "{\"state\":%u,\"bytes\":%u,\"total\":%u,\"kbps\":%u,\"stallMs\":%u,\"error\":\"%s\"}",
+    progress.state, progress.bytes, progress.total, progress.kbps, progress.stallMs, progress.error ? progress.error : "");
+}
+
+void APISendOtaError(AsyncWebServerRequest *request, const char *message) {
+  char output[160];
+  snprintf(output, sizeof(output), "{\"message\":\"%s\",\"error\":\"%s\"}", message, OtaWriter.getError() ? OtaWriter.getError() : "");
+  request->send(500, "application/json", output);
+}
 
 void APIRegisterRoutes() {
   webServer.on("/api/firmware/info", HTTP_GET, [&](AsyncWebServerRequest *request) {
+    PERF_SCOPE(PERF_PROBE_WEB);
     auto data = esp_ota_get_running_partition();
     String output;
     DynamicJsonDocument doc(256);
@@ -55,73 +310,117 @@ void APIRegisterRoutes() {
     [&](AsyncWebServerRequest *request) { },
     [&](AsyncWebServerRequest *request, const String& filename, size_t index, uint8_t *data, size_t len, bool final) {
 
-    String otaPassword = "";
-    if (preferences.begin(NVS_NAMESPACE, true)) {
-      otaPassword = preferences.getString("otaPassword");
-      preferences.end();
-
-      if (otaPassword.length()) {
-        if(!request->authenticate("ota", otaPassword.c_str())) {
+    // Authenticated with the first chunk, the chunks of rejected or failed requests are ignored
+    if (!index) {
+      const char *otaPassword = Config.get().otaPassword;
+      if (otaPassword[0]) {
+        if(!request->authenticate("ota", otaPassword)) {
           return request->send(401, "application/json", "{\"message\":\"Invalid OTA password provided!\"}");
         }
       } else LOG_INFO_LN(F("[OTA] No password configured, no authentication requested!"));
-    } else LOG_INFO_LN(F("[OTA] Unable to load password from NVS."));
 
-    if (!index) {
-      otaRunning = true;
+      if (OtaWriter.isRunning()) {
+        return request->send(409, "application/json", "{\"message\":\"Another update is running!\"}");
+      }
+
       LOG_INFO(F("[OTA] Begin firmware update with filename: "));
       LOG_INFO_LN(filename);
-      // if filename includes spiffs|littlefs, update the spiffs|littlefs partition
-      int cmd = (filename.indexOf("spiffs") > -1 || filename.indexOf("littlefs") > -1) ? U_SPIFFS : U_FLASH;
-      if (!Update.begin(UPDATE_SIZE_UNKNOWN, cmd)) {
-        LOG_INFO(F("[OTA] Error: "));
-        Update.printError(Serial);
-        request->send(500, "application/json", "{\"message\":\"Unable to begin firmware update!\"}");
+      // if filename includes assets, update the UI bundle, if it includes spiffs|littlefs, update the spiffs|littlefs partition
+      int cmd = U_FLASH;
+      if (filename.indexOf("assets") > -1) cmd = OTA_COMMAND_ASSETS;
+      else if (filename.indexOf("spiffs") > -1 || filename.indexOf("littlefs") > -1) cmd = U_SPIFFS;
+      String sha256 = request->hasHeader("X-Update-SHA256") ? request->header("X-Update-SHA256") : "";
+      otaRunning = true;
+      if (!OtaWriter.start(cmd, request, request->contentLength(), sha256.c_str())) {
         otaRunning = false;
+        return APISendOtaError(request, "Unable to begin firmware update!");
       }
+      request->onDisconnect([request]() {
+        if (OtaWriter.isOwnedBy(request)) {
+          OtaWriter.abort();
+          otaRunning = false;
+        }
+      });
     }
+    if (!OtaWriter.isOwnedBy(request)) return;
 
-    if (Update.write(data, len) != len) {
-      LOG_INFO(F("[OTA] Error: "));
-      Update.printError(Serial);
-      request->send(500, "application/json", "{\"message\":\"Unable to write firmware update data!\"}");
+    // Copied into the current buffer, the flash is written by the OTA_task meanwhile
+    if (!OtaWriter.write(data, len)) {
+      OtaWriter.abort();
       otaRunning = false;
+      return APISendOtaError(request, "Unable to write firmware update data!");
     }
 
     if (final) {
-      if (!Update.end(true)) {
-        String output;
-        DynamicJsonDocument doc(32);
-        doc["message"] = "Update error";
-        doc["error"] = Update.errorString();
-        serializeJson(doc, output);
-        request->send(500, "application/json", output);
-
-        LOG_INFO_LN("[OTA] Error when calling calling Update.end().");
-        Update.printError(Serial);
+      if (!OtaWriter.finish()) {
         otaRunning = false;
+        return APISendOtaError(request, "Update error");
       } else {
-        LOG_INFO_LN("[OTA] Firmware update successful.");
-        request->send(200, "application/json", "{\"message\":\"Please wait while the device reboots!\"}");
+        otaprogress_t progress = OtaWriter.getProgress();
+        LOG_INFO_F("[OTA] Firmware update successful, %u bytes (%u decoded) at %u KiB/s, SHA-256 %s\n",
+          progress.bytes, OtaWriter.getImageBytes(), progress.kbps, OtaWriter.getDigest());
+        char output[224];
+        snprintf(output, sizeof(output), "{\"message\":\"Please wait while the device reboots!\",\"bytes\":%u,\"imageBytes\":%u,\"kbps\":%u,\"sha256\":\"%s\"}",
+          progress.bytes, OtaWriter.getImageBytes(), progress.kbps, OtaWriter.getDigest());
+        request->send(200, "application/json", output);
         yield();
         delay(250);
 
         LOG_INFO_LN("[OTA] Update complete, rebooting now!");
+        HistoryLog.flush();
+        LogSink.flush();
         Serial.flush();
         ESP.restart();
       }
     }
   });
 
+  webServer.on("/api/update/pull", HTTP_GET, [&](AsyncWebServerRequest *request) {
+    PERF_SCOPE(PERF_PROBE_WEB);
+    String output;
+    DynamicJsonDocument json(512);
+    APIOtaPullJson(json.to<JsonObject>());
+    serializeJson(json, output);
+    request->send(200, "application/json", output);
+  });
+
+  // Check the manifest now, ?install=1 also installs a new version
+  webServer.on("/api/update/pull", HTTP_POST, [&](AsyncWebServerRequest *request) {
+    PERF_SCOPE(PERF_PROBE_WEB);
+    const char *otaPassword = Config.get().otaPassword;
+    if (otaPassword[0] && !request->authenticate("ota", otaPassword)) {
+      return request->send(401, "application/json", "{\"message\":\"Invalid OTA password provided!\"}");
+    }
+    bool install = request->hasParam("install") && request->getParam("install")->value() == "1";
+    if (!OtaPull.check(install)) {
+      return request->send(409, "application/json", "{\"message\":\"A check or update is already running!\"}");
+    }
+    request->send(202, "application/json", "{\"message\":\"Checking for updates\"}");
+  });
+
+  // Progress of the flash writes, pushed from the OTA_task
+  OtaWriter.onProgress([](const otaprogress_t &progress) {
+    char payload[160];
+    APIOtaProgressJson(payload, sizeof(payload), progress);
+    events.send(payload, "ota", millis());
+  });
+
   events.onConnect([&](AsyncEventSourceClient *client){
     if(client->lastId()){
       LOG_INFO_F("Client reconnected! Last message ID that it got is: %u\n", client->lastId());
     }
     client->send("connected", NULL, millis(), 1000);
+    // New clients need the complete state, not only the changes
+    StatusReport.requestFullSnapshot();
   });
   webServer.addHandler(&events);
 
+  // Status with per-client fields and rate, the SSE status above stays for existing clients
+  Telemetry.begin();
+  webServer.addHandler(&Telemetry.getSocket());
+
   webServer.on("/api/mixer/start", HTTP_POST, [&](AsyncWebServerRequest *request) {
+    PERF_SCOPE(PERF_PROBE_WEB);
     AsyncResponseStream *response = request->beginResponseStream("application/json");
 
     activateMixer();
@@ -131,6 +430,7 @@ void APIRegisterRoutes() {
   });
 
   webServer.on("/api/reset", HTTP_POST, [&](AsyncWebServerRequest *request) {
+    PERF_SCOPE(PERF_PROBE_WEB);
     AsyncResponseStream *response = request->beginResponseStream("application/json");
     request->send(200, "application/json", "{\"message\":\"Resetting the sensor!\"}");
     request->send(response);
@@ -139,107 +439,158 @@ void APIRegisterRoutes() {
     ESP.restart();
   });
 
-  webServer.on("/api/config", HTTP_POST, [&](AsyncWebServerRequest * request){}, NULL,
-    [&](AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total) {
-
-    DynamicJsonDocument jsonBuffer(1024);
-    deserializeJson(jsonBuffer, (const char*)data);
-
-    if (preferences.begin(NVS_NAMESPACE)) {
-      String hostname = jsonBuffer["hostname"].as<String>();
-      if (!hostname || hostname.length() < 3 || hostname.length() > 32) {
-        // TODO: Add better checks according to RFC hostnames
-        request->send(422, "application/json", "{\"message\":\"Invalid hostname!\"}");
-        return;
-      } else {
-        preferences.putString("hostName", hostname);
-      }
-
-      if (preferences.putBool("enableWifi", jsonBuffer["enablewifi"].as<boolean>())) {
-        enableWifi = jsonBuffer["enablewifi"].as<boolean>();
-      }
-      if (preferences.putBool("enableSoftAp", jsonBuffer["enablesoftap"].as<boolean>())) {
-        WifiManager.fallbackToSoftAp(jsonBuffer["enablesoftap"].as<boolean>());
-      }
-
-      preferences.putString("otaPassword", jsonBuffer["otapassword"].as<String>());
-      ArduinoOTA.setPassword(jsonBuffer["otapassword"].as<String>().c_str());
-      
-      preferences.putULong("runMixerAfter", jsonBuffer["runMixerAfterMinutes"].as<unsigned long>()*60*1000);
-      runMixerAfter = jsonBuffer["runMixerAfterMinutes"].as<unsigned long>()*60*1000;
-
-      preferences.putInt("noMixerBelow", jsonBuffer["noMixerBelowTempC"].as<int8_t>());
-      noMixerBelowTempC = jsonBuffer["noMixerBelowTempC"].as<int8_t>();
-
-      preferences.putUInt("overrideSpeed", jsonBuffer["overrideSpeed"].as<uint8_t>());
-      overrideSpeed = jsonBuffer["overrideSpeed"].as<uint8_t>();
-
-      if (preferences.putBool("overridePoti", jsonBuffer["overrideSpeedPoti"].as<boolean>())) {
-        overrideSpeedPoti = jsonBuffer["overrideSpeedPoti"].as<boolean>();
-      }
-
-      preferences.putUInt("humidityThr", jsonBuffer["humidityThr"].as<uint8_t>());
-      humidityThr = jsonBuffer["humidityThr"].as<uint8_t>();
-
-      preferences.putUInt("humiditySpeed", jsonBuffer["humiditySpeed"].as<uint8_t>());
-      humiditySpeed = jsonBuffer["humiditySpeed"].as<uint8_t>();
-
-      // MQTT Settings
-      preferences.putUInt("mqttPort", jsonBuffer["mqttport"].as<uint16_t>());
-      preferences.putString("mqttHost", jsonBuffer["mqtthost"].as<String>());
-      preferences.putString("mqttTopic", jsonBuffer["mqtttopic"].as<String>());
-      preferences.putString("mqttUser", jsonBuffer["mqttuser"].as<String>());
-      preferences.putString("mqttPass", jsonBuffer["mqttpass"].as<String>());
-      if (preferences.putBool("enableMqtt", jsonBuffer["enablemqtt"].as<boolean>())) {
-        if (enableMqtt) Mqtt.disconnect();
-        enableMqtt = jsonBuffer["enablemqtt"].as<boolean>();
-        if (enableMqtt) {
-          Mqtt.prepare(
-            jsonBuffer["mqtthost"].as<String>(),
-            jsonBuffer["mqttport"].as<uint16_t>(),
-            jsonBuffer["mqtttopic"].as<String>(),
-            jsonBuffer["mqttuser"].as<String>(),
-            jsonBuffer["mqttpass"].as<String>()
-          );
-          Mqtt.connect();
-        }
+  webServer.on("/api/config", HTTP_POST, jsonBodyRequest, NULL,
+    jsonBodyHandler([&](AsyncWebServerRequest * request, JsonDocument &jsonBuffer) {
+    PERF_SCOPE(PERF_PROBE_WEB);
+
+    // Validated on a copy, the running config and NVS only change if all values are fine
+    config_t config = Config.get();
+    String hostname = jsonBuffer["hostname"] | config.hostName;
+    if (hostname.length() < 3 || !ConfigClass::copyString(config.hostName, hostname.c_str())) {
+      // TODO: Add better checks according to RFC hostnames
+      request->send(422, "application/json", "{\"message\":\"Invalid hostname!\"}");
+      return;
+    }
+    if (!ConfigClass::copyString(config.otaPassword, jsonBuffer["otapassword"] | config.otaPassword)
+      || !ConfigClass::copyString(config.mqttHost, jsonBuffer["mqtthost"] | config.mqttHost)
+      || !ConfigClass::copyString(config.mqttTopic, jsonBuffer["mqtttopic"] | config.mqttTopic)
+      || !ConfigClass::copyString(config.mqttUser, jsonBuffer["mqttuser"] | config.mqttUser)
+      || !ConfigClass::copyString(config.mqttPass, jsonBuffer["mqttpass"] | config.mqttPass)) {
+      request->send(422, "application/json", "{\"message\":\"Text values are limited to 32 characters!\"}");
+      return;
+    }
+    // Plain HTTP only, the manifest is meant to be served in the local network
+    const char *updateUrl = jsonBuffer["updateUrl"] | config.updateUrl;
+    if ((updateUrl[0] && strncmp(updateUrl, "http://", 7)) || !ConfigClass::copyString(config.updateUrl, updateUrl, CONFIG_URL_SIZE)) {
+      request->send(422, "application/json", "{\"message\":\"The update URL must start with http:// and is limited to 128 characters!\"}");
+      return;
+    }
+    config.updateInterval = jsonBuffer["updateInterval"] | config.updateInterval;
+    config.autoUpdate = jsonBuffer["autoUpdate"] | config.autoUpdate;
+
+    config.enableWifi = jsonBuffer["enablewifi"] | config.enableWifi;
+    config.enableSoftAp = jsonBuffer["enablesoftap"] | config.enableSoftAp;
+    // The UI sends the minutes as a string
+    if (jsonBuffer.containsKey("runMixerAfterMinutes")) {
+      config.runMixerAfter = jsonBuffer["runMixerAfterMinutes"].as<uint32_t>() * 60 * 1000;
+    }
+    config.noMixerBelowTempC = jsonBuffer["noMixerBelowTempC"] | config.noMixerBelowTempC;
+    config.overrideSpeedPoti = jsonBuffer["overrideSpeedPoti"] | config.overrideSpeedPoti;
+    config.overrideSpeed = jsonBuffer["overrideSpeed"] | config.overrideSpeed;
+    config.humidityThr = jsonBuffer["humidityThr"] | config.humidityThr;
+    config.humiditySpeed = jsonBuffer["humiditySpeed"] | config.humiditySpeed;
+    config.statusDelta = jsonBuffer["statusDelta"] | config.statusDelta;
+    config.tachoPpr = jsonBuffer["tachoPulsesPerRev"] | config.tachoPpr;
+    config.closedLoop = jsonBuffer["closedLoop"] | config.closedLoop;
+    config.maxFanRpm = max(jsonBuffer["maxFanRpm"] | config.maxFanRpm, (uint32_t)1);
+    config.pidKp = jsonBuffer["pidKp"] | config.pidKp;
+    config.pidKi = jsonBuffer["pidKi"] | config.pidKi;
+    config.pidKd = jsonBuffer["pidKd"] | config.pidKd;
+    uint8_t powerMode = jsonBuffer["powerMode"] | config.powerMode;
+    if (powerMode <= POWER_MODE_LOWPOWER) config.powerMode = powerMode;
+    uint8_t sensorAggregate = jsonBuffer["sensorAggregate"] | config.sensorAggregate;
+    if (sensorAggregate < SENSOR_AGGREGATE_MODES) config.sensorAggregate = sensorAggregate;
+    config.perfEnabled = jsonBuffer["perfEnabled"] | config.perfEnabled;
+    config.perfMqtt = jsonBuffer["perfMqtt"] | config.perfMqtt;
+    config.mqttPort = jsonBuffer["mqttport"] | config.mqttPort;
+    config.enableMqtt = jsonBuffer["enablemqtt"] | config.enableMqtt;
+
+    // Apply the changes to the running system
+    const config_t &previous = Config.get();
+    enableWifi = config.enableWifi;
+    if (config.enableSoftAp != previous.enableSoftAp) WifiManager.fallbackToSoftAp(config.enableSoftAp);
+    if (strcmp(config.otaPassword, previous.otaPassword)) ArduinoOTA.setPassword(config.otaPassword);
+
+    runMixerAfter = config.runMixerAfter;
+    noMixerBelowTempC = config.noMixerBelowTempC;
+    overrideSpeedPoti = config.overrideSpeedPoti;
+    overrideSpeed = config.overrideSpeed;
+    humidityThr = config.humidityThr;
+    humiditySpeed = config.humiditySpeed;
+    StatusReport.setDeltaMode(config.statusDelta);
+    Tacho.setPulsesPerRevolution(config.tachoPpr);
+
+    closedLoop = config.closedLoop;
+    maxFanRpm = config.maxFanRpm;
+    if (config.pidKp != previous.pidKp || config.pidKi != previous.pidKi || config.pidKd != previous.pidKd) {
+      FanPid.setTunings(config.pidKp, config.pidKi, config.pidKd);
+      FanPid.reset();
+    }
+    if (config.powerMode != previous.powerMode) Power.setMode((power_mode_t)config.powerMode);
+    Sensors.setAggregate((sensor_aggregate_t)config.sensorAggregate);
+    Perf.setEnabled(config.perfEnabled);
+    perfMqtt = config.perfMqtt;
+
+    // Reconnect only if the MQTT settings changed
+    bool mqttChanged = config.enableMqtt != previous.enableMqtt || config.mqttPort != previous.mqttPort
+      || strcmp(config.mqttHost, previous.mqttHost) || strcmp(config.mqttTopic, previous.mqttTopic)
+      || strcmp(config.mqttUser, previous.mqttUser) || strcmp(config.mqttPass, previous.mqttPass);
+    if (mqttChanged) {
+      if (enableMqtt) Mqtt.disconnect();
+      enableMqtt = config.enableMqtt;
+      if (enableMqtt) {
+        Mqtt.prepare(config.mqttHost, config.mqttPort, config.mqttTopic, config.mqttUser, config.mqttPass);
+        Mqtt.connect();
       }
     }
-    preferences.end();
+    if (config.updateInterval != previous.updateInterval || config.autoUpdate != previous.autoUpdate
+      || strcmp(config.updateUrl, previous.updateUrl)) OtaPull.configure(config);
+
+    // Unchanged settings are not written again
+    Config.edit() = config;
+    if (!Config.save()) {
+      request->send(500, "application/json", "{\"message\":\"Unable to store the settings in NVS!\"}");
+      return;
+    }
     
     request->send(200, "application/json", "{\"message\":\"New hostname stored in NVS, reboot required!\"}");
-  });
+  }, CONFIG_BODY_SIZE));
 
   webServer.on("/api/config", HTTP_GET, [&](AsyncWebServerRequest *request) {
+    PERF_SCOPE(PERF_PROBE_WEB);
     if (request->contentType() == "application/json") {
       String output;
       DynamicJsonDocument doc(1024);
 
-      if (preferences.begin(NVS_NAMESPACE, true)) {
-        doc["hostname"] = hostName;
-        doc["enablewifi"] = enableWifi;
-        doc["enablesoftap"] = WifiManager.getFallbackState();
-
-        doc["otapassword"] = preferences.getString("otaPassword");
-
-        doc["runMixerAfterMinutes"] = preferences.getULong("runMixerAfter", runMixerAfter) / 60 / 1000 ;
-        doc["noMixerBelowTempC"] = preferences.getInt("noMixerBelow", noMixerBelowTempC);
-
-        doc["overrideSpeedPoti"] = preferences.getBool("overrideSpeedPoti", overrideSpeedPoti);
-        doc["overrideSpeed"] = preferences.getUInt("overrideSpeed", overrideSpeed);
-        
-        doc["humidityThr"] = preferences.getUInt("humidityThr", humidityThr);
-        doc["humiditySpeed"] = preferences.getUInt("humiditySpeed", humiditySpeed);
-
-        // MQTT
-        doc["enablemqtt"] = enableMqtt;
-        doc["mqttport"] = preferences.getUInt("mqttPort", 1883);
-        doc["mqtthost"] = preferences.getString("mqttHost", "");
-        doc["mqtttopic"] = preferences.getString("mqttTopic", "");
-        doc["mqttuser"] = preferences.getString("mqttUser", "");
-        doc["mqttpass"] = preferences.getString("mqttPass", "");
-      }
-      preferences.end();
+      const config_t &config = Config.get();
+      doc["hostname"] = config.hostName;
+      doc["enablewifi"] = config.enableWifi;
+      doc["enablesoftap"] = config.enableSoftAp;
+
+      doc["otapassword"] = config.otaPassword;
+
+      doc["runMixerAfterMinutes"] = config.runMixerAfter / 60 / 1000;
+      doc["noMixerBelowTempC"] = config.noMixerBelowTempC;
+
+      doc["overrideSpeedPoti"] = config.overrideSpeedPoti;
+      doc["overrideSpeed"] = config.overrideSpeed;
+
+      doc["humidityThr"] = config.humidityThr;
+      doc["humiditySpeed"] = config.humiditySpeed;
+      doc["statusDelta"] = config.statusDelta;
+      doc["tachoPulsesPerRev"] = config.tachoPpr;
+      doc["closedLoop"] = config.closedLoop;
+      doc["maxFanRpm"] = config.maxFanRpm;
+      doc["pidKp"] = config.pidKp;
+      doc["pidKi"] = config.pidKi;
+      doc["pidKd"] = config.pidKd;
+      doc["powerMode"] = config.powerMode;
+      doc["sensorAggregate"] = config.sensorAggregate;
+      doc["perfEnabled"] = config.perfEnabled;
+      doc["perfMqtt"] = config.perfMqtt;
+
+      // MQTT
+      doc["enablemqtt"] = config.enableMqtt;
+      doc["mqttport"] = config.mqttPort;
+      doc["mqtthost"] = config.mqttHost;
+      doc["mqtttopic"] = config.mqttTopic;
+      doc["mqttuser"] = config.mqttUser;
+      doc["mqttpass"] = config.mqttPass;
+
+      // Updates pulled from a manifest
+      doc["updateUrl"] = config.updateUrl;
+      doc["updateInterval"] = config.updateInterval;
+      doc["autoUpdate"] = config.autoUpdate;
 
       serializeJson(doc, output);
       request->send(200, "application/json", output);
@@ -248,6 +599,7 @@ void APIRegisterRoutes() {
 
   webServer.on("/api/partition/switch", HTTP_POST, [&](AsyncWebServerRequest * request){}, NULL,
     [&](AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total) {
+    PERF_SCOPE(PERF_PROBE_WEB);
     auto next = esp_ota_get_next_update_partition(NULL);
     auto error = esp_ota_set_boot_partition(next);
     if (error == ESP_OK) {
@@ -258,107 +610,143 @@ void APIRegisterRoutes() {
   });
 
   webServer.on("/api/esp", HTTP_GET, [&](AsyncWebServerRequest * request) {
+    PERF_SCOPE(PERF_PROBE_WEB);
     String output;
-    DynamicJsonDocument json(2048);
-
-    JsonObject booting = json.createNestedObject("booting");
-    booting["rebootReason"] = esp_reset_reason();
-    booting["partitionCount"] = esp_ota_get_app_partition_count();
-
-    auto partition = esp_ota_get_boot_partition();
-    JsonObject bootPartition = json.createNestedObject("bootPartition");
-    bootPartition["address"] = partition->address;
-    bootPartition["size"] = partition->size;
-    bootPartition["label"] = partition->label;
-    bootPartition["encrypted"] = partition->encrypted;
-    switch (partition->type) {
-      case ESP_PARTITION_TYPE_APP:  bootPartition["type"] = "app"; break;
-      case ESP_PARTITION_TYPE_DATA: bootPartition["type"] = "data"; break;
-      default: bootPartition["type"] = "any";
+    DynamicJsonDocument json(API_ESP_INFO_SIZE);
+    APIBuildEspInfo(json);
+    if (json.overflowed()) {
+      request->send(500, "application/json", "{\"message\":\"Status exceeds API_ESP_INFO_SIZE\"}");
+      return;
     }
-    bootPartition["subtype"] = partition->subtype;
-
-    partition = esp_ota_get_running_partition();
-    JsonObject runningPartition = json.createNestedObject("runningPartition");
-    runningPartition["address"] = partition->address;
-    runningPartition["size"] = partition->size;
-    runningPartition["label"] = partition->label;
-    runningPartition["encrypted"] = partition->encrypted;
-    switch (partition->type) {
-      case ESP_PARTITION_TYPE_APP:  runningPartition["type"] = "app"; break;
-      case ESP_PARTITION_TYPE_DATA: runningPartition["type"] = "data"; break;
-      default: runningPartition["type"] = "any";
+    serializeJson(json, output);
+    request->send(200, "application/json", output);
+  });
+
+  webServer.on("/api/perf", HTTP_GET, [&](AsyncWebServerRequest *request) {
+    String output;
+    UBaseType_t taskCount = uxTaskGetNumberOfTasks();
+    DynamicJsonDocument json(JSON_OBJECT_SIZE(6)
+      + JSON_ARRAY_SIZE(PERF_PROBE_COUNT) + PERF_PROBE_COUNT * (JSON_OBJECT_SIZE(6) + JSON_ARRAY_SIZE(PERF_BUCKETS))
+      + JSON_ARRAY_SIZE(taskCount) + taskCount * JSON_OBJECT_SIZE(4));
+
+    json["enabled"] = Perf.isEnabled();
+    json["probeCostNs"] = Perf.getProbeCostNs();
+    json["overheadPercent"] = Perf.getOverheadPercent();
+    JsonArray probes = json.createNestedArray("probes");
+    for (uint8_t i = 0; i < PERF_PROBE_COUNT; i++) {
+      const perfprobe_t &p = Perf.getProbe((perf_probe_t)i);
+      JsonObject probe = probes.createNestedObject();
+      probe["name"] = PerfClass::getName((perf_probe_t)i);
+      probe["count"] = p.count;
+      probe["avgUs"] = p.count ? (uint32_t)(p.totalUs / p.count) : 0;
+      probe["maxUs"] = p.maxUs;
+      probe["sharePercent"] = Perf.getSharePercent((perf_probe_t)i);
+      // Bucket i counts durations below 2^i µs
+      JsonArray histogram = probe.createNestedArray("histogram");
+      for (uint8_t b = 0; b < PERF_BUCKETS; b++) histogram.add(p.histogram[b]);
+    }
+
+    // The CPU share of the tasks needs configGENERATE_RUN_TIME_STATS, which the prebuilt
+    // Arduino core does not enable. Without it cpuPercent is null instead of a misleading 0.
+    json["runTimeStats"] = false;
+    JsonArray tasks = json.createNestedArray("tasks");
+#if configUSE_TRACE_FACILITY
+    TaskStatus_t *taskStatus = (TaskStatus_t *)malloc(taskCount * sizeof(TaskStatus_t));
+    if (taskStatus) {
+      uint32_t totalRunTime = 0;
+      taskCount = uxTaskGetSystemState(taskStatus, taskCount, &totalRunTime);
+#if configGENERATE_RUN_TIME_STATS
+      json["runTimeStats"] = totalRunTime > 0;
+#endif
+      for (UBaseType_t i = 0; i < taskCount; i++) {
+        JsonObject task = tasks.createNestedObject();
+        task["name"] = taskStatus[i].pcTaskName;
+        task["priority"] = taskStatus[i].uxCurrentPriority;
+        task["stackHighWaterMark"] = taskStatus[i].usStackHighWaterMark;
+#if configGENERATE_RUN_TIME_STATS
+        // Share of one core since boot
+        if (totalRunTime) task["cpuPercent"] = taskStatus[i].ulRunTimeCounter * 100.f / totalRunTime;
+        else task["cpuPercent"] = nullptr;
+#else
+        task["cpuPercent"] = nullptr;
+#endif
+      }
+      free(taskStatus);
+    }
+#else
+    // Without the trace facility only the loop task is known
+    JsonObject task = tasks.createNestedObject();
+    task["name"] = pcTaskGetTaskName(loopTaskHandle);
+    task["stackHighWaterMark"] = uxTaskGetStackHighWaterMark(loopTaskHandle);
+#endif
+
+    if (json.overflowed()) {
+      request->send(500, "application/json", "{\"message\":\"Too many tasks for the statistics\"}");
+      return;
     }
-    runningPartition["subtype"] = partition->subtype;
-
-    JsonObject build = json.createNestedObject("build");
-    build["date"] = __DATE__;
-    build["time"] = __TIME__;
-
-    JsonObject ram = json.createNestedObject("ram");
-    ram["heapSize"] = ESP.getHeapSize();
-    ram["freeHeap"] = ESP.getFreeHeap();
-    ram["usagePercent"] = (float)ESP.getFreeHeap() / (float)ESP.getHeapSize() * 100.f;
-    ram["minFreeHeap"] = ESP.getMinFreeHeap();
-    ram["maxAllocHeap"] = ESP.getMaxAllocHeap();
-
-    JsonObject spi = json.createNestedObject("spi");
-    spi["psramSize"] = ESP.getPsramSize();
-    spi["freePsram"] = ESP.getFreePsram();
-    spi["minFreePsram"] = ESP.getMinFreePsram();
-    spi["maxAllocPsram"] = ESP.getMaxAllocPsram();
-
-    JsonObject chip = json.createNestedObject("chip");
-    chip["revision"] = ESP.getChipRevision();
-    chip["model"] = ESP.getChipModel();
-    chip["cores"] = ESP.getChipCores();
-    chip["cpuFreqMHz"] = ESP.getCpuFreqMHz();
-    chip["cycleCount"] = ESP.getCycleCount();
-    chip["sdkVersion"] = ESP.getSdkVersion();
-    chip["efuseMac"] = ESP.getEfuseMac();
-    chip["temperature"] = (temprature_sens_read() - 32) / 1.8;
-
-    JsonObject flash = json.createNestedObject("flash");
-    flash["flashChipSize"] = ESP.getFlashChipSize();
-    flash["flashChipRealSize"] = spi_flash_get_chip_size();
-    flash["flashChipSpeedMHz"] = ESP.getFlashChipSpeed() / 1000000;
-    flash["flashChipMode"] = ESP.getFlashChipMode();
-    flash["sdkVersion"] = ESP.getFlashChipSize();
-
-    JsonObject sketch = json.createNestedObject("sketch");
-    sketch["size"] = ESP.getSketchSize();
-    sketch["maxSize"] = ESP.getFreeSketchSpace();
-    sketch["usagePercent"] = (float)ESP.getSketchSize() / (float)ESP.getFreeSketchSpace() * 100.f;
-    sketch["md5"] = ESP.getSketchMD5();
-
-    JsonObject fs = json.createNestedObject("filesystem");
-    fs["type"] = F("LittleFS");
-    fs["totalBytes"] = LittleFS.totalBytes();
-    fs["usedBytes"] = LittleFS.usedBytes();
-    fs["usagePercent"] = (float)LittleFS.usedBytes() / (float)LittleFS.totalBytes() * 100.f;
-    
     serializeJson(json, output);
     request->send(200, "application/json", output);
   });
 
-  File tmp = LittleFS.open("/index.html");
-  time_t cr = tmp.getLastWrite();
-  tmp.close();
-  struct tm * timeinfo = gmtime(&cr);
+  webServer.on("/api/perf", HTTP_DELETE, [&](AsyncWebServerRequest *request) {
+    Perf.reset();
+    request->send(200, "application/json", "{\"message\":\"Statistics cleared\"}");
+  });
 
-  webServer.serveStatic("/", LittleFS, "/")
-    .setCacheControl("max-age=86400")
-    .setLastModified(timeinfo)
-    .setDefaultFile("index.html");
+#ifdef BENCHMARK
+  // Blocks the web server for about a second, only available in benchmark builds
+  webServer.on("/api/bench", HTTP_GET, [&](AsyncWebServerRequest *request) {
+    static char benchmarks[BENCH_JSON_SIZE];
+    runBenchmarks(benchmarks, sizeof(benchmarks));
+    request->send(200, "application/json", benchmarks);
+  });
+#endif
+
+  // Raw records of the flash log, registered first as it shares the /api/history prefix.
+  // Times are in log clock seconds, X-Log-Time tells the current log clock.
+  webServer.on("/api/history/log", HTTP_GET, [&](AsyncWebServerRequest *request) {
+    PERF_SCOPE(PERF_PROBE_WEB);
+    uint32_t from = request->hasParam("from") ? request->getParam("from")->value().toInt() : 0;
+    uint32_t to = request->hasParam("to") ? request->getParam("to")->value().toInt() : UINT32_MAX;
+
+    AsyncWebServerResponse *response = request->beginChunkedResponse("application/octet-stream",
+      [from, to](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t {
+        // 0 ends the response, with little send space left there is simply no room for a record yet
+        if (maxLen < sizeof(historyrecord_t)) return RESPONSE_TRY_AGAIN;
+        return HistoryLog.read(from, to, buffer, maxLen);
+      }
+    );
+    response->addHeader("X-Log-Time", String(HistoryLog.toLogTime(runtime() / 1000)));
+    request->send(response);
+  });
+
+  // Time range in seconds of uptime, the response is streamed row by row
+  webServer.on("/api/history", HTTP_GET, [&](AsyncWebServerRequest *request) {
+    PERF_SCOPE(PERF_PROBE_WEB);
+    uint32_t now = runtime() / 1000;
+    uint32_t to = request->hasParam("to") ? request->getParam("to")->value().toInt() : now;
+    uint32_t from = request->hasParam("from") ? request->getParam("from")->value().toInt() : (to > 3600 ? to - 3600 : 0);
+    uint16_t resolution = request->hasParam("res") ? request->getParam("res")->value().toInt() : 0;
+
+    HistoryCursor cursor(History, History.selectTier(from, resolution), from, to, now);
+    AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+      [cursor](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t {
+        return cursor.read(buffer, maxLen);
+      }
+    );
+    request->send(response);
+  });
 
+  // Precompressed UI from tools/littlefsbuilder.py, the SPA routes fall back to index.html
+  Assets = new AssetHandler(LittleFS);
+  Assets->begin();
+  webServer.addHandler(Assets);
 
   webServer.onNotFound([&](AsyncWebServerRequest *request) {
     if (request->method() == HTTP_OPTIONS) {
       request->send(200);
     } else {
-      AsyncWebServerResponse *response = request->beginResponse(LittleFS, "/index.html");
-      response->setCode(200);
-      request->send(response);
+      Assets->send(request, "/index.html");
 /*    if (request->contentType() == "application/json") {
         request->send(404, "application/json", "{\"message\":\"Not found\"}");
       } else request->send(404, "text/plain", "Not found");*/
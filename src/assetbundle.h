@@ -0,0 +1,114 @@
+/**
+ * @file assetbundle.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Reader of the flat UI bundle written by tools/assetbundle.py
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef ASSETBUNDLE_h
+#define ASSETBUNDLE_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Layout, little endian and 4 byte aligned, so the bundle is used in place from mapped flash:
+//   header | entries sorted by path | NUL terminated paths | file data
+#define ASSETBUNDLE_MAGIC       0x4241474F    // "OGAB"
+#define ASSETBUNDLE_VERSION     1
+#define ASSETBUNDLE_FLAG_GZIP   0x01          // Data is gzip, send it with Content-Encoding: gzip
+#define ASSETBUNDLE_ETAG_SIZE   16
+
+struct assetbundleheader_t {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;
+  uint32_t size;          // Bytes of the whole bundle, the partition is larger
+  uint32_t crc;           // CRC-32 (zlib) of the bytes after the header
+};
+
+struct assetbundleentry_t {
+  uint32_t pathOffset;
+  uint16_t pathLength;
+  uint8_t flags;
+  uint8_t reserved;
+  uint32_t dataOffset;
+  uint32_t dataSize;
+  char etag[ASSETBUNDLE_ETAG_SIZE + 4];   // NUL terminated, same hash as in /assets.manifest
+};
+
+static_assert(sizeof(assetbundleheader_t) == 16, "bundle header layout");
+static_assert(sizeof(assetbundleentry_t) == 36, "bundle entry layout");
+
+// CRC-32 with a 16 entry table, small enough to keep in DRAM
+static inline uint32_t assetBundleCrc32(uint32_t crc, const uint8_t *data, size_t length) {
+  static const uint32_t table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+  };
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc = table[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+    crc = table[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+  }
+  return ~crc;
+}
+
+class AssetBundle {
+    public:
+        // Validates the structure, the CRC is optional as it reads the whole bundle once
+        bool open(const uint8_t *data, size_t available, bool verifyCrc = true) {
+            base = NULL;
+            if (!data || available < sizeof(assetbundleheader_t)) return false;
+            const assetbundleheader_t *head = (const assetbundleheader_t *)data;
+            if (head->magic != ASSETBUNDLE_MAGIC || head->version != ASSETBUNDLE_VERSION) return false;
+            if (head->size > available || sizeof(assetbundleheader_t) + head->count * sizeof(assetbundleentry_t) > head->size) return false;
+
+            const assetbundleentry_t *list = (const assetbundleentry_t *)(data + sizeof(assetbundleheader_t));
+            for (uint16_t i = 0; i < head->count; i++) {
+                const assetbundleentry_t &e = list[i];
+                if (e.pathOffset + e.pathLength >= head->size || data[e.pathOffset + e.pathLength] != '\0') return false;
+                if (e.dataOffset > head->size || e.dataSize > head->size - e.dataOffset) return false;
+                if (e.etag[ASSETBUNDLE_ETAG_SIZE] != '\0') return false;
+            }
+            if (verifyCrc && assetBundleCrc32(0, data + sizeof(assetbundleheader_t), head->size - sizeof(assetbundleheader_t)) != head->crc) return false;
+
+            base = data;
+            header = head;
+            entries = list;
+            return true;
+        }
+
+        bool isOpen() const { return base != NULL; }
+        uint16_t getCount() const { return base ? header->count : 0; }
+        uint32_t getSize() const { return base ? header->size : 0; }
+
+        const assetbundleentry_t *find(const char *path) const {
+            if (!base) return NULL;
+            size_t low = 0, high = header->count;
+            while (low < high) {
+                size_t mid = (low + high) / 2;
+                int cmp = strcmp(getPath(entries[mid]), path);
+                if (cmp == 0) return &entries[mid];
+                if (cmp < 0) low = mid + 1;
+                else high = mid;
+            }
+            return NULL;
+        }
+
+        const char *getPath(const assetbundleentry_t &entry) const { return (const char *)base + entry.pathOffset; }
+        const uint8_t *getData(const assetbundleentry_t &entry) const { return base + entry.dataOffset; }
+
+    private:
+        const uint8_t *base = NULL;
+        const assetbundleheader_t *header = NULL;
+        const assetbundleentry_t *entries = NULL;
+};
+
+#endif // ASSETBUNDLE_h
@@ -0,0 +1,194 @@
+/**
+ * @file assets.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Serves the precompressed UI with strong ETags and cache headers
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include "assets.h"
+#include "log.h"
+
+AssetHandler::~AssetHandler() {
+  if (mmapHandle) spi_flash_munmap(mmapHandle);
+  free(entries);
+  free(manifest);
+}
+
+// Same types as AsyncFileResponse, which is not used for the bundle
+static const char *contentType(const String &path) {
+  if (path.endsWith(".html")) return "text/html";
+  if (path.endsWith(".css")) return "text/css";
+  if (path.endsWith(".js")) return "application/javascript";
+  if (path.endsWith(".json") || path.endsWith(".webmanifest")) return "application/json";
+  if (path.endsWith(".svg")) return "image/svg+xml";
+  if (path.endsWith(".png")) return "image/png";
+  if (path.endsWith(".jpg")) return "image/jpeg";
+  if (path.endsWith(".ico")) return "image/x-icon";
+  if (path.endsWith(".woff2")) return "font/woff2";
+  if (path.endsWith(".woff")) return "font/woff";
+  if (path.endsWith(".ttf")) return "application/x-font-ttf";
+  if (path.endsWith(".xml")) return "text/xml";
+  if (path.endsWith(".txt")) return "text/plain";
+  return "application/octet-stream";
+}
+
+bool AssetHandler::begin() {
+  if (mapBundle()) return true;
+  return loadManifest();
+}
+
+bool AssetHandler::mapBundle() {
+  const esp_partition_t *partition = esp_partition_find_first(ASSETS_PARTITION_TYPE, ESP_PARTITION_SUBTYPE_ANY, ASSETS_PARTITION_LABEL);
+  if (!partition) return false;
+
+  // Mapped once, the responses read from the flash cache without a copy in RAM
+  const void *mapped = NULL;
+  esp_err_t err = esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &mapped, &mmapHandle);
+  if (err != ESP_OK) {
+    LOG_INFO_F("[WEB] Unable to map the asset partition: %s\n", esp_err_to_name(err));
+    mmapHandle = 0;
+    return false;
+  }
+  if (!bundle.open((const uint8_t *)mapped, partition->size)) {
+    LOG_INFO_LN(F("[WEB] No valid asset bundle, serving the UI from LittleFS"));
+    spi_flash_munmap(mmapHandle);
+    mmapHandle = 0;
+    return false;
+  }
+  LOG_INFO_F("[WEB] Asset bundle with %u files (%u bytes) mapped\n", bundle.getCount(), bundle.getSize());
+  return true;
+}
+
+bool AssetHandler::loadManifest() {
+  File file = fs.open(ASSETS_MANIFEST, "r");
+  if (!file) {
+    LOG_INFO_LN(F("[WEB] No asset manifest, serving the UI without ETags"));
+    return false;
+  }
+
+  // One allocation for the text, the entries point into it
+  size_t size = file.size();
+  manifest = (char *)malloc(size + 1);
+  if (!manifest) return false;
+  size = file.read((uint8_t *)manifest, size);
+  manifest[size] = '\0';
+  file.close();
+
+  size_t lines = 0;
+  for (size_t i = 0; i < size; i++) if (manifest[i] == '\n') lines++;
+  entries = (assetentry_t *)malloc(lines * sizeof(assetentry_t));
+  if (!entries) return false;
+
+  // "<etag> <gz 0|1> <path>\n", sorted by path
+  char *line = manifest;
+  while (*line && count < lines) {
+    char *end = strchr(line, '\n');
+    if (!end) break;
+    *end = '\0';
+    if (end - line > ASSETS_ETAG_SIZE + 3 && line[ASSETS_ETAG_SIZE] == ' ') {
+      line[ASSETS_ETAG_SIZE] = '\0';
+      entries[count++] = { line + ASSETS_ETAG_SIZE + 3, line, line[ASSETS_ETAG_SIZE + 1] == '1' };
+    }
+    line = end + 1;
+  }
+  LOG_INFO_F("[WEB] Asset manifest with %u files loaded\n", count);
+  return true;
+}
+
+const assetentry_t *AssetHandler::find(const char *path) {
+  size_t low = 0, high = count;
+  while (low < high) {
+    size_t mid = (low + high) / 2;
+    int cmp = strcmp(entries[mid].path, path);
+    if (cmp == 0) return &entries[mid];
+    if (cmp < 0) low = mid + 1;
+    else high = mid;
+  }
+  return NULL;
+}
+
+String AssetHandler::resolve(const String &url) {
+  return url.endsWith("/") ? url + "index.html" : url;
+}
+
+bool AssetHandler::canHandle(AsyncWebServerRequest *request) {
+  if (request->method() != HTTP_GET && request->method() != HTTP_HEAD) return false;
+  if (request->url().startsWith("/api/")) return false;
+
+  // Also needed by the SPA routes, they get index.html through onNotFound and send()
+  request->addInterestingHeader("If-None-Match");
+  request->addInterestingHeader("Accept-Encoding");
+
+  String path = resolve(request->url());
+  if (bundle.isOpen()) return bundle.find(path.c_str()) != NULL;
+  if (count) return find(path.c_str()) != NULL;
+  return fs.exists(path) || fs.exists(path + ".gz");
+}
+
+void AssetHandler::handleRequest(AsyncWebServerRequest *request) {
+  send(request, resolve(request->url()));
+}
+
+bool AssetHandler::sendNotModified(AsyncWebServerRequest *request, const String &etag, const char *cacheControl) {
+  if (!request->hasHeader("If-None-Match") || request->header("If-None-Match").indexOf(etag) < 0) return false;
+  notModified++;
+  AsyncWebServerResponse *response = request->beginResponse(304);
+  response->addHeader("ETag", etag);
+  response->addHeader("Cache-Control", cacheControl);
+  request->send(response);
+  return true;
+}
+
+void AssetHandler::send(AsyncWebServerRequest *request, const String &path) {
+  requests++;
+  const char *cacheControl = path.startsWith(ASSETS_IMMUTABLE_PREFIX) ? ASSETS_CACHE_IMMUTABLE : ASSETS_CACHE_REVALIDATE;
+
+  // Only one representation is stored, so the hash of the stored bytes is a strong ETag
+  const assetbundleentry_t *bundled = bundle.find(path.c_str());
+  if (bundled) {
+    String etag = String("\"") + bundled->etag + "\"";
+    if (sendNotModified(request, etag, cacheControl)) return;
+
+    // Sent in chunks from the mapped flash, like PROGMEM data
+    AsyncWebServerResponse *response = request->beginResponse_P(200, contentType(path), bundle.getData(*bundled), bundled->dataSize);
+    if (bundled->flags & ASSETBUNDLE_FLAG_GZIP) {
+      gzipped++;
+      response->addHeader("Content-Encoding", "gzip");
+    }
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", cacheControl);
+    response->addHeader("Vary", "Accept-Encoding");
+    request->send(response);
+    return;
+  }
+
+  const assetentry_t *entry = find(path.c_str());
+  String etag;
+  if (entry) {
+    etag = String("\"") + entry->etag + "\"";
+    if (sendNotModified(request, etag, cacheControl)) return;
+  }
+
+  // A stored .gz is sent even without "Accept-Encoding: gzip", there is no other copy
+  bool acceptsGzip = request->hasHeader("Accept-Encoding") && request->header("Accept-Encoding").indexOf("gzip") >= 0;
+  bool gz = entry ? entry->gz : (acceptsGzip || !fs.exists(path)) && fs.exists(path + ".gz");
+  File file = fs.open(gz ? path + ".gz" : path, "r");
+  if (!file) {
+    request->send(404, "text/plain", "Not found");
+    return;
+  }
+  if (gz) gzipped++;
+
+  // The content type is taken from the path, the Content-Encoding from the ".gz" of the file
+  AsyncWebServerResponse *response = request->beginResponse(file, path);
+  if (entry) response->addHeader("ETag", etag);
+  response->addHeader("Cache-Control", cacheControl);
+  response->addHeader("Vary", "Accept-Encoding");
+  request->send(response);
+}
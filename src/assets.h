@@ -0,0 +1,78 @@
+/**
+ * @file assets.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Serves the precompressed UI with strong ETags and cache headers
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef ASSETS_h
+#define ASSETS_h
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <FS.h>
+#include <esp_partition.h>
+#include "assetbundle.h"
+
+#define ASSETS_MANIFEST         "/assets.manifest"    // Written by tools/littlefsbuilder.py
+#define ASSETS_IMMUTABLE_PREFIX "/_app/immutable/"    // File names contain a content hash
+#define ASSETS_CACHE_IMMUTABLE  "public, max-age=31536000, immutable"
+#define ASSETS_CACHE_REVALIDATE "no-cache"            // Cached, but revalidated with the ETag
+#define ASSETS_ETAG_SIZE        16
+#define ASSETS_PARTITION_LABEL  "assets"              // Bundle from tools/assetbundle.py, see partitions.csv
+#define ASSETS_PARTITION_TYPE   ((esp_partition_type_t)0x40)
+
+struct assetentry_t {
+  const char *path;
+  const char *etag;
+  bool gz;              // Only "path.gz" is stored
+};
+
+class AssetHandler : public AsyncWebHandler {
+    public:
+        AssetHandler(fs::FS &fs) : fs(fs) {}
+        ~AssetHandler();
+        // Maps the bundle partition, falls back to LittleFS and its manifest.
+        // Without a manifest the files are served without an ETag.
+        bool begin();
+
+        bool canHandle(AsyncWebServerRequest *request) override;
+        void handleRequest(AsyncWebServerRequest *request) override;
+        bool isRequestHandlerTrivial() override { return true; }
+
+        // Also used for the fallback of the single page application
+        void send(AsyncWebServerRequest *request, const String &path);
+
+        bool isBundled() { return bundle.isOpen(); }
+        const AssetBundle &getBundle() { return bundle; }
+        size_t getEntryCount() { return bundle.isOpen() ? bundle.getCount() : count; }
+        uint32_t getRequests() { return requests; }
+        uint32_t getNotModified() { return notModified; }
+        uint32_t getGzipped() { return gzipped; }
+
+    private:
+        fs::FS &fs;
+        AssetBundle bundle;
+        spi_flash_mmap_handle_t mmapHandle = 0;
+        char *manifest = NULL;
+        assetentry_t *entries = NULL;
+        size_t count = 0;
+
+        uint32_t requests = 0;
+        uint32_t notModified = 0;
+        uint32_t gzipped = 0;
+
+        bool mapBundle();
+        bool loadManifest();
+        const assetentry_t *find(const char *path);
+        bool sendNotModified(AsyncWebServerRequest *request, const String &etag, const char *cacheControl);
+        String resolve(const String &url);
+};
+
+#endif // ASSETS_h
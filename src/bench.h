@@ -0,0 +1,115 @@
+/**
+ * @file bench.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Micro benchmark runner with JSON output, for the firmware and the host
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef BENCH_h
+#define BENCH_h
+
+#include <stdint.h>
+#include <stdio.h>
+
+// No Arduino dependency on purpose, the clock is injected: CPU cycles on the device, ns on the host
+#define BENCH_MAX_RESULTS   16
+#define BENCH_BATCHES       10      // The rounds are split into batches, the fastest batch gives "min"
+#define BENCH_JSON_SIZE     2048
+#define BENCH_ASSET_COPY    "/bench-index.html"  // Bundled index.html on LittleFS, removed after the run
+
+// Body as sent by the settings page to /api/config
+#define BENCH_SAMPLE_CONFIG "{\"hostname\":\"ogo-toilet\",\"enablewifi\":true,\"enablesoftap\":true," \
+  "\"runMixerAfterMinutes\":720,\"noMixerBelowTempC\":10,\"overrideSpeedPoti\":false,\"overrideSpeed\":25," \
+  "\"humidityThr\":75,\"humiditySpeed\":80,\"statusDelta\":false,\"tachoPulsesPerRev\":2,\"closedLoop\":false," \
+  "\"maxFanRpm\":3000,\"pidKp\":0.5,\"pidKi\":0.5,\"pidKd\":0,\"powerMode\":0,\"sensorAggregate\":0," \
+  "\"otapassword\":\"secret\",\"enablemqtt\":true,\"mqtthost\":\"mqtt.net.local\",\"mqttport\":1883," \
+  "\"mqtttopic\":\"verges/toilet\",\"mqttuser\":\"user\",\"mqttpass\":\"password\"}"
+
+typedef uint64_t (*benchclock_fn)();
+typedef int32_t (*benchheap_fn)();  // Free heap, NULL if unknown
+
+struct benchresult_t {
+  const char *name;
+  uint32_t rounds;
+  uint64_t avg;         // Clock units per round
+  uint64_t min;         // Clock units per round of the fastest batch
+  uint32_t bytes;       // Output size of the last round, if it produces any
+  int32_t heapDelta;    // Heap lost over all rounds, > 0 is a leak or a cache
+  const char *error;    // Why the benchmark did not run, NULL otherwise
+};
+
+class BenchRunner {
+    public:
+        BenchRunner(const char *unit, benchclock_fn clock, benchheap_fn heap = NULL)
+            : unit(unit), clock(clock), heap(heap) {}
+
+        // fn() is one round and returns the number of bytes it produced
+        template<typename F> void run(const char *name, uint32_t rounds, F fn) {
+            if (count >= BENCH_MAX_RESULTS) return;
+            if (rounds < BENCH_BATCHES) rounds = BENCH_BATCHES;
+            uint32_t perBatch = rounds / BENCH_BATCHES;
+            uint32_t bytes = fn();      // Warm up caches and lazy allocations
+
+            int32_t heapBefore = heap ? heap() : 0;
+            uint64_t total = 0, fastest = UINT64_MAX;
+            for (uint8_t batch = 0; batch < BENCH_BATCHES; batch++) {
+                uint64_t start = clock();
+                for (uint32_t i = 0; i < perBatch; i++) bytes = fn();
+                uint64_t duration = clock() - start;
+                total += duration;
+                if (duration < fastest) fastest = duration;
+            }
+            int32_t heapDelta = heap ? heapBefore - heap() : 0;
+
+            results[count++] = { name, perBatch * BENCH_BATCHES, total / (perBatch * BENCH_BATCHES),
+                                 fastest / perBatch, bytes, heapDelta, NULL };
+        }
+
+        // A benchmark without its input is listed with the reason instead of a result
+        void fail(const char *name, const char *error) {
+            if (count >= BENCH_MAX_RESULTS) return;
+            results[count++] = { name, 0, 0, 0, 0, 0, error };
+        }
+
+        // {"unit":"cycles","results":[{"name":..,"rounds":..,"avg":..,"min":..,"bytes":..,"heapDelta":..},{"name":..,"error":..}]}
+        size_t toJson(char *buffer, size_t size, const char *version = "") const {
+            size_t length = 0;
+            append(buffer, size, length, "{\"version\":\"%s\",\"unit\":\"%s\",\"results\":[", version, unit);
+            for (uint8_t i = 0; i < count; i++) {
+                const benchresult_t &r = results[i];
+                if (r.error) {
+                    append(buffer, size, length, "%s{\"name\":\"%s\",\"error\":\"%s\"}", i ? "," : "", r.name, r.error);
+                    continue;
+                }
+                append(buffer, size, length, "%s{\"name\":\"%s\",\"rounds\":%u,\"avg\":%llu,\"min\":%llu,\"bytes\":%u,\"heapDelta\":%d}",
+                    i ? "," : "", r.name, (unsigned)r.rounds, (unsigned long long)r.avg, (unsigned long long)r.min,
+                    (unsigned)r.bytes, (int)r.heapDelta);
+            }
+            append(buffer, size, length, "]}");
+            return length;
+        }
+
+        uint8_t getCount() const { return count; }
+        const benchresult_t &getResult(uint8_t i) const { return results[i]; }
+
+    private:
+        const char *unit;
+        benchclock_fn clock;
+        benchheap_fn heap;
+        benchresult_t results[BENCH_MAX_RESULTS];
+        uint8_t count = 0;
+
+        template<typename... Args> static void append(char *buffer, size_t size, size_t &length, const char *format, Args... args) {
+            if (length >= size) return;
+            int written = snprintf(buffer + length, size - length, format, args...);
+            if (written > 0) length += (size_t)written < size - length ? written : size - length - 1;
+        }
+};
+
+#endif // BENCH_h
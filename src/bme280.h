@@ -0,0 +1,90 @@
+/**
+ * @file bme280.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Bosch BME280 driver, temperature and humidity only
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef BME280_h
+#define BME280_h
+
+#include "climatesensor.h"
+#include "i2cbus.h"
+
+#define BME280_ADDRESS          0x76    // 0x77 with SDO pulled high
+#define BME280_CHIP_ID          0x60
+#define BME280_CONVERSION_MS    10      // Forced mode with 1x oversampling of all channels
+
+class Bme280Sensor : public ClimateSensor {
+    public:
+        Bme280Sensor(I2CBus &bus, uint8_t address = BME280_ADDRESS) : bus(bus), address(address) {}
+
+        const char *getName() { return "bme280"; }
+        uint16_t getConversionMs() { return BME280_CONVERSION_MS; }
+
+        bool begin() {
+            uint8_t id = 0;
+            if (!bus.readRegister(address, 0xD0, &id, 1) || id != BME280_CHIP_ID) return false;
+
+            uint8_t t[26], h[7];
+            if (!bus.readRegister(address, 0x88, t, sizeof(t))) return false;
+            if (!bus.readRegister(address, 0xE1, h, sizeof(h))) return false;
+            digT1 = t[0] | (t[1] << 8);
+            digT2 = (int16_t)(t[2] | (t[3] << 8));
+            digT3 = (int16_t)(t[4] | (t[5] << 8));
+            digH1 = t[25];
+            digH2 = (int16_t)(h[0] | (h[1] << 8));
+            digH3 = h[2];
+            digH4 = (int16_t)((int8_t)h[3] * 16 | (h[4] & 0x0F));
+            digH5 = (int16_t)((int8_t)h[5] * 16 | (h[4] >> 4));
+            digH6 = (int8_t)h[6];
+
+            // Humidity oversampling only applies after the next write to ctrl_meas, see trigger()
+            return bus.writeRegister(address, 0xF2, 0x01) && bus.writeRegister(address, 0xF5, 0x00);
+        }
+
+        bool trigger() {
+            return bus.writeRegister(address, 0xF4, 0x25);     // 1x temperature and pressure, forced mode
+        }
+
+        bool collect(float &temperature, float &humidity) {
+            uint8_t data[5];
+            if (!bus.readRegister(address, 0xFA, data, sizeof(data))) return false;
+            int32_t adcT = ((uint32_t)data[0] << 12) | (data[1] << 4) | (data[2] >> 4);
+            int32_t adcH = (data[3] << 8) | data[4];
+            if (adcT == 0x80000 || adcH == 0x8000) return false;   // Measurement skipped
+
+            // Integer compensation from the datasheet
+            int32_t var1 = ((((adcT >> 3) - ((int32_t)digT1 << 1))) * digT2) >> 11;
+            int32_t var2 = (((((adcT >> 4) - digT1) * ((adcT >> 4) - digT1)) >> 12) * digT3) >> 14;
+            int32_t tFine = var1 + var2;
+            temperature = ((tFine * 5 + 128) >> 8) / 100.f;
+
+            int32_t v = tFine - 76800;
+            v = (((((adcH << 14) - ((int32_t)digH4 << 20) - (digH5 * v)) + 16384) >> 15) *
+                (((((((v * digH6) >> 10) * (((v * (int32_t)digH3) >> 11) + 32768)) >> 10) + 2097152) * digH2 + 8192) >> 14));
+            v = v - (((((v >> 15) * (v >> 15)) >> 7) * (int32_t)digH1) >> 4);
+            if (v < 0) v = 0;
+            if (v > 419430400) v = 419430400;
+            humidity = (v >> 12) / 1024.f;
+            return true;
+        }
+
+    private:
+        I2CBus &bus;
+        uint8_t address;
+
+        uint16_t digT1 = 0;
+        int16_t digT2 = 0, digT3 = 0;
+        uint8_t digH1 = 0, digH3 = 0;
+        int16_t digH2 = 0, digH4 = 0, digH5 = 0;
+        int8_t digH6 = 0;
+};
+
+#endif // BME280_h
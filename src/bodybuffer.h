@@ -0,0 +1,68 @@
+/**
+ * @file bodybuffer.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Assembles a request body from the chunks of ESPAsyncWebServer within a size budget
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef BODYBUFFER_h
+#define BODYBUFFER_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// No Arduino dependency on purpose, so the chunk handling can be checked on the host.
+// One malloc() per body, so it can be kept in request->_tempObject that is free()d with the request.
+struct bodybuffer_t {
+  uint32_t size;            // Content-Length
+  uint32_t received;
+  char data[];              // size + 1 bytes, NUL terminated once complete
+};
+
+enum body_status_t : uint8_t {
+  BODY_PENDING,             // More chunks to come
+  BODY_COMPLETE,
+  BODY_TOO_LARGE,           // Content-Length above the budget, nothing is allocated
+  BODY_NO_MEMORY,
+  BODY_INVALID,             // Chunk without a start, out of order or beyond Content-Length
+  BODY_IGNORED              // Later chunk of a body that already failed with one of the errors above
+};
+
+// Adds one chunk, the buffer is allocated with the first one and released on errors.
+// Each body ends with exactly one of BODY_COMPLETE, BODY_TOO_LARGE, BODY_NO_MEMORY or
+// BODY_INVALID, so the caller answers these and only these.
+static inline body_status_t bodyFeed(bodybuffer_t *&buffer, const uint8_t *data, size_t len, size_t index, size_t total, size_t budget) {
+  if (index == 0) {
+    free(buffer);
+    buffer = NULL;
+    if (total > budget) return BODY_TOO_LARGE;
+    buffer = (bodybuffer_t *)malloc(sizeof(bodybuffer_t) + total + 1);
+    if (!buffer) return BODY_NO_MEMORY;
+    buffer->size = total;
+    buffer->received = 0;
+  } else if (!buffer) {
+    // The first chunk always has index 0, so the body already failed and was answered
+    return BODY_IGNORED;
+  }
+  if (total != buffer->size || index != buffer->received || len > buffer->size - buffer->received) {
+    free(buffer);
+    buffer = NULL;
+    return BODY_INVALID;
+  }
+
+  if (len) memcpy(buffer->data + index, data, len);
+  buffer->received += len;
+  if (buffer->received < buffer->size) return BODY_PENDING;
+  buffer->data[buffer->size] = '\0';
+  return BODY_COMPLETE;
+}
+
+#endif // BODYBUFFER_h
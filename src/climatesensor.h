@@ -0,0 +1,89 @@
+/**
+ * @file climatesensor.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Common interface and aggregation of temperature / humidity sensors
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef CLIMATESENSOR_h
+#define CLIMATESENSOR_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+// No Arduino dependency on purpose, like i2cbus.h
+#define SENSOR_MAX_AGE_MS   30000   // Older samples are flagged as stale and not aggregated
+
+enum sensor_quality_t : uint8_t {
+  SENSOR_QUALITY_NONE,      // No sample yet
+  SENSOR_QUALITY_ERROR,     // The last read failed, the values are from an earlier sample
+  SENSOR_QUALITY_GOOD
+};
+
+enum sensor_aggregate_t : uint8_t {
+  SENSOR_AGGREGATE_MEAN,
+  SENSOR_AGGREGATE_MINIMUM,
+  SENSOR_AGGREGATE_MAXIMUM,
+  SENSOR_AGGREGATE_MODES    // Number of modes, not a mode
+};
+
+struct climatesample_t {
+  float temperature = 0;    // °C
+  float humidity = 0;       // %
+  uint32_t timestamp = 0;   // ms of the last good read
+  sensor_quality_t quality = SENSOR_QUALITY_NONE;
+
+  uint32_t getAgeMs(uint32_t now) const { return now - timestamp; }
+  bool isStale(uint32_t now) const { return quality == SENSOR_QUALITY_NONE || getAgeMs(now) > SENSOR_MAX_AGE_MS; }
+  bool isUsable(uint32_t now) const { return quality == SENSOR_QUALITY_GOOD && !isStale(now); }
+};
+
+// Sensors that are read in a batch: all of them are triggered, then collected
+// after the longest conversion time, so the bus is only blocked once per cycle.
+class ClimateSensor {
+    public:
+        virtual ~ClimateSensor() {}
+        virtual const char *getName() = 0;
+        virtual bool begin() = 0;
+        virtual bool trigger() = 0;
+        virtual uint16_t getConversionMs() = 0;
+        virtual bool collect(float &temperature, float &humidity) = 0;
+};
+
+// Combine the usable samples, returns false if there is none
+inline bool climateAggregate(const climatesample_t *samples, size_t count, sensor_aggregate_t mode,
+                             uint32_t now, float &temperature, float &humidity) {
+  size_t used = 0;
+  float t = 0, h = 0;
+  for (size_t i = 0; i < count; i++) {
+    const climatesample_t &sample = samples[i];
+    if (!sample.isUsable(now)) continue;
+    if (used == 0 || mode == SENSOR_AGGREGATE_MEAN) {
+      t = used == 0 ? sample.temperature : t + sample.temperature;
+      h = used == 0 ? sample.humidity : h + sample.humidity;
+    } else if (mode == SENSOR_AGGREGATE_MINIMUM) {
+      if (sample.temperature < t) t = sample.temperature;
+      if (sample.humidity < h) h = sample.humidity;
+    } else {
+      if (sample.temperature > t) t = sample.temperature;
+      if (sample.humidity > h) h = sample.humidity;
+    }
+    used++;
+  }
+  if (used == 0) return false;
+  if (mode == SENSOR_AGGREGATE_MEAN) {
+    t /= used;
+    h /= used;
+  }
+  temperature = t;
+  humidity = h;
+  return true;
+}
+
+#endif // CLIMATESENSOR_h
@@ -0,0 +1,147 @@
+/**
+ * @file config.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Settings in RAM, persisted as one versioned and CRC checked NVS blob
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <esp_rom_crc.h>
+#include "config.h"
+#include "log.h"
+
+// Keys of the per-key layout up to this version, removed after the migration
+static const char *legacyKeys[] = {
+  "hostName", "otaPassword", "mqttHost", "mqttPort", "mqttTopic", "mqttUser", "mqttPass",
+  "enableWifi", "enableSoftAp", "enableMqtt", "runMixerAfter", "noMixerBelow", "overridePoti",
+  "overrideSpeed", "humidityThr", "humiditySpeed", "statusDelta", "tachoPpr", "closedLoop",
+  "maxFanRpm", "pidKp", "pidKi", "pidKd", "powerMode", "sensorAggregate", "perfEnabled", "perfMqtt"
+};
+
+void ConfigClass::begin(const char *nvsNamespace) {
+  this->nvsNamespace = nvsNamespace;
+  config = config_t();
+
+  Preferences prefs;
+  if (!prefs.begin(nvsNamespace)) {
+    LOG_INFO_LN(F("[CONFIG] Unable to open NVS, using the defaults"));
+    memcpy(&stored, &config, sizeof(config_t));
+    return;
+  }
+
+  bool outdated = false;
+  if (load(prefs, outdated)) {
+    source = CONFIG_SOURCE_BLOB;
+    // A blob of another version is written again in the current layout
+    if (outdated) write(prefs);
+  } else if (prefs.isKey("hostName")) {
+    migrate(prefs);
+    source = CONFIG_SOURCE_MIGRATED;
+    if (write(prefs)) {
+      for (const char *key : legacyKeys) prefs.remove(key);
+      LOG_INFO_LN(F("[CONFIG] Migrated the settings to a single blob"));
+    }
+  } else {
+    source = CONFIG_SOURCE_DEFAULTS;
+    write(prefs);
+  }
+  prefs.end();
+}
+
+bool ConfigClass::load(Preferences &prefs, bool &outdated) {
+  size_t length = prefs.getBytesLength(CONFIG_BLOB_KEY);
+  if (length < sizeof(configheader_t)) return false;
+
+  uint8_t *blob = (uint8_t *)malloc(length);
+  if (!blob) return false;
+  prefs.getBytes(CONFIG_BLOB_KEY, blob, length);
+
+  configheader_t header;
+  memcpy(&header, blob, sizeof(header));
+  const uint8_t *data = blob + sizeof(header);
+  bool valid = header.size == length - sizeof(header)
+    && esp_rom_crc32_le(0, data, header.size) == header.crc;
+
+  if (valid) {
+    // Older blobs are shorter, the appended fields keep their defaults
+    memcpy(&config, data, min((size_t)header.size, sizeof(config_t)));
+    config.hostName[CONFIG_STRING_SIZE - 1] = config.otaPassword[CONFIG_STRING_SIZE - 1] = '\0';
+    config.mqttHost[CONFIG_STRING_SIZE - 1] = config.mqttTopic[CONFIG_STRING_SIZE - 1] = '\0';
+    config.mqttUser[CONFIG_STRING_SIZE - 1] = config.mqttPass[CONFIG_STRING_SIZE - 1] = '\0';
+    if (header.version != CONFIG_VERSION) LOG_INFO_F("[CONFIG] Loaded version %u settings\n", header.version);
+  } else LOG_INFO_LN(F("[CONFIG] Stored settings are corrupt, using the defaults"));
+  free(blob);
+
+  memcpy(&stored, &config, sizeof(config_t));
+  outdated = valid && (header.version != CONFIG_VERSION || header.size != sizeof(config_t));
+  return valid;
+}
+
+void ConfigClass::migrate(Preferences &prefs) {
+  prefs.getString("hostName", config.hostName, sizeof(config.hostName));
+  prefs.getString("otaPassword", config.otaPassword, sizeof(config.otaPassword));
+  prefs.getString("mqttHost", config.mqttHost, sizeof(config.mqttHost));
+  prefs.getString("mqttTopic", config.mqttTopic, sizeof(config.mqttTopic));
+  prefs.getString("mqttUser", config.mqttUser, sizeof(config.mqttUser));
+  prefs.getString("mqttPass", config.mqttPass, sizeof(config.mqttPass));
+  config.mqttPort = prefs.getUInt("mqttPort", config.mqttPort);
+  config.runMixerAfter = prefs.getULong("runMixerAfter", config.runMixerAfter);
+  config.maxFanRpm = prefs.getUInt("maxFanRpm", config.maxFanRpm);
+  config.pidKp = prefs.getFloat("pidKp", config.pidKp);
+  config.pidKi = prefs.getFloat("pidKi", config.pidKi);
+  config.pidKd = prefs.getFloat("pidKd", config.pidKd);
+  config.noMixerBelowTempC = prefs.getInt("noMixerBelow", config.noMixerBelowTempC);
+  config.overrideSpeed = prefs.getUInt("overrideSpeed", config.overrideSpeed);
+  config.humidityThr = prefs.getUInt("humidityThr", config.humidityThr);
+  config.humiditySpeed = prefs.getUInt("humiditySpeed", config.humiditySpeed);
+  config.tachoPpr = prefs.getUInt("tachoPpr", config.tachoPpr);
+  config.powerMode = prefs.getUChar("powerMode", config.powerMode);
+  config.sensorAggregate = prefs.getUChar("sensorAggregate", config.sensorAggregate);
+  config.enableWifi = prefs.getBool("enableWifi", config.enableWifi);
+  config.enableSoftAp = prefs.getBool("enableSoftAp", config.enableSoftAp);
+  config.enableMqtt = prefs.getBool("enableMqtt", config.enableMqtt);
+  config.overrideSpeedPoti = prefs.getBool("overridePoti", config.overrideSpeedPoti);
+  config.statusDelta = prefs.getBool("statusDelta", config.statusDelta);
+  config.closedLoop = prefs.getBool("closedLoop", config.closedLoop);
+  config.perfEnabled = prefs.getBool("perfEnabled", config.perfEnabled);
+  config.perfMqtt = prefs.getBool("perfMqtt", config.perfMqtt);
+}
+
+bool ConfigClass::write(Preferences &prefs) {
+  uint8_t blob[sizeof(configheader_t) + sizeof(config_t)];
+  configheader_t header = { CONFIG_VERSION, sizeof(config_t), esp_rom_crc32_le(0, (const uint8_t *)&config, sizeof(config_t)) };
+  memcpy(blob, &header, sizeof(header));
+  memcpy(blob + sizeof(header), &config, sizeof(config_t));
+
+  if (prefs.putBytes(CONFIG_BLOB_KEY, blob, sizeof(blob)) != sizeof(blob)) {
+    LOG_INFO_LN(F("[CONFIG] Unable to store the settings in NVS"));
+    return false;
+  }
+  memcpy(&stored, &config, sizeof(config_t));
+  writes++;
+  return true;
+}
+
+bool ConfigClass::save() {
+  if (!isDirty()) {
+    skippedWrites++;
+    return true;
+  }
+
+  Preferences prefs;
+  if (!nvsNamespace || !prefs.begin(nvsNamespace)) return false;
+  bool success = write(prefs);
+  prefs.end();
+  return success;
+}
+
+bool ConfigClass::copyString(char *target, const char *value, size_t size) {
+  if (!value || strlen(value) >= size) return false;
+  strcpy(target, value);
+  return true;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file config.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Settings in RAM, persisted as one versioned and CRC checked NVS blob
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef CONFIG_h
+#define CONFIG_h
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+#define CONFIG_VERSION      1
+#define CONFIG_BLOB_KEY     "config"
+#define CONFIG_STRING_SIZE  33        // 32 characters as limited by the UI
+#define CONFIG_URL_SIZE     129       // 128 characters
+#define CONFIG_BODY_SIZE    2048      // Budget of a POST /api/config body
+
+// New fields are only appended, older blobs are loaded as a prefix over the defaults.
+// Keep it free of padding, changes are detected by comparing the bytes.
+struct config_t {
+  char hostName[CONFIG_STRING_SIZE] = "ogotoilet";
+  char otaPassword[CONFIG_STRING_SIZE] = "";
+  char mqttHost[CONFIG_STRING_SIZE] = "localhost";
+  char mqttTopic[CONFIG_STRING_SIZE] = "verges/toilet";
+  char mqttUser[CONFIG_STRING_SIZE] = "";
+  char mqttPass[CONFIG_STRING_SIZE] = "";
+  uint16_t mqttPort = 1883;
+  uint32_t runMixerAfter = 24*60*60*1000;
+  uint32_t maxFanRpm = 3000;
+  float pidKp = 0.5;
+  float pidKi = 0.5;
+  float pidKd = 0;
+  int8_t noMixerBelowTempC = 10;
+  uint8_t overrideSpeed = 25;
+  uint8_t humidityThr = 75;
+  uint8_t humiditySpeed = 80;
+  uint8_t tachoPpr = 2;
+  uint8_t powerMode = 0;          // power_mode_t
+  uint8_t sensorAggregate = 0;    // sensor_aggregate_t
+  bool enableWifi = true;
+  bool enableSoftAp = true;
+  bool enableMqtt = false;
+  bool overrideSpeedPoti = false;
+  bool statusDelta = false;
+  bool closedLoop = false;
+  bool perfEnabled = true;
+  bool perfMqtt = false;
+  uint8_t reserved = 0;
+  uint16_t updateInterval = 360;  // Minutes between the checks of the update manifest
+  char updateUrl[CONFIG_URL_SIZE] = "";
+  bool autoUpdate = false;        // Install a new version from the manifest without asking
+};
+
+struct configheader_t {
+  uint16_t version;
+  uint16_t size;          // sizeof(config_t) of the firmware that wrote the blob
+  uint32_t crc;           // CRC-32 of the config_t bytes
+};
+
+enum config_source_t : uint8_t {
+  CONFIG_SOURCE_DEFAULTS,
+  CONFIG_SOURCE_BLOB,
+  CONFIG_SOURCE_MIGRATED    // Converted from the per-key layout of older firmware
+};
+
+class ConfigClass {
+    public:
+        // Loads the blob once, later reads are served from RAM
+        void begin(const char *nvsNamespace);
+
+        const config_t &get() { return config; }
+        config_t &edit() { return config; }
+
+        // Writes the blob only if it differs from the stored one, false on errors
+        bool save();
+        bool isDirty() { return memcmp(&config, &stored, sizeof(config_t)) != 0; }
+
+        config_source_t getSource() { return source; }
+        uint32_t getWrites() { return writes; }
+        uint32_t getSkippedWrites() { return skippedWrites; }
+
+        // Copy with a length check, false if the value does not fit
+        static bool copyString(char *target, const char *value, size_t size = CONFIG_STRING_SIZE);
+
+    private:
+        const char *nvsNamespace = NULL;
+        config_t config;
+        config_t stored;          // Content of the NVS blob, to skip unchanged saves
+        config_source_t source = CONFIG_SOURCE_DEFAULTS;
+        uint32_t writes = 0;
+        uint32_t skippedWrites = 0;
+
+        bool load(Preferences &prefs, bool &outdated);
+        void migrate(Preferences &prefs);
+        bool write(Preferences &prefs);
+};
+
+#endif // CONFIG_h
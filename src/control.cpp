@@ -0,0 +1,109 @@
+/**
+ * @file control.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Mixer and fan speed decisions, shared by the firmware and the host simulator
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include "control.h"
+#include "log.h"
+#include "pins.h"
+
+void runMixerControl() {
+  // Do not continue regular operation as long as a OTA is running
+  // Reason: Background workload can cause upgrade issues that we want to avoid!
+  if (otaRunning) return;
+  controlMixer();
+}
+
+void runSpeedControl(float elapsed) {
+  if (otaRunning) return;
+
+  // Without a usable sample the last values are kept
+  float temperature, humidity;
+  if (readClimate(temperature, humidity)) {
+    currentTemperature = temperature;
+    currentHumidity = humidity;
+  }
+
+  controlSpeed();
+  controlFan(elapsed);
+  setPowerBusy(targetPwmSpeed > 0 || stateMixer);
+}
+
+void controlMixer() {
+  // When the Mixer of the toilet is active, we have a 12V Signal on the MIXER_STATUS_PIN using
+  // a voltage devider ~12 to ~3V. We use that signal to reset the mixer timer so that
+  // we can run it after X hours of the last run.
+  stateMixer = digitalRead(MIXER_STATUS_PIN);
+  if (stateMixer) {
+    lastMixerRun = runtime();
+    LOG_INFO_LN("MIXER - runs now!");
+  } else if (runtime() - lastMixerRun > runMixerAfter) {
+    // Some time has passed, we run the mixer using a transistor on MIXER_START_PIN to improve the rotting
+    if (currentTemperature > noMixerBelowTempC) {
+      activateMixer();
+    } else {
+      LOG_INFO(F("[INFO] Temerature below configured limit, not running the mixer. Next retry after configured timeout."));
+    }
+    lastMixerRun = runtime();
+  }
+}
+
+void controlSpeed() {
+  // If the engine is running, we have a D+ signal on the DPLUS_PIN using a voltage devider ~12 to ~3V
+  // When the signal is running, the fan should run on 100% speed to improve toilet drying
+  // While the mixer is working, we again want to get full speed fan.
+  stateDplus = digitalRead(DPLUS_PIN);
+  if (stateDplus || stateMixer) {
+    // LOG_INFO_LN("DPLUS active, max power!");
+    digitalWrite(LED_BUILTIN, HIGH);
+    targetPwmSpeed = PWM_MAX_DUTY_CYCLE;
+  } else {
+    digitalWrite(LED_BUILTIN, LOW);
+    uint16_t potiRead = analogRead(SPEED_PIN);
+    statePoti = map(potiRead, 0, MAX_ADC_VALUE, 0, 100);
+    if (currentHumidity >= humidityThr && humidityThr > 0) {
+      stateDehumidification = true;
+      // Dehumidification required, overruling all other options
+      if (humiditySpeed >= 100) targetPwmSpeed = PWM_MAX_DUTY_CYCLE;
+      else targetPwmSpeed = map(humiditySpeed, 0, 100, 0, PWM_MAX_DUTY_CYCLE);
+    } else {
+      stateDehumidification = false;
+      if (overrideSpeedPoti) {
+        // Ignore potentiometer, use config value
+        if (overrideSpeed >= 100) targetPwmSpeed = PWM_MAX_DUTY_CYCLE;
+        else if(overrideSpeed <= 0) targetPwmSpeed = 0; // it's uint8, this should never happen ;)
+        else targetPwmSpeed = map(overrideSpeed, 0, 100, 0, PWM_MAX_DUTY_CYCLE);
+      } else {
+        targetPwmSpeed = map(potiRead, 0, MAX_ADC_VALUE, 0, PWM_MAX_DUTY_CYCLE);
+      }
+    }
+  }
+}
+
+void controlFan(float elapsed) {
+  // Without tacho pulses the PID only sees 0 RPM and winds up to 100%. The fan runs open loop
+  // until pulses arrive again, e.g. without a tacho wire, with a blocked fan or from standstill.
+  bool openLoop = !closedLoop || isFanStalled();
+  if (closedLoop && openLoop != fanOpenLoop) {
+    if (openLoop) LOG_INFO_LN(F("[FAN] No tacho signal, running open loop"));
+    else LOG_INFO_LN(F("[FAN] Tacho signal is back, running closed loop"));
+  }
+  fanOpenLoop = openLoop;
+  if (openLoop) {
+    FanPid.reset();
+    ledcWrite(PWM_CHANNEL, targetPwmSpeed);
+  } else {
+    // The requested speed becomes a RPM setpoint, the PID corrects voltage drift and fan wear
+    float setpoint = (float)targetPwmSpeed / PWM_MAX_DUTY_CYCLE;
+    float output = FanPid.update(setpoint, (float)readFanRpm() / maxFanRpm, elapsed, millis());
+    ledcWrite(PWM_CHANNEL, output * PWM_MAX_DUTY_CYCLE);
+  }
+}
@@ -0,0 +1,67 @@
+/**
+ * @file control.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Mixer and fan speed decisions, shared by the firmware and the host simulator
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef CONTROL_h
+#define CONTROL_h
+
+#include "hal.h"
+#include "pid.h"
+
+#define RUNTIME_RESTART_MARGIN  (1000ULL * 60 * 60 * 24)   // Restart this long before runtime() overflows
+
+// Settings and state, defined in global.h and main.cpp or by the simulator
+extern unsigned long runMixerAfter;
+extern uint64_t lastMixerRun;
+extern int8_t noMixerBelowTempC;
+extern unsigned int targetPwmSpeed;
+extern bool overrideSpeedPoti;
+extern uint8_t overrideSpeed;
+extern uint8_t humidityThr;
+extern uint8_t humiditySpeed;
+
+extern float currentTemperature;
+extern float currentHumidity;
+extern bool stateMixer;
+extern bool stateDplus;
+extern uint8_t statePoti;
+extern bool stateDehumidification;
+
+extern bool otaRunning;
+extern bool closedLoop;
+extern uint32_t maxFanRpm;
+extern bool fanOpenLoop;
+extern PidController FanPid;
+
+// Hardware behind the jobs, implemented in global.h and by the simulator
+void activateMixer();
+bool readClimate(float &temperature, float &humidity);   // Aggregate of all sensors, false without a usable sample
+uint32_t readFanRpm();
+bool isFanStalled();                                     // No tacho pulses, also without a tacho wire
+void setPowerBusy(bool busy);
+
+// Bodies of the mixer and speed jobs, both pause while an OTA is running
+void runMixerControl();
+void runSpeedControl(float elapsed);
+
+// Track the mixer and start it after runMixerAfter without a run
+void controlMixer();
+// Calculate targetPwmSpeed from D+, mixer, humidity and the potentiometer
+void controlSpeed();
+// Drive the fan PWM from targetPwmSpeed, elapsed is the time since the last call in seconds
+void controlFan(float elapsed);
+
+inline bool runtimeNearOverflow(uint64_t now) {
+  return now > UINT64_MAX - RUNTIME_RESTART_MARGIN;
+}
+
+#endif // CONTROL_h
@@ -0,0 +1,98 @@
+/**
+ * @file dht22.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Non-blocking DHT22 driver using the RMT peripheral
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <esp_pm.h>
+#include "dht22.h"
+#include "log.h"
+#include "perf.h"
+
+bool DHT22Class::begin(int pin, rmt_channel_t channel) {
+  this->pin = (gpio_num_t)pin;
+  this->channel = channel;
+
+  rmt_config_t config = RMT_DEFAULT_CONFIG_RX(this->pin, channel);
+  config.clk_div = 80;                            // 1µs per tick
+  config.rx_config.filter_en = true;
+  config.rx_config.filter_ticks_thresh = 100;     // Ignore glitches below 1.25µs (APB cycles)
+  config.rx_config.idle_threshold = DHT22_IDLE_US;
+  if (rmt_config(&config) != ESP_OK || rmt_driver_install(channel, 512, 0) != ESP_OK) {
+    LOG_INFO_LN(F("[DHT22] Unable to configure the RMT receiver"));
+    return false;
+  }
+  rmt_get_ringbuf_handle(channel, &ringbuffer);
+
+  // Open drain with pull up, the start signal is driven by the GPIO while the RMT listens on the same pin
+  gpio_set_pull_mode(this->pin, GPIO_PULLUP_ONLY);
+  gpio_set_level(this->pin, 1);
+  gpio_set_direction(this->pin, GPIO_MODE_INPUT_OUTPUT_OD);
+  return ringbuffer != NULL;
+}
+
+dht_result_t DHT22Class::transaction(dhtreading_t &reading) {
+  // Drop whatever is left from an earlier, incomplete transmission
+  size_t length = 0;
+  void *stale;
+  while ((stale = xRingbufferReceive(ringbuffer, &length, 0)) != NULL) vRingbufferReturnItem(ringbuffer, stale);
+
+#ifdef CONFIG_PM_ENABLE
+  // The RMT does not capture in light sleep
+  static esp_pm_lock_handle_t noSleepLock = NULL;
+  if (noSleepLock == NULL) esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "dht22", &noSleepLock);
+  if (noSleepLock) esp_pm_lock_acquire(noSleepLock);
+#endif
+
+  // Start signal of 1-2ms (tick granularity), the task sleeps meanwhile and interrupts stay enabled
+  gpio_set_level(pin, 0);
+  vTaskDelay(pdMS_TO_TICKS(DHT22_START_MS));
+  rmt_rx_start(channel, true);
+  gpio_set_level(pin, 1);
+
+  rmt_item32_t *items = (rmt_item32_t *)xRingbufferReceive(ringbuffer, &length, pdMS_TO_TICKS(DHT22_TIMEOUT_MS));
+  rmt_rx_stop(channel);
+
+#ifdef CONFIG_PM_ENABLE
+  if (noSleepLock) esp_pm_lock_release(noSleepLock);
+#endif
+  if (items == NULL) return DHT_ERROR_TIMEOUT;
+
+  // Only the CPU work, the start signal and the capture above are spent sleeping
+  PERF_SCOPE(PERF_PROBE_DHT);
+  size_t count = 0;
+  for (size_t i = 0; i < length / sizeof(rmt_item32_t) && count + 2 <= DHT22_MAX_PULSES; i++) {
+    if (items[i].duration0) pulses[count++] = { (uint8_t)items[i].level0, (uint16_t)items[i].duration0 };
+    if (items[i].duration1) pulses[count++] = { (uint8_t)items[i].level1, (uint16_t)items[i].duration1 };
+  }
+  vRingbufferReturnItem(ringbuffer, items);
+
+  return dht22Decode(pulses, count, reading);
+}
+
+dht_result_t DHT22Class::read(dhtreading_t &reading, uint8_t retries) {
+  if (ringbuffer == NULL) return DHT_ERROR_TIMEOUT;
+
+  dht_result_t result;
+  for (uint8_t attempt = 0; ; attempt++) {
+    result = transaction(reading);
+    reads++;
+    switch (result) {
+      case DHT_ERROR_TIMEOUT: timeouts++; break;
+      case DHT_ERROR_PULSE:   pulseErrors++; break;
+      case DHT_ERROR_CRC:     crcErrors++; break;
+      default: break;
+    }
+    if (result == DHT_OK || attempt >= retries) break;
+    retryCount++;
+    vTaskDelay(pdMS_TO_TICKS(DHT22_RETRY_DELAY_MS));
+  }
+  return result;
+}
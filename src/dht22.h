@@ -0,0 +1,54 @@
+/**
+ * @file dht22.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Non-blocking DHT22 driver using the RMT peripheral
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef DHT22_h
+#define DHT22_h
+
+#include <Arduino.h>
+#include <driver/rmt.h>
+#include "dht22decoder.h"
+
+#define DHT22_START_MS        2     // Host start signal, pull the line low for at least 1ms
+#define DHT22_TIMEOUT_MS      20    // A transmission takes ~5ms
+#define DHT22_MAX_PULSES      96    // Start, acknowledge, 40 bits and the stop bit with some margin
+#define DHT22_RETRY_DELAY_MS  2000  // The sensor needs 2s between two transactions
+#define DHT22_TASK_STACK      3072  // Room for the float formatting of the log output
+
+class DHT22Class {
+    public:
+        bool begin(int pin, rmt_channel_t channel = RMT_CHANNEL_0);
+        // One transaction for temperature and humidity, only the calling task waits
+        dht_result_t read(dhtreading_t &reading, uint8_t retries = 0);
+
+        uint32_t getReads() { return reads; }
+        uint32_t getCrcErrors() { return crcErrors; }
+        uint32_t getTimeouts() { return timeouts; }
+        uint32_t getPulseErrors() { return pulseErrors; }
+        uint32_t getRetries() { return retryCount; }
+
+    private:
+        gpio_num_t pin;
+        rmt_channel_t channel;
+        RingbufHandle_t ringbuffer = NULL;
+        dhtpulse_t pulses[DHT22_MAX_PULSES];
+
+        uint32_t reads = 0;
+        uint32_t crcErrors = 0;
+        uint32_t timeouts = 0;
+        uint32_t pulseErrors = 0;
+        uint32_t retryCount = 0;
+
+        dht_result_t transaction(dhtreading_t &reading);
+};
+
+#endif // DHT22_h
@@ -0,0 +1,77 @@
+/**
+ * @file dht22decoder.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Decoder for the DHT22 pulse train as captured by the RMT peripheral
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef DHT22DECODER_h
+#define DHT22DECODER_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+// No Arduino dependency on purpose, recorded pulse traces can be decoded on the host
+#define DHT22_BITS            40
+#define DHT22_BIT_LOW_MIN     30    // Each bit starts with ~50µs low
+#define DHT22_BIT_LOW_MAX     90
+#define DHT22_BIT_HIGH_MIN    10    // followed by ~26µs high for a 0
+#define DHT22_BIT_THRESHOLD   48
+#define DHT22_BIT_HIGH_MAX    100   // or ~70µs high for a 1
+#define DHT22_IDLE_US         200   // A longer high level ends the transmission
+
+enum dht_result_t : uint8_t {
+  DHT_OK,
+  DHT_ERROR_TIMEOUT,    // No or not enough pulses received
+  DHT_ERROR_PULSE,      // A pulse outside of the specified timing
+  DHT_ERROR_CRC
+};
+
+struct dhtpulse_t {
+  uint8_t level;
+  uint16_t duration;    // µs
+};
+
+struct dhtreading_t {
+  float temperature;    // °C
+  float humidity;       // %
+};
+
+// Temperature and humidity are decoded from the same 40 bit transmission.
+// Only the last 40 bits are used, so the host start pulse and the sensor
+// acknowledge may or may not be part of the trace.
+inline dht_result_t dht22Decode(const dhtpulse_t *pulses, size_t count, dhtreading_t &reading) {
+  // Skip the low level of the stop bit and the idle level, if captured
+  size_t i = count;
+  while (i > 0 && (pulses[i - 1].level == 0 || pulses[i - 1].duration >= DHT22_IDLE_US)) i--;
+
+  uint8_t data[5] = {};
+  uint8_t bits = 0;
+  while (bits < DHT22_BITS && i >= 2) {
+    const dhtpulse_t &high = pulses[--i];
+    const dhtpulse_t &low = pulses[--i];
+    if (high.level != 1 || low.level != 0) return DHT_ERROR_PULSE;
+    if (high.duration < DHT22_BIT_HIGH_MIN || high.duration > DHT22_BIT_HIGH_MAX) return DHT_ERROR_PULSE;
+    if (low.duration < DHT22_BIT_LOW_MIN || low.duration > DHT22_BIT_LOW_MAX) return DHT_ERROR_PULSE;
+
+    // Bits are collected from the end, the last one is the LSB of the checksum
+    uint8_t bit = DHT22_BITS - 1 - bits;
+    if (high.duration > DHT22_BIT_THRESHOLD) data[bit / 8] |= 0x80 >> (bit % 8);
+    bits++;
+  }
+  if (bits < DHT22_BITS) return DHT_ERROR_TIMEOUT;
+  if ((uint8_t)(data[0] + data[1] + data[2] + data[3]) != data[4]) return DHT_ERROR_CRC;
+
+  reading.humidity = ((data[0] << 8) | data[1]) / 10.f;
+  reading.temperature = (((data[2] & 0x7F) << 8) | data[3]) / 10.f;
+  if (data[2] & 0x80) reading.temperature = -reading.temperature;
+  return DHT_OK;
+}
+
+#endif // DHT22DECODER_h
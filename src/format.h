@@ -0,0 +1,140 @@
+/**
+ * @file format.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Allocation free formatting of values into caller supplied buffers
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef FORMAT_h
+#define FORMAT_h
+
+#include <Arduino.h>
+#include <type_traits>
+
+#define FORMAT_SCRATCH_SIZE 32   // Enough for any number or IP address
+
+// Writes into a fixed buffer and never allocates, output that does not fit is truncated.
+// The buffer is always NUL terminated.
+class BufferWriter : public Print {
+    public:
+        BufferWriter(char *buffer, size_t size) : buffer(buffer), size(size) {
+            if (size) buffer[0] = '\0';
+        }
+
+        size_t write(uint8_t c) override { return write(&c, 1); }
+        size_t write(const uint8_t *data, size_t len) override {
+            if (size == 0) return 0;
+            size_t chunk = min(len, size - 1 - length);
+            memcpy(buffer + length, data, chunk);
+            length += chunk;
+            buffer[length] = '\0';
+            return chunk;
+        }
+
+        template<typename T> size_t print(const T &value) {
+            size_t before = length;
+            append(value);
+            return length - before;
+        }
+        template<typename T> size_t println(const T &value) {
+            size_t written = print(value);
+            return written + print('\n');
+        }
+
+        // Fixed point output like Print::printFloat(), including the rounding
+        size_t printFloat(double value, uint8_t digits) {
+            size_t before = length;
+            if (isnan(value)) append("nan");
+            else if (isinf(value)) append(value < 0 ? "-inf" : "inf");
+            else if (value > 4294967040.0 || value < -4294967040.0) append("ovf");
+            else {
+                if (value < 0.0) {
+                    append('-');
+                    value = -value;
+                }
+                double rounding = 0.5;
+                for (uint8_t i = 0; i < digits; i++) rounding /= 10.0;
+                value += rounding;
+
+                uint32_t intPart = (uint32_t)value;
+                double remainder = value - (double)intPart;
+                append(intPart);
+                if (digits > 0) append('.');
+                while (digits-- > 0) {
+                    remainder *= 10.0;
+                    uint8_t digit = (uint8_t)remainder;
+                    append((char)('0' + digit));
+                    remainder -= digit;
+                }
+            }
+            return length - before;
+        }
+
+        const char *c_str() const { return buffer; }
+        size_t getLength() const { return length; }
+        bool full() const { return size == 0 || length >= size - 1; }
+        void clear() {
+            length = 0;
+            if (size) buffer[0] = '\0';
+        }
+
+    private:
+        char *buffer;
+        size_t size;
+        size_t length = 0;
+
+        void append(const char *value) { write((const uint8_t *)value, strlen(value)); }
+        void append(const String &value) { write((const uint8_t *)value.c_str(), value.length()); }
+        void append(const __FlashStringHelper *value) { append((const char *)value); }
+        void append(const Printable &value) { value.printTo(*this); }
+        void append(char value) { write((uint8_t)value); }
+        void append(bool value) { write((uint8_t)(value ? '1' : '0')); }
+
+        template<typename T>
+        typename std::enable_if<std::is_integral<T>::value>::type append(T value) {
+            typedef typename std::make_unsigned<T>::type unsigned_t;
+            char digits[24];
+            char *pos = digits + sizeof(digits);
+            unsigned_t number = (unsigned_t)value;
+            bool negative = std::is_signed<T>::value && value < (T)0;
+            if (negative) number = (unsigned_t)0 - number;
+            do {
+                *--pos = '0' + number % 10;
+                number /= 10;
+            } while (number);
+            if (negative) *--pos = '-';
+            write((const uint8_t *)pos, digits + sizeof(digits) - pos);
+        }
+
+        template<typename T>
+        typename std::enable_if<std::is_floating_point<T>::value>::type append(T value) {
+            printFloat(value, 2);
+        }
+};
+
+// Returns the formatted bytes of a value. Strings are passed through without a copy,
+// everything else is formatted into the given scratch buffer.
+struct FormatView {
+    const char *data;
+    size_t length;
+};
+
+template<typename T> FormatView formatView(char *scratch, size_t size, const T &value) {
+    BufferWriter writer(scratch, size);
+    writer.print(value);
+    return { scratch, writer.getLength() };
+}
+inline FormatView formatView(char *scratch, size_t size, const char *value) { return { value, strlen(value) }; }
+inline FormatView formatView(char *scratch, size_t size, char *value) { return { value, strlen(value) }; }
+inline FormatView formatView(char *scratch, size_t size, const String &value) { return { value.c_str(), value.length() }; }
+inline FormatView formatView(char *scratch, size_t size, const __FlashStringHelper *value) {
+    return formatView(scratch, size, (const char *)value);
+}
+
+#endif // FORMAT_h
@@ -16,10 +16,28 @@
 #include <LittleFS.h>
 #include <Preferences.h>
 #include "MQTTclient.h"
+#include "assets.h"
+#include "bench.h"
+#include "config.h"
+#include "control.h"
+#include "dht22.h"
+#include "history.h"
+#include "historylog.h"
+#include "otapull.h"
+#include "otawriter.h"
+#include "perf.h"
+#include "pid.h"
+#include "pins.h"
+#include "power.h"
+#include "scheduler.h"
+#include "sensors.h"
+#include "status.h"
+#include "tacho.h"
+#include "telemetry.h"
 #include "wifimanager.h"
 
 #define webserverPort 80                    // Start the Webserver on this port
-#define NVS_NAMESPACE "ogotoilet"           // Preferences.h namespace to store settings
+#define NVS_NAMESPACE "ogotoilet"           // Preferences.h namespace of the Config blob
 
 #include <SPI.h>
 #include <Wire.h>
@@ -28,29 +46,18 @@
 #define TIME_TO_SLEEP    10                // WakeUp interval
 
 
-const int TACHO_PIN = GPIO_NUM_25;                // Digital Input Pin
-const int DPLUS_PIN = GPIO_NUM_35;                // Digital Input Pin
-const int SPEED_PIN = GPIO_NUM_34;                // Potentiometer ADC Pin
-
-const int DHT22_PIN = GPIO_NUM_26;                // DHT22 Data Pin
-
-const int PWM_PIN = GPIO_NUM_0;                   // PWM Pin
-const int PWM_CHANNEL = 0;                        // PWM Channel to assign
-const int PWM_MAX_DUTY_CYCLE = (int)(pow(2, 10)-1); // 10 Bit == 1024
-
-const int MIXER_STATUS_PIN = GPIO_NUM_33;         // Digital Input Pin
-const int MIXER_START_PIN = GPIO_NUM_27;          // Digital Output Pin to activate transistor
-
 unsigned long runMixerAfter = 24*60*60*1000;      // Automatically run the MIXER after some time (24h)
 uint64_t lastMixerRun = 0;                        // Last time the MIXER was active
 int8_t noMixerBelowTempC = 10;                    // Temperature under which the mixer won't run to prevent damage
-unsigned long lastTachoInterrupt = 0;             // Microseconds of the last TACHO interrupt (pull down)
-unsigned int tachoDelay = 0;
 unsigned int targetPwmSpeed = PWM_MAX_DUTY_CYCLE * 0.25; // 0-1023 equals 0-100%, default to 25% speed
 bool overrideSpeedPoti = false;                   // Ignore the SPEED_PIN potentiometer value
 uint8_t overrideSpeed = 25;                       // If override==true, set the fan speed to this value
 uint8_t humidityThr = 75;                         // Threshold value to speed up on humidity level >= X
 uint8_t humiditySpeed = 80;                       // If humitidy >= Threshold, set the fan speed to this value
+bool perfMqtt = false;                            // Publish the /api/perf summary with the service check
+bool closedLoop = false;                          // Regulate the fan RPM using the tacho signal instead of a fixed PWM duty
+uint32_t maxFanRpm = 3000;                        // RPM of the fan at 100% PWM, setpoints are relative to it
+bool fanOpenLoop = false;                          // Closed loop is paused as there is no tacho signal
 
 bool otaRunning = false;
 
@@ -70,6 +77,9 @@ RTC_DATA_ATTR struct timing_t {
   // Check mixer usage
   uint64_t lastMixerUpdate = 0;                  // last millis() from Status report
   const unsigned int mixerUpdateInterval = 250;  // Interval in ms to execute code
+
+  // Live status to the WebSocket clients, TELEMETRY_TICK_MS while any is connected
+  uint64_t lastTelemetryUpdate = 0;               // last millis() from Telemetry tick
 } Timing;
 
 RTC_DATA_ATTR uint64_t sleepTime = 0;       // Time that the esp32 slept
@@ -82,17 +92,48 @@ struct Button {
   bool pressed;
 };
 Button button1 = {GPIO_NUM_14, false};       // Run the setup (use a RTC GPIO)
+TaskHandle_t loopTaskHandle = NULL;           // Notified to wake up loop() before the next deadline
+
 void IRAM_ATTR ISR_button1() {
   button1.pressed = true;
+  if (loopTaskHandle) vTaskNotifyGiveFromISR(loopTaskHandle, NULL);
 }
 
 String hostName;
 AsyncWebServer webServer(webserverPort);
 AsyncEventSource events("/api/events");
-Preferences preferences;
+TelemetryClass Telemetry("/api/ws");
+AssetHandler *Assets = NULL;                  // Created in APIRegisterRoutes(), owned by the webServer
+ConfigClass Config;
+OtaWriterClass OtaWriter;
+OtaPullClass OtaPull;
 
 MQTTclient Mqtt;
 
+// Topics in the MQTT publish table, see Mqtt.addSlot() in setup()
+enum mqtt_topic_t : uint8_t {
+  MQTT_JSON,
+  MQTT_FAN_RPM,
+  MQTT_MIXER,
+  MQTT_DPLUS,
+  MQTT_DEHUMIDIFICATION,
+  MQTT_POTENTIOMETER,
+  MQTT_PWM_SPEED,
+  MQTT_TEMPERATURE,
+  MQTT_HUMIDITY,
+  MQTT_PERF
+};
+StatusSerializer StatusReport;
+TachoClass Tacho;
+PidController FanPid;
+HistoryStore History;
+HistoryLogClass HistoryLog;
+SchedulerClass Scheduler;
+PowerClass Power;
+PerfClass Perf;
+DHT22Class Dht;
+SensorsClass Sensors;
+
 // Current system runtime in MS
 uint64_t runtime() {
   return rtc_time_slowclk_to_us(rtc_time_get(), esp_clk_slowclk_cal_get()) / 1000;
@@ -100,6 +141,8 @@ uint64_t runtime() {
 
 void deepsleepForSeconds(int seconds) {
     esp_sleep_enable_timer_wakeup(seconds * uS_TO_S_FACTOR);
+    HistoryLog.flush();
+    LogSink.flush();
     esp_deep_sleep_start();
 }
 
@@ -129,10 +172,10 @@ void print_wakeup_reason() {
 
 // Check if a feature is enabled, that prevents the
 // deep sleep mode of our ESP32 chip.
-void sleepOrDelay() {
+void sleepOrDelay(uint32_t idleMs = 50) {
   if (enableWifi || enableMqtt) {
-    yield();
-    delay(50);
+    // Idle until the given time passed or loop() gets notified
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(max(idleMs, (uint32_t)1)));
   } else {
     // We can save a lot of power by going into deepsleep
     // Thid disables WIFI and everything.
@@ -142,22 +185,31 @@ void sleepOrDelay() {
     rtc_gpio_pulldown_dis(button1.PIN);
     esp_sleep_enable_ext0_wakeup(button1.PIN, 0);
 
-    preferences.end();
     LOG_INFO_LN(F("[POWER] Sleeping..."));
+    HistoryLog.flush();
+    LogSink.flush();
     esp_deep_sleep_start();
   }
 }
 
 const uint8_t mixerTimerID = 0;
 hw_timer_t *MixerTimer = NULL;
+volatile bool mixerEnded = false;             // Set by the timer ISR, logged by loop()
 void IRAM_ATTR _endMixerOutputPin() {
-  LOG_INFO_LN("_endMixerOutputPin()");
+  mixerEnded = true;
+  if (loopTaskHandle) vTaskNotifyGiveFromISR(loopTaskHandle, NULL);
   digitalWrite(MIXER_START_PIN, LOW);
   if (MixerTimer) {
     timerEnd(MixerTimer);
     MixerTimer = NULL;
   }
 }
+// Hardware behind control.cpp
+bool readClimate(float &temperature, float &humidity) { return Sensors.aggregate(temperature, humidity); }
+uint32_t readFanRpm() { return Tacho.getRpm(); }
+bool isFanStalled() { return Tacho.isStalled(); }
+void setPowerBusy(bool busy) { Power.setBusy(busy || MixerTimer != NULL); }
+
 void activateMixer() {
   LOG_INFO_LN("activateMixer()");
   digitalWrite(MIXER_START_PIN, HIGH);
@@ -0,0 +1,53 @@
+/**
+ * @file hal.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Hardware functions used by the control logic
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef HAL_h
+#define HAL_h
+
+#ifndef NATIVE
+#include <Arduino.h>
+#else
+// Built with the native environment, sim/hal.cpp implements these against the plant model
+#include <math.h>
+#include <stdint.h>
+
+#define LOW             0
+#define HIGH            1
+#define LED_BUILTIN     2
+
+#define GPIO_NUM_0      0
+#define GPIO_NUM_21     21
+#define GPIO_NUM_22     22
+#define GPIO_NUM_25     25
+#define GPIO_NUM_26     26
+#define GPIO_NUM_27     27
+#define GPIO_NUM_33     33
+#define GPIO_NUM_34     34
+#define GPIO_NUM_35     35
+
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+uint16_t analogRead(uint8_t pin);
+void ledcWrite(uint8_t channel, uint32_t duty);
+unsigned long millis();
+unsigned long micros();
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+#endif
+
+// Current system runtime in MS, survives the deep sleep
+uint64_t runtime();
+
+#endif // HAL_h
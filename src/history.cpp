@@ -0,0 +1,308 @@
+/**
+ * @file history.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Tiered in-memory time series of the status reports
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include "format.h"
+#include "history.h"
+#include "log.h"
+
+template<typename T> T *HistoryStore::allocate(uint16_t count) {
+  T *data = (T *)calloc(count, sizeof(T));
+  if (data) memoryUsage += count * sizeof(T);
+  return data;
+}
+
+bool HistoryStore::begin() {
+  const uint16_t config[HISTORY_TIERS][2] = HISTORY_TIER_CONFIG;
+  ready = true;
+  for (uint8_t t = 0; t < HISTORY_TIERS; t++) {
+    historytier_t &tier = tiers[t];
+    tier.resolution = config[t][0];
+    tier.capacity = config[t][1];
+    tier.accumulator.samples = 0;
+
+    bool aggregated = t > 0;
+    if (!aggregated) tier.time = allocate<uint32_t>(tier.capacity);
+    tier.temperature = allocate<int16_t>(tier.capacity);
+    tier.humidity = allocate<uint8_t>(tier.capacity);
+    if (aggregated) {
+      tier.temperatureMin = allocate<int16_t>(tier.capacity);
+      tier.temperatureMax = allocate<int16_t>(tier.capacity);
+      tier.humidityMin = allocate<uint8_t>(tier.capacity);
+      tier.humidityMax = allocate<uint8_t>(tier.capacity);
+    }
+    tier.rpm = allocate<uint16_t>(tier.capacity);
+    tier.pwm = allocate<uint8_t>(tier.capacity);
+    tier.flags = allocate<uint8_t>(tier.capacity);
+
+    if (!tier.temperature || !tier.humidity || !tier.rpm || !tier.pwm || !tier.flags
+        || (!aggregated && !tier.time)
+        || (aggregated && (!tier.temperatureMin || !tier.temperatureMax || !tier.humidityMin || !tier.humidityMax))) {
+      LOG_INFO_F("[HISTORY] Unable to allocate tier %u, history is disabled\n", t);
+      ready = false;
+      return false;
+    }
+  }
+  LOG_INFO_F("[HISTORY] Keeping %u tiers in %u bytes of RAM\n", HISTORY_TIERS, memoryUsage);
+  return true;
+}
+
+// Append a slot to the ring, overwriting the oldest one if full
+uint16_t HistoryStore::push(historytier_t &tier) {
+  tier.head = tier.count == 0 ? 0 : (tier.head + 1) % tier.capacity;
+  if (tier.count < tier.capacity) tier.count++;
+  return tier.head;
+}
+
+// Store the accumulated bucket, missing buckets in between are marked as invalid
+bool HistoryStore::commit(historytier_t &tier, historyrow_t &row) {
+  historyaccumulator_t &acc = tier.accumulator;
+  if (tier.count > 0 && acc.bucket <= tier.lastBucket) {
+    acc.samples = 0;
+    return false;
+  }
+  if (tier.count > 0) {
+    uint32_t gap = min(acc.bucket - tier.lastBucket - 1, (uint32_t)tier.capacity);
+    for (uint32_t i = 0; i < gap; i++) tier.flags[push(tier)] = 0;
+  }
+
+  uint16_t i = push(tier);
+  if (acc.temperatureCount) {
+    tier.temperature[i] = acc.temperatureSum / acc.temperatureCount;
+    tier.temperatureMin[i] = acc.temperatureMin;
+    tier.temperatureMax[i] = acc.temperatureMax;
+  } else {
+    tier.temperature[i] = tier.temperatureMin[i] = tier.temperatureMax[i] = HISTORY_NO_TEMPERATURE;
+  }
+  if (acc.humidityCount) {
+    tier.humidity[i] = acc.humiditySum / acc.humidityCount;
+    tier.humidityMin[i] = acc.humidityMin;
+    tier.humidityMax[i] = acc.humidityMax;
+  } else {
+    tier.humidity[i] = tier.humidityMin[i] = tier.humidityMax[i] = HISTORY_NO_HUMIDITY;
+  }
+  tier.rpm[i] = acc.rpmSum / acc.samples;
+  tier.pwm[i] = acc.pwmSum / acc.samples;
+  tier.flags[i] = acc.flags | HISTORY_FLAG_VALID;
+  tier.lastBucket = acc.bucket;
+  acc.samples = 0;
+
+  readSlot(tier, i, row);
+  row.time = tier.lastBucket * tier.resolution;
+  return true;
+}
+
+// Called on each status report, downsampling into the aggregated tiers is done on insert
+void HistoryStore::add(uint32_t time, const status_t &status) {
+  if (!ready) return;
+
+  int16_t temperature = isnan(status.stateTemperature) ? HISTORY_NO_TEMPERATURE
+    : (int16_t)constrain(lroundf(status.stateTemperature * 100.f), -32767L, 32767L);
+  uint8_t humidity = isnan(status.stateHumidity) ? HISTORY_NO_HUMIDITY
+    : (uint8_t)constrain(lroundf(status.stateHumidity * 2.f), 0L, 254L);
+  uint16_t rpm = min(status.stateFanRpm, (uint32_t)UINT16_MAX);
+  uint8_t flags = (status.stateDplus ? HISTORY_FLAG_DPLUS : 0)
+    | (status.stateMixer ? HISTORY_FLAG_MIXER : 0)
+    | (status.stateDehumidification ? HISTORY_FLAG_DEHUMIDIFICATION : 0)
+    | (status.stateFanStalled ? HISTORY_FLAG_STALLED : 0);
+
+  historyrow_t committed[HISTORY_TIERS];
+  bool hasCommitted[HISTORY_TIERS] = {};
+
+  portENTER_CRITICAL(&lock);
+  historytier_t &raw = tiers[0];
+  uint16_t i = push(raw);
+  raw.time[i] = time;
+  raw.temperature[i] = temperature;
+  raw.humidity[i] = humidity;
+  raw.rpm[i] = rpm;
+  raw.pwm[i] = status.statePwmSpeed;
+  raw.flags[i] = flags | HISTORY_FLAG_VALID;
+
+  for (uint8_t t = 1; t < HISTORY_TIERS; t++) {
+    historytier_t &tier = tiers[t];
+    historyaccumulator_t &acc = tier.accumulator;
+    uint32_t bucket = time / tier.resolution;
+    if (acc.samples && bucket != acc.bucket) hasCommitted[t] = commit(tier, committed[t]);
+    if (acc.samples == 0) {
+      memset(&acc, 0, sizeof(acc));
+      acc.bucket = bucket;
+      acc.temperatureMin = INT16_MAX;
+      acc.temperatureMax = INT16_MIN;
+      acc.humidityMin = UINT8_MAX;
+    }
+    if (temperature != HISTORY_NO_TEMPERATURE) {
+      acc.temperatureSum += temperature;
+      acc.temperatureCount++;
+      acc.temperatureMin = min(acc.temperatureMin, temperature);
+      acc.temperatureMax = max(acc.temperatureMax, temperature);
+    }
+    if (humidity != HISTORY_NO_HUMIDITY) {
+      acc.humiditySum += humidity;
+      acc.humidityCount++;
+      acc.humidityMin = min(acc.humidityMin, humidity);
+      acc.humidityMax = max(acc.humidityMax, humidity);
+    }
+    acc.rpmSum += rpm;
+    acc.pwmSum += status.statePwmSpeed;
+    acc.flags |= flags;
+    acc.samples++;
+  }
+  portEXIT_CRITICAL(&lock);
+
+  if (commitHandler) {
+    for (uint8_t t = 1; t < HISTORY_TIERS; t++) {
+      if (hasCommitted[t]) commitHandler(t, committed[t]);
+    }
+  }
+}
+
+void HistoryStore::readSlot(historytier_t &tier, uint16_t index, historyrow_t &row) {
+  row.temperature = tier.temperature[index];
+  row.humidity = tier.humidity[index];
+  row.temperatureMin = tier.temperatureMin ? tier.temperatureMin[index] : row.temperature;
+  row.temperatureMax = tier.temperatureMax ? tier.temperatureMax[index] : row.temperature;
+  row.humidityMin = tier.humidityMin ? tier.humidityMin[index] : row.humidity;
+  row.humidityMax = tier.humidityMax ? tier.humidityMax[index] : row.humidity;
+  row.rpm = tier.rpm[index];
+  row.pwm = tier.pwm[index];
+  row.flags = tier.flags[index];
+}
+
+bool HistoryStore::getNext(uint8_t t, uint32_t from, historyrow_t &row) {
+  if (!ready || t >= HISTORY_TIERS) return false;
+  historytier_t &tier = tiers[t];
+  bool found = false;
+
+  portENTER_CRITICAL(&lock);
+  if (tier.count == 0) {
+    // nothing stored yet
+  } else if (tier.time) {
+    // Raw samples are ordered by time, binary search for the first one in range
+    uint16_t oldest = (tier.head + tier.capacity - tier.count + 1) % tier.capacity;
+    uint16_t low = 0, high = tier.count;
+    while (low < high) {
+      uint16_t mid = (low + high) / 2;
+      if (tier.time[(oldest + mid) % tier.capacity] < from) low = mid + 1;
+      else high = mid;
+    }
+    if (low < tier.count) {
+      uint16_t index = (oldest + low) % tier.capacity;
+      readSlot(tier, index, row);
+      row.time = tier.time[index];
+      found = true;
+    }
+  } else {
+    // Aggregated slots map directly to their bucket
+    uint32_t bucket = max((uint32_t)(((uint64_t)from + tier.resolution - 1) / tier.resolution), tier.lastBucket - tier.count + 1);
+    for (; bucket <= tier.lastBucket; bucket++) {
+      uint16_t index = (tier.head + tier.capacity - (tier.lastBucket - bucket)) % tier.capacity;
+      if (!(tier.flags[index] & HISTORY_FLAG_VALID)) continue;
+      readSlot(tier, index, row);
+      row.time = bucket * tier.resolution;
+      found = true;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&lock);
+  return found;
+}
+
+// Use the requested resolution, or the finest tier that still covers the start of the range
+uint8_t HistoryStore::selectTier(uint32_t from, uint16_t resolution) {
+  for (uint8_t t = 0; t < HISTORY_TIERS; t++) {
+    historytier_t &tier = tiers[t];
+    if (resolution > 0) {
+      if (tier.resolution >= resolution) return t;
+      continue;
+    }
+    if (tier.count < tier.capacity) return t;
+    uint32_t oldest = tier.time
+      ? tier.time[(tier.head + 1) % tier.capacity]
+      : (tier.lastBucket - tier.count + 1) * tier.resolution;
+    if (oldest <= from) return t;
+  }
+  return HISTORY_TIERS - 1;
+}
+
+size_t HistoryCursor::read(uint8_t *buffer, size_t maxLen) {
+  size_t written = 0;
+  while (written < maxLen) {
+    if (pendingOffset >= pendingLength && !format()) break;
+    size_t chunk = min(pendingLength - pendingOffset, maxLen - written);
+    memcpy(buffer + written, pending + pendingOffset, chunk);
+    written += chunk;
+    pendingOffset += chunk;
+  }
+  return written;
+}
+
+// Format the next piece of the response into the pending buffer
+bool HistoryCursor::format() {
+  BufferWriter writer(pending, sizeof(pending));
+  historyrow_t row;
+
+  switch (state) {
+    case HEADER:
+      writer.print(F("{\"now\":"));
+      writer.print(now);
+      writer.print(F(",\"resolution\":"));
+      writer.print(store.getResolution(tier));
+      writer.print(F(",\"columns\":[\"time\",\"temperature\",\"temperatureMin\",\"temperatureMax\","
+                     "\"humidity\",\"humidityMin\",\"humidityMax\",\"rpm\",\"pwm\",\"flags\"],\"data\":["));
+      state = ROWS;
+      break;
+
+    case ROWS:
+      if (store.getNext(tier, from, row) && row.time <= to) {
+        if (!firstRow) writer.print(',');
+        writer.print('[');
+        writer.print(row.time);
+        const int16_t temperatures[] = { row.temperature, row.temperatureMin, row.temperatureMax };
+        for (int16_t value : temperatures) {
+          writer.print(',');
+          if (value == HISTORY_NO_TEMPERATURE) writer.print("null");
+          else writer.printFloat(value / 100.0, 2);
+        }
+        const uint8_t humidities[] = { row.humidity, row.humidityMin, row.humidityMax };
+        for (uint8_t value : humidities) {
+          writer.print(',');
+          if (value == HISTORY_NO_HUMIDITY) writer.print("null");
+          else writer.printFloat(value / 2.0, 1);
+        }
+        writer.print(',');
+        writer.print(row.rpm);
+        writer.print(',');
+        writer.print(row.pwm);
+        writer.print(',');
+        writer.print(row.flags & ~HISTORY_FLAG_VALID);
+        writer.print(']');
+        firstRow = false;
+        from = row.time + 1;
+        break;
+      }
+      state = FOOTER;
+      // fall through
+
+    case FOOTER:
+      writer.print(F("]}"));
+      state = DONE;
+      break;
+
+    case DONE:
+      return false;
+  }
+
+  pendingLength = writer.getLength();
+  pendingOffset = 0;
+  return true;
+}
@@ -0,0 +1,140 @@
+/**
+ * @file history.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Tiered in-memory time series of the status reports
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef HISTORY_h
+#define HISTORY_h
+
+#include <Arduino.h>
+#include "status.h"
+
+#define HISTORY_TIERS           3
+#define HISTORY_TIER_CONFIG     { {5, 720}, {60, 1440}, {900, 2880} }   // {seconds per sample, samples}: 1h, 24h, 30d
+#define HISTORY_ROW_SIZE        192     // Max size of one formatted JSON row or the header
+
+#define HISTORY_NO_TEMPERATURE  INT16_MIN
+#define HISTORY_NO_HUMIDITY     0xFF
+
+#define HISTORY_FLAG_DPLUS              0x01
+#define HISTORY_FLAG_MIXER              0x02
+#define HISTORY_FLAG_DEHUMIDIFICATION   0x04
+#define HISTORY_FLAG_STALLED            0x08
+#define HISTORY_FLAG_VALID              0x80
+
+// One decoded sample, fixed point: temperature in 1/100 °C, humidity in 1/2 %
+struct historyrow_t {
+  uint32_t time;            // Uptime in seconds at the start of the sample
+  int16_t temperature;
+  int16_t temperatureMin;
+  int16_t temperatureMax;
+  uint8_t humidity;
+  uint8_t humidityMin;
+  uint8_t humidityMax;
+  uint16_t rpm;
+  uint8_t pwm;              // PWM speed in percent
+  uint8_t flags;            // HISTORY_FLAG_*, set if active at any time within the sample
+};
+
+// Running min/max/mean of the bucket that is currently filled
+struct historyaccumulator_t {
+  uint32_t bucket;
+  int32_t temperatureSum;
+  uint16_t temperatureCount;
+  int16_t temperatureMin;
+  int16_t temperatureMax;
+  uint32_t humiditySum;
+  uint16_t humidityCount;
+  uint8_t humidityMin;
+  uint8_t humidityMax;
+  uint32_t rpmSum;
+  uint32_t pwmSum;
+  uint16_t samples;
+  uint8_t flags;
+};
+
+// Ring buffer in struct of arrays layout. The first tier stores the raw samples with their
+// timestamp, all others store one aggregated bucket per slot and derive the time from the slot.
+struct historytier_t {
+  uint16_t resolution;
+  uint16_t capacity;
+  uint16_t head = 0;
+  uint16_t count = 0;
+  uint32_t lastBucket = 0;
+
+  uint32_t *time = NULL;                 // raw tier only
+  int16_t *temperature = NULL;
+  int16_t *temperatureMin = NULL;        // aggregated tiers only
+  int16_t *temperatureMax = NULL;
+  uint8_t *humidity = NULL;
+  uint8_t *humidityMin = NULL;
+  uint8_t *humidityMax = NULL;
+  uint16_t *rpm = NULL;
+  uint8_t *pwm = NULL;
+  uint8_t *flags = NULL;
+
+  historyaccumulator_t accumulator;
+};
+
+// Called with each completed bucket of the aggregated tiers, outside of any lock
+typedef void (*historycommit_t)(uint8_t tier, const historyrow_t &row);
+
+class HistoryStore {
+    public:
+        bool begin();
+        void add(uint32_t time, const status_t &status);
+        void onCommit(historycommit_t handler) { commitHandler = handler; }
+
+        uint8_t selectTier(uint32_t from, uint16_t resolution);
+        uint16_t getResolution(uint8_t tier) { return tiers[tier].resolution; }
+        uint16_t getCount(uint8_t tier) { return tiers[tier].count; }
+        size_t getMemoryUsage() { return memoryUsage; }
+
+        // First stored sample with time >= from, safe to call while samples are added
+        bool getNext(uint8_t tier, uint32_t from, historyrow_t &row);
+
+    private:
+        historytier_t tiers[HISTORY_TIERS];
+        portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+        size_t memoryUsage = 0;
+        bool ready = false;
+        historycommit_t commitHandler = NULL;
+
+        template<typename T> T *allocate(uint16_t count);
+        uint16_t push(historytier_t &tier);
+        bool commit(historytier_t &tier, historyrow_t &row);
+        void readSlot(historytier_t &tier, uint16_t index, historyrow_t &row);
+};
+
+// Streams a time range as JSON, row by row, for AsyncWebServer chunked responses
+class HistoryCursor {
+    public:
+        HistoryCursor(HistoryStore &store, uint8_t tier, uint32_t from, uint32_t to, uint32_t now)
+            : store(store), tier(tier), from(from), to(to), now(now) {}
+        size_t read(uint8_t *buffer, size_t maxLen);
+
+    private:
+        HistoryStore &store;
+        uint8_t tier;
+        uint32_t from;
+        uint32_t to;
+        uint32_t now;
+
+        enum { HEADER, ROWS, FOOTER, DONE } state = HEADER;
+        bool firstRow = true;
+        char pending[HISTORY_ROW_SIZE];
+        size_t pendingLength = 0;
+        size_t pendingOffset = 0;
+
+        bool format();
+};
+
+#endif // HISTORY_h
@@ -0,0 +1,227 @@
+/**
+ * @file historylog.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Append-only binary history log on LittleFS
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <LittleFS.h>
+#include "historylog.h"
+#include "log.h"
+
+bool HistoryLogClass::begin(uint32_t uptime, UBaseType_t priority) {
+  if (lock != NULL) return true;
+  lock = xSemaphoreCreateMutex();
+  queue = xQueueCreate(HISTORYLOG_QUEUE_LENGTH, sizeof(historyrecord_t));
+  if (lock == NULL || queue == NULL) {
+    LOG_INFO_LN(F("[HISTORY] Unable to create the log queue"));
+    return false;
+  }
+
+  if (!LittleFS.exists(HISTORYLOG_DIR)) LittleFS.mkdir(HISTORYLOG_DIR);
+  loadIndex();
+
+  // Continue the log clock after the newest stored record, the uptime restarts on power loss
+  if (segmentCount && segments[segmentCount - 1].records) lastTime = segments[segmentCount - 1].lastTime;
+  if (lastTime >= uptime) clockOffset = lastTime + 1 - uptime;
+
+  xTaskCreate(&HistoryLogClass::task, "HISTORY_task", 4096, this, priority, NULL);
+  LOG_INFO_F("[HISTORY] Found %u segments with %u records on flash\n", segmentCount, getRecords());
+  return true;
+}
+
+String HistoryLogClass::segmentPath(uint32_t id) {
+  char path[32];
+  snprintf(path, sizeof(path), HISTORYLOG_DIR "/%08x.bin", id);
+  return String(path);
+}
+
+bool HistoryLogClass::readRecord(File &file, uint16_t index, historyrecord_t &record) {
+  if (!file.seek(index * sizeof(historyrecord_t))) return false;
+  return file.read((uint8_t *)&record, sizeof(record)) == sizeof(record);
+}
+
+// Build the time index from the first and last record of each segment file
+void HistoryLogClass::loadIndex() {
+  File dir = LittleFS.open(HISTORYLOG_DIR);
+  if (!dir || !dir.isDirectory()) return;
+
+  File file = dir.openNextFile();
+  while (file) {
+    const char *name = strrchr(file.name(), '/');
+    name = name ? name + 1 : file.name();
+
+    historysegment_t segment = {};
+    segment.id = strtoul(name, NULL, 16);
+    segment.records = min(file.size() / sizeof(historyrecord_t), (size_t)HISTORYLOG_SEGMENT_RECORDS);
+    segment.sealed = file.size() % sizeof(historyrecord_t) != 0;
+
+    historyrecord_t record;
+    if (segment.records && readRecord(file, 0, record)) segment.firstTime = record.time;
+    if (segment.records && readRecord(file, segment.records - 1, record)) {
+      if (crc8((const uint8_t *)&record, sizeof(record) - 1) != record.crc) {
+        // Torn write on power loss, drop the record from the index
+        segment.sealed = true;
+        if (--segment.records && readRecord(file, segment.records - 1, record)) segment.lastTime = record.time;
+      } else segment.lastTime = record.time;
+    }
+    file.close();
+
+    // Keep the segments sorted by id, remove the oldest ones above the limit
+    uint32_t removeId = segment.id;
+    bool remove = segmentCount == HISTORYLOG_MAX_SEGMENTS;
+    if (!remove || segment.id > segments[0].id) {
+      if (remove) {
+        removeId = segments[0].id;
+        memmove(segments, segments + 1, sizeof(historysegment_t) * --segmentCount);
+      }
+      uint8_t i = segmentCount++;
+      for (; i > 0 && segments[i - 1].id > segment.id; i--) segments[i] = segments[i - 1];
+      segments[i] = segment;
+    }
+    if (remove) LittleFS.remove(segmentPath(removeId));
+
+    file = dir.openNextFile();
+  }
+  dir.close();
+}
+
+uint32_t HistoryLogClass::getRecords() {
+  uint32_t records = 0;
+  for (uint8_t i = 0; i < segmentCount; i++) records += segments[i].records;
+  return records;
+}
+
+uint8_t HistoryLogClass::crc8(const uint8_t *data, size_t len) {
+  uint8_t crc = 0;
+  while (len--) {
+    crc ^= *data++;
+    for (uint8_t bit = 0; bit < 8; bit++) crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+  }
+  return crc;
+}
+
+// Queue a completed bucket for the writer task, never waits for the flash
+void HistoryLogClass::add(const historyrow_t &row) {
+  if (queue == NULL) return;
+
+  historyrecord_t record;
+  record.time = max(toLogTime(row.time), lastTime + 1);
+  record.temperature = row.temperature;
+  record.temperatureMin = row.temperatureMin;
+  record.temperatureMax = row.temperatureMax;
+  record.humidity = row.humidity;
+  record.pwm = row.pwm;
+  record.rpm = row.rpm;
+  record.flags = row.flags & ~HISTORY_FLAG_VALID;
+  record.crc = crc8((const uint8_t *)&record, sizeof(record) - 1);
+
+  if (xQueueSend(queue, &record, 0) != pdTRUE) dropped++;
+  else lastTime = record.time;
+}
+
+// Append the batch to the newest segment, rotate if it is full. Requires the lock.
+bool HistoryLogClass::writeBatch() {
+  uint8_t written = 0;
+  while (written < batchCount) {
+    historysegment_t *segment = segmentCount ? &segments[segmentCount - 1] : NULL;
+    if (!segment || segment->sealed || segment->records >= HISTORYLOG_SEGMENT_RECORDS) {
+      uint32_t id = segment ? segment->id + 1 : 0;
+      if (segmentCount == HISTORYLOG_MAX_SEGMENTS) {
+        LittleFS.remove(segmentPath(segments[0].id));
+        memmove(segments, segments + 1, sizeof(historysegment_t) * --segmentCount);
+      }
+      segment = &segments[segmentCount++];
+      *segment = {};
+      segment->id = id;
+    }
+
+    uint16_t chunk = min((uint16_t)(batchCount - written), (uint16_t)(HISTORYLOG_SEGMENT_RECORDS - segment->records));
+    File file = LittleFS.open(segmentPath(segment->id), FILE_APPEND);
+    size_t bytes = file ? file.write((const uint8_t *)&batch[written], chunk * sizeof(historyrecord_t)) : 0;
+    if (file) file.close();
+    flashWrites++;
+
+    if (bytes != chunk * sizeof(historyrecord_t)) {
+      LOG_INFO_F("[HISTORY] Unable to write segment %08x, dropping %u records\n", segment->id, batchCount - written);
+      segment->sealed = true;
+      dropped += batchCount - written;
+      batchCount = 0;
+      return false;
+    }
+    if (segment->records == 0) segment->firstTime = batch[written].time;
+    segment->records += chunk;
+    segment->lastTime = batch[written + chunk - 1].time;
+    written += chunk;
+  }
+  batchCount = 0;
+  return true;
+}
+
+// Write everything that is queued right now, can be used before a restart or deep sleep
+void HistoryLogClass::flush() {
+  if (lock == NULL) return;
+  xSemaphoreTake(lock, portMAX_DELAY);
+  historyrecord_t record;
+  while (xQueueReceive(queue, &record, 0) == pdTRUE) {
+    batch[batchCount++] = record;
+    if (batchCount >= HISTORYLOG_BATCH_RECORDS) writeBatch();
+  }
+  if (batchCount) writeBatch();
+  xSemaphoreGive(lock);
+}
+
+size_t HistoryLogClass::read(uint32_t &from, uint32_t to, uint8_t *buffer, size_t maxLen) {
+  uint16_t maxRecords = min(maxLen / sizeof(historyrecord_t), (size_t)HISTORYLOG_SEGMENT_RECORDS);
+  if (lock == NULL || maxRecords == 0 || from > to) return 0;
+
+  size_t count = 0;
+  xSemaphoreTake(lock, portMAX_DELAY);
+  for (uint8_t i = 0; i < segmentCount; i++) {
+    historysegment_t &segment = segments[i];
+    if (segment.records == 0 || segment.lastTime < from) continue;
+    if (segment.firstTime > to) break;
+
+    File file = LittleFS.open(segmentPath(segment.id), FILE_READ);
+    if (!file) break;
+
+    // Records have a fixed size and ascending time, no need to scan the file
+    uint16_t low = 0, high = segment.records;
+    historyrecord_t record;
+    while (low < high) {
+      uint16_t mid = (low + high) / 2;
+      if (!readRecord(file, mid, record)) break;
+      if (record.time < from) low = mid + 1;
+      else high = mid;
+    }
+
+    uint16_t available = min((uint16_t)(segment.records - low), maxRecords);
+    count = file.seek(low * sizeof(historyrecord_t)) ? file.read(buffer, available * sizeof(historyrecord_t)) / sizeof(historyrecord_t) : 0;
+    file.close();
+
+    const historyrecord_t *records = (const historyrecord_t *)buffer;
+    while (count > 0 && records[count - 1].time > to) count--;
+    if (count) from = records[count - 1].time + 1;
+    break;
+  }
+  xSemaphoreGive(lock);
+  return count * sizeof(historyrecord_t);
+}
+
+void HistoryLogClass::task(void *parameter) {
+  HistoryLogClass *self = (HistoryLogClass *)parameter;
+  historyrecord_t record;
+  while (1) {
+    if (xQueueReceive(self->queue, &record, portMAX_DELAY) != pdTRUE) continue;
+    xSemaphoreTake(self->lock, portMAX_DELAY);
+    self->batch[self->batchCount++] = record;
+    if (self->batchCount >= HISTORYLOG_BATCH_RECORDS) self->writeBatch();
+    xSemaphoreGive(self->lock);
+  }
+}
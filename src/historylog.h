@@ -0,0 +1,89 @@
+/**
+ * @file historylog.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Append-only binary history log on LittleFS
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef HISTORYLOG_h
+#define HISTORYLOG_h
+
+#include <Arduino.h>
+#include <FS.h>
+#include "history.h"
+
+#define HISTORYLOG_DIR              "/history"
+#define HISTORYLOG_TIER             1       // Persist the 1 min buckets of the in-memory history
+#define HISTORYLOG_SEGMENT_RECORDS  4096    // 64 KB per segment file, ~2.8 days
+#define HISTORYLOG_MAX_SEGMENTS     4       // Oldest segment is deleted on rotation, ~11 days in total
+#define HISTORYLOG_BATCH_RECORDS    16      // Records collected in RAM before they are written to flash
+#define HISTORYLOG_QUEUE_LENGTH     8
+
+// On-flash record, little endian, decoded by tools/history-decode.py
+struct __attribute__((packed)) historyrecord_t {
+  uint32_t time;            // Log clock in seconds, continues across reboots
+  int16_t temperature;      // 1/100 °C, INT16_MIN if unknown
+  int16_t temperatureMin;
+  int16_t temperatureMax;
+  uint8_t humidity;         // 1/2 %, 0xFF if unknown
+  uint8_t pwm;              // Percent
+  uint16_t rpm;
+  uint8_t flags;            // HISTORY_FLAG_*
+  uint8_t crc;              // CRC-8 (poly 0x07) over the bytes above
+};
+static_assert(sizeof(historyrecord_t) == 16, "history records must stay 16 bytes");
+
+// In-RAM index of one segment file, segments are ordered by id and time
+struct historysegment_t {
+  uint32_t id;
+  uint32_t firstTime;
+  uint32_t lastTime;
+  uint16_t records;
+  bool sealed;              // Torn tail found on boot, never append to it again
+};
+
+class HistoryLogClass {
+    public:
+        bool begin(uint32_t uptime, UBaseType_t priority = 1);
+        void add(const historyrow_t &row);
+        void flush();
+
+        // Copy whole records with from <= time <= to into the buffer, from is advanced.
+        // Returns 0 at the end and if maxLen is below one record.
+        size_t read(uint32_t &from, uint32_t to, uint8_t *buffer, size_t maxLen);
+        uint32_t toLogTime(uint32_t uptime) { return uptime + clockOffset; }
+
+        uint8_t getSegments() { return segmentCount; }
+        uint32_t getRecords();
+        uint32_t getDropped() { return dropped; }
+        uint32_t getFlashWrites() { return flashWrites; }
+
+    private:
+        QueueHandle_t queue = NULL;
+        SemaphoreHandle_t lock = NULL;
+
+        historysegment_t segments[HISTORYLOG_MAX_SEGMENTS];
+        uint8_t segmentCount = 0;
+        historyrecord_t batch[HISTORYLOG_BATCH_RECORDS];
+        uint8_t batchCount = 0;
+
+        uint32_t clockOffset = 0;
+        uint32_t lastTime = 0;
+        uint32_t dropped = 0;
+        uint32_t flashWrites = 0;
+
+        void loadIndex();
+        bool writeBatch();
+        bool readRecord(File &file, uint16_t index, historyrecord_t &record);
+        String segmentPath(uint32_t id);
+        static uint8_t crc8(const uint8_t *data, size_t len);
+        static void task(void *parameter);
+};
+
+#endif // HISTORYLOG_h
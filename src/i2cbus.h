@@ -0,0 +1,41 @@
+/**
+ * @file i2cbus.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Minimal I2C bus interface used by the climate sensor drivers
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef I2CBUS_h
+#define I2CBUS_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+// No Arduino dependency on purpose, the drivers run against a fake bus on the host
+class I2CBus {
+    public:
+        virtual ~I2CBus() {}
+        virtual bool write(uint8_t address, const uint8_t *data, size_t length) = 0;
+        virtual bool read(uint8_t address, uint8_t *data, size_t length) = 0;
+
+        // Register access as used by most sensors, write the register and read from it
+        bool readRegister(uint8_t address, uint8_t reg, uint8_t *data, size_t length) {
+            return write(address, &reg, 1) && read(address, data, length);
+        }
+        bool writeRegister(uint8_t address, uint8_t reg, uint8_t value) {
+            uint8_t data[2] = { reg, value };
+            return write(address, data, sizeof(data));
+        }
+        // An empty write to check if a device acknowledges its address
+        bool probe(uint8_t address) {
+            return write(address, NULL, 0);
+        }
+};
+
+#endif // I2CBUS_h
@@ -0,0 +1,71 @@
+/**
+ * @file jsonbody.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Body handler for ESPAsyncWebServer that parses the complete JSON body once
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef JSONBODY_h
+#define JSONBODY_h
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+#include <functional>
+#include "bodybuffer.h"
+
+#define JSONBODY_MAX_SIZE   2048    // Default budget of a request body in bytes
+#define JSONBODY_CAPACITY   1024    // Default size of the JsonDocument
+
+typedef std::function<void(AsyncWebServerRequest *request, JsonDocument &json)> jsonbody_fn;
+
+// Use as the body handler of webServer.on(), onJson() runs once with the complete body.
+// Errors are answered here: 413 above the budget, 400 for broken chunks or JSON, 503 without memory.
+inline ArBodyHandlerFunction jsonBodyHandler(jsonbody_fn onJson, size_t budget = JSONBODY_MAX_SIZE, size_t capacity = JSONBODY_CAPACITY) {
+  return [onJson, budget, capacity](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+    bodybuffer_t *buffer = (bodybuffer_t *)request->_tempObject;
+    body_status_t status = bodyFeed(buffer, data, len, index, total, budget);
+    request->_tempObject = buffer;
+
+    switch (status) {
+      case BODY_PENDING:
+      case BODY_IGNORED:
+        return;
+      case BODY_TOO_LARGE:
+        request->send(413, "application/json", "{\"message\":\"Request body too large!\"}");
+        return;
+      case BODY_NO_MEMORY:
+        request->send(503, "application/json", "{\"message\":\"Out of memory!\"}");
+        return;
+      case BODY_INVALID:
+        request->send(400, "application/json", "{\"message\":\"Invalid request body!\"}");
+        return;
+      case BODY_COMPLETE:
+        break;
+    }
+
+    // Zero copy, the strings of the document point into the buffer that lives until the end of onJson()
+    DynamicJsonDocument json(capacity);
+    DeserializationError error = deserializeJson(json, buffer->data, buffer->size);
+    if (error) {
+      request->send(400, "application/json", String("{\"message\":\"Invalid JSON: ") + error.c_str() + "\"}");
+    } else {
+      onJson(request, json);
+    }
+    free(buffer);
+    request->_tempObject = NULL;
+  };
+}
+
+// Request handler for the same route, the body handler is not called without a body
+inline void jsonBodyRequest(AsyncWebServerRequest *request) {
+  if (!request->contentLength()) request->send(400, "application/json", "{\"message\":\"Missing request body!\"}");
+}
+
+#endif // JSONBODY_h
@@ -1,25 +1,39 @@
 
 
+#ifdef NATIVE
+  // The host simulator has neither a LogSink nor a serial console, log lines are dropped
+  #define LOG_INFO(...)             do {} while(0)
+  #define LOG_INFO_LN(...)          do {} while(0)
+  #define LOG_INFO_F(format, ...)   do {} while(0)
+#else
+#include "logsink.h"
 #include "webserial.h"
 extern WebSerialClass WebSerial;
+extern LogSinkClass LogSink;
+#endif
 
+// All macros only format into a stack buffer and push the record into the
+// LogSink ring buffer. The LOG_task writes it to Serial and WebSerial later on.
 #ifndef LOG_INFO
   #define LOG_INFO(...)  do {     \
-    Serial.print(__VA_ARGS__);    \
-    WebSerial.print(__VA_ARGS__); \
+    LogLine _logLine;             \
+    _logLine.print(__VA_ARGS__);  \
+    _logLine.commit();            \
     } while(0)
 #endif // LOG_INFO(...)
 
 #ifndef LOG_INFO_LN
-  #define LOG_INFO_LN(...) do {    \
-    Serial.println(__VA_ARGS__);   \
-    WebSerial.println(__VA_ARGS__);  \
+  #define LOG_INFO_LN(...) do {     \
+    LogLine _logLine;               \
+    _logLine.println(__VA_ARGS__);  \
+    _logLine.commit();              \
     } while(0)
 #endif // LOG_INFO_LN(...)
 
 #ifndef LOG_INFO_F
-  #define LOG_INFO_F(format, ...)  do {     \
-    Serial.printf(format, __VA_ARGS__);    \
-    WebSerial.printf(format, __VA_ARGS__);  \
+  #define LOG_INFO_F(format, ...)  do {      \
+    LogLine _logLine;                        \
+    _logLine.printf(format, __VA_ARGS__);    \
+    _logLine.commit();                       \
     } while(0)
 #endif // LOG_INFO_F(format, ...)
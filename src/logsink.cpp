@@ -0,0 +1,151 @@
+/**
+ * @file logsink.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Non-blocking log sink behind the LOG_INFO macros
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include "log.h"
+#include "logsink.h"
+
+LogSinkClass::LogSinkClass() {
+  for (uint32_t i = 0; i < LOGSINK_SLOT_COUNT; i++) {
+    slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  enqueuePos.store(0, std::memory_order_relaxed);
+  dropped.store(0, std::memory_order_relaxed);
+  written.store(0, std::memory_order_relaxed);
+}
+
+void LogSinkClass::begin(UBaseType_t priority) {
+  if (drainLock != NULL) return;
+  drainLock = xSemaphoreCreateMutex();
+  xTaskCreate(&LogSinkClass::task, "LOG_task", 3072, this, priority, NULL);
+}
+
+// Reserve a slot, copy the record and publish it to the consumer.
+// Never blocks, if the ring is full the record is dropped and counted.
+bool IRAM_ATTR LogSinkClass::push(const char *data, size_t len) {
+  if (len == 0) return true;
+  if (len > LOGSINK_SLOT_SIZE) len = LOGSINK_SLOT_SIZE;
+
+  logslot_t *slot;
+  uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+  while (1) {
+    slot = &slots[pos % LOGSINK_SLOT_COUNT];
+    int32_t diff = (int32_t)slot->sequence.load(std::memory_order_acquire) - (int32_t)pos;
+    if (diff == 0) {
+      if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+    } else if (diff < 0) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      pos = enqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+
+  memcpy(slot->data, data, len);
+  slot->length = len;
+  slot->sequence.store(pos + 1, std::memory_order_release);
+  written.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+// Write everything that is queued right now, can be used before a restart or deep sleep
+void LogSinkClass::flush() {
+  if (drainLock != NULL) xSemaphoreTake(drainLock, portMAX_DELAY);
+  drain();
+  WebSerial.flush();
+  if (drainLock != NULL) xSemaphoreGive(drainLock);
+}
+
+void LogSinkClass::drain() {
+  size_t batchLen = 0;
+  while (1) {
+    logslot_t *slot = &slots[dequeuePos % LOGSINK_SLOT_COUNT];
+    // Either empty or a producer has reserved but not yet published this slot
+    if (slot->sequence.load(std::memory_order_acquire) != dequeuePos + 1) break;
+
+    if (batchLen + slot->length > LOGSINK_BATCH_SIZE) {
+      emit(batchLen);
+      batchLen = 0;
+    }
+    memcpy(batch + batchLen, slot->data, slot->length);
+    batchLen += slot->length;
+
+    slot->sequence.store(dequeuePos + LOGSINK_SLOT_COUNT, std::memory_order_release);
+    dequeuePos++;
+  }
+  if (batchLen) emit(batchLen);
+
+  uint32_t lost = getDropped();
+  if (lost != reportedDropped) {
+    batchLen = snprintf(batch, sizeof(batch), "[LOG] %u messages dropped\n", lost - reportedDropped);
+    reportedDropped = lost;
+    emit(batchLen);
+  }
+}
+
+void LogSinkClass::emit(size_t len) {
+  Serial.write((const uint8_t *)batch, len);
+  batch[len] = '\0';
+  WebSerial.print(batch);
+}
+
+void LogSinkClass::task(void *pvParameter) {
+  LogSinkClass *sink = (LogSinkClass *)pvParameter;
+  while(1) {
+    xSemaphoreTake(sink->drainLock, portMAX_DELAY);
+    sink->drain();
+    // WebSerial collects the output and sends it as one frame per interval
+    WebSerial.loop();
+    xSemaphoreGive(sink->drainLock);
+    vTaskDelay(LOGSINK_DRAIN_INTERVAL_MS / portTICK_RATE_MS);
+  }
+}
+
+////////////// LogLine ////////////////
+void LogLine::write(const char *data, size_t len) {
+  while (len) {
+    if (length >= sizeof(buffer)) commit();
+    size_t chunk = min(len, sizeof(buffer) - length);
+    memcpy(buffer + length, data, chunk);
+    length += chunk;
+    data += chunk;
+    len -= chunk;
+  }
+}
+
+// Like Print::printf(), but never allocates. Output longer than one record is truncated.
+size_t LogLine::printf(const char *format, ...) {
+  size_t room = sizeof(buffer) - length;
+  va_list arg;
+  va_start(arg, format);
+  int len = vsnprintf(buffer + length, room, format, arg);
+  va_end(arg);
+  if (len < 0) return 0;
+
+  if ((size_t)len >= room && length > 0) {
+    // does not fit behind the pending output, start a new record
+    commit();
+    room = sizeof(buffer);
+    va_start(arg, format);
+    len = vsnprintf(buffer, room, format, arg);
+    va_end(arg);
+    if (len < 0) return 0;
+  }
+  len = min((size_t)len, room - 1);
+  length += len;
+  return len;
+}
+
+void LogLine::commit() {
+  LogSink.push(buffer, length);
+  length = 0;
+}
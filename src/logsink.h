@@ -0,0 +1,85 @@
+/**
+ * @file logsink.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Non-blocking log sink behind the LOG_INFO macros
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef LOGSINK_h
+#define LOGSINK_h
+
+#include <Arduino.h>
+#include <atomic>
+#include "format.h"
+
+#define LOGSINK_SLOT_SIZE         128     // Max bytes of a single log record
+#define LOGSINK_SLOT_COUNT        32      // Number of records in the ring, must be a power of 2
+#define LOGSINK_BATCH_SIZE        512     // Bytes written to the UART / WebSocket at once
+#define LOGSINK_DRAIN_INTERVAL_MS 20      // Delay between two drain runs of the background task
+
+// Lock-free multi producer ring buffer (bounded MPMC queue by D. Vyukov).
+// Producers never block, records that don't fit into the ring are counted as dropped.
+// Only push() is in IRAM. The LOG_ macros format from flash and must not be used in ISRs.
+class LogSinkClass {
+    public:
+        LogSinkClass();
+
+        void begin(UBaseType_t priority = tskIDLE_PRIORITY + 1);
+        bool push(const char *data, size_t len);
+        void flush();
+
+        uint32_t getDropped() { return dropped.load(std::memory_order_relaxed); }
+        uint32_t getWritten() { return written.load(std::memory_order_relaxed); }
+
+    private:
+        struct logslot_t {
+            std::atomic<uint32_t> sequence;
+            uint16_t length;
+            char data[LOGSINK_SLOT_SIZE];
+        };
+        logslot_t slots[LOGSINK_SLOT_COUNT];
+        std::atomic<uint32_t> enqueuePos;
+        uint32_t dequeuePos = 0;
+
+        std::atomic<uint32_t> dropped;
+        std::atomic<uint32_t> written;
+        uint32_t reportedDropped = 0;
+
+        char batch[LOGSINK_BATCH_SIZE + 1];
+        SemaphoreHandle_t drainLock = NULL;
+
+        void drain();
+        void emit(size_t len);
+        static void task(void *pvParameter);
+};
+
+// Formats a single log statement on the stack and commits it as one record.
+// Values are formatted with BufferWriter, no path allocates heap memory.
+class LogLine {
+    public:
+        template<typename T> void print(const T &value) {
+            char scratch[FORMAT_SCRATCH_SIZE];
+            FormatView view = formatView(scratch, sizeof(scratch), value);
+            write(view.data, view.length);
+        }
+        template<typename T> void println(const T &value) {
+            print(value);
+            write("\n", 1);
+        }
+
+        void write(const char *data, size_t len);
+        size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+        void commit();
+
+    private:
+        char buffer[LOGSINK_SLOT_SIZE];
+        size_t length = 0;
+};
+
+#endif // LOGSINK_h
@@ -45,79 +45,31 @@
 // ESP32 PWM functions
 #include "driver/ledc.h"
 
-// DHT22 Temperature and Humidity
-#include <Adafruit_Sensor.h>
-#include <DHT.h>
-#include <DHT_U.h>
-
-// Read from memory instead of register (updated by thread)
-volatile float currentHumidity = 0;
-volatile float currentTemperature = 0;
+// Aggregate of all sensors, updated by speedJob()
+float currentHumidity = 0;
+float currentTemperature = 0;
+int8_t dhtSensor = -1;
 
 WebSerialClass WebSerial;
+LogSinkClass LogSink;
 bool stateMixer = false;
 bool stateDplus = false;
 uint8_t statePoti = 0;
 
 bool stateDehumidification = false;
 
-// extern uint8_t __analogReturnedWidth;
-static uint16_t MAX_ADC_VALUE = 4096; // pow(2, __analogReturnedWidth);
-
 void DHT_task(void *pvParameter) {
-  DHT_Unified dht(DHT22_PIN, DHT22);
-  dht.begin();
-
-  // Print temperature sensor details.
-  sensor_t sensor;
-  dht.temperature().getSensor(&sensor);
-  LOG_INFO_LN(F("[DHT22] ------------------------------------"));
-  LOG_INFO_LN(F("[DHT22] Temperature Sensor"));
-  LOG_INFO  (F("[DHT22] Sensor Type: ")); LOG_INFO_LN(sensor.name);
-  LOG_INFO  (F("[DHT22] Driver Ver:  ")); LOG_INFO_LN(sensor.version);
-  LOG_INFO  (F("[DHT22] Unique ID:   ")); LOG_INFO_LN(sensor.sensor_id);
-  LOG_INFO  (F("[DHT22] Max Value:   ")); LOG_INFO(sensor.max_value);  LOG_INFO_LN(F("°C"));
-  LOG_INFO  (F("[DHT22] Min Value:   ")); LOG_INFO(sensor.min_value);  LOG_INFO_LN(F("°C"));
-  LOG_INFO  (F("[DHT22] Resolution:  ")); LOG_INFO(sensor.resolution); LOG_INFO_LN(F("°C"));
-  LOG_INFO_LN(F("------------------------------------"));
-  // Print humidity sensor details.
-  dht.humidity().getSensor(&sensor);
-  LOG_INFO_LN(F("[DHT22] Humidity Sensor"));
-  LOG_INFO  (F("[DHT22] Sensor Type: ")); LOG_INFO_LN(sensor.name);
-  LOG_INFO  (F("[DHT22] Driver Ver:  ")); LOG_INFO_LN(sensor.version);
-  LOG_INFO  (F("[DHT22] Unique ID:   ")); LOG_INFO_LN(sensor.sensor_id);
-  LOG_INFO  (F("[DHT22] Max Value:   ")); LOG_INFO(sensor.max_value);  LOG_INFO_LN(F("%"));
-  LOG_INFO  (F("[DHT22] Min Value:   ")); LOG_INFO(sensor.min_value);  LOG_INFO_LN(F("%"));
-  LOG_INFO  (F("[DHT22] Resolution:  ")); LOG_INFO(sensor.resolution); LOG_INFO_LN(F("%"));
-  LOG_INFO_LN(F("------------------------------------"));
-
-  // Set delay between sensor readings based on sensor details.
+  if (!Dht.begin(DHT22_PIN)) vTaskDelete(NULL);
+
   // We have to wait at least 2 seconds for DHT22, but we multiply to extend sleep time
   // This reduces power consumtion and allows better temperature / humidity readings
-  uint32_t delayMS = sensor.min_delay / 1000 * 5;
+  const uint32_t delayMS = DHT22_RETRY_DELAY_MS * 5;
 
   while(1) {
-    sensors_event_t event;
-    dht.temperature().getEvent(&event);
-    if (isnan(event.temperature)) {
-      LOG_INFO_LN(F("[DHT22] Error reading temperature!"));
-    } else {
-      // Verify if that value can be true
-      if (event.temperature > 125.0 or event.temperature < -40.0) {
-        // out of Range
-        LOG_INFO_F("[DHT22] Temperature out of range: %0.2f\n", event.temperature);
-      } else currentTemperature = event.temperature;
-    }
-
-    dht.humidity().getEvent(&event);
-    if (isnan(event.relative_humidity)) {
-      LOG_INFO_LN(F("[DHT22] Error reading humidity!"));
-    } else {
-      if (event.relative_humidity > 100.0 or event.relative_humidity < 0.0) {
-        // out of Range
-        LOG_INFO_F("[DHT22] Humidity out of range: %0.2f\n", event.relative_humidity);
-      } else currentHumidity = event.relative_humidity;
-    }
+    dhtreading_t reading = {};
+    dht_result_t result = Dht.read(reading, 2);
+    if (result != DHT_OK) LOG_INFO_F("[DHT22] Error %u reading the sensor!\n", result);
+    Sensors.submit(dhtSensor, result == DHT_OK, reading.temperature, reading.humidity);
 
     // LOG_INFO_F("[DHT22] Sleeping for %d ms\n", delayMS);
     vTaskDelay(delayMS / portTICK_RATE_MS);
@@ -128,7 +80,7 @@ void initWifiAndServices() {
   // Load well known Wifi AP credentials from NVS
   WifiManager.startBackgroundTask();
   WifiManager.attachWebServer(&webServer);
-  WifiManager.fallbackToSoftAp(preferences.getBool("enableSoftAp", true));
+  WifiManager.fallbackToSoftAp(Config.get().enableSoftAp);
 
   WebSerial.begin(&webServer);
   
@@ -145,28 +97,220 @@ void initWifiAndServices() {
   }
 
   if (enableMqtt) {
-    Mqtt.prepare(
-      preferences.getString("mqttHost", "localhost"),
-      preferences.getUInt("mqttPort", 1883),
-      preferences.getString("mqttTopic", "verges/toilet"),
-      preferences.getString("mqttUser", ""),
-      preferences.getString("mqttPass", "")
-    );
+    const config_t &config = Config.get();
+    Mqtt.prepare(config.mqttHost, config.mqttPort, config.mqttTopic, config.mqttUser, config.mqttPass);
   }
   else LOG_INFO_LN(F("[MQTT] Publish to MQTT is disabled."));
 }
 
-// Tacho interrupt handler is only executed if the FAN is spinning 
-// and the TACHO signal pin is connected
-void IRAM_ATTR tacho_interrupt_handler() {
-  unsigned long current_micros = micros();
-  tachoDelay = (current_micros - lastTachoInterrupt);
-  lastTachoInterrupt = current_micros;
+#ifdef BENCHMARK
+// getCycleCount() wraps every ~18s at 240MHz, each batch is much shorter
+uint64_t benchCycles() {
+  static uint64_t cycles = 0;
+  static uint32_t last = ESP.getCycleCount();
+  uint32_t now = ESP.getCycleCount();
+  cycles += now - last;
+  last = now;
+  return cycles;
+}
+
+// Hot paths of the firmware, results as JSON for /api/bench and the serial console
+size_t runBenchmarks(char *buffer, size_t size) {
+  BenchRunner bench("cycles", benchCycles, []() -> int32_t { return ESP.getFreeHeap(); });
+  status_t status = { 1234, false, 3600000, false, true, 42, 80, 21.5, 65.25, false };
+
+  StatusSerializer serializer;
+  bench.run("statusSerialize", 1000, [&]() -> uint32_t {
+    return serializer.serialize(status);
+  });
+
+  // The former ArduinoJson implementation of the status report, for comparison
+  bench.run("statusArduinoJson", 1000, [&]() -> uint32_t {
+    String jsonOutput;
+    StaticJsonDocument<1024> jsonDoc;
+    jsonDoc["stateFanRpm"] = status.stateFanRpm;
+    jsonDoc["stateFanStalled"] = status.stateFanStalled;
+    jsonDoc["lastMixer"] = status.lastMixer;
+    jsonDoc["stateMixer"] = status.stateMixer;
+    jsonDoc["stateDplus"] = status.stateDplus;
+    jsonDoc["statePoti"] = status.statePoti;
+    jsonDoc["statePwmSpeed"] = status.statePwmSpeed;
+    jsonDoc["stateTemperature"] = status.stateTemperature;
+    jsonDoc["stateHumidity"] = status.stateHumidity;
+    jsonDoc["stateDehumidification"] = status.stateDehumidification;
+    serializeJsonPretty(jsonDoc, jsonOutput);
+    return jsonOutput.length();
+  });
+
+  // Lines beyond the capacity of the LogSink are dropped, that is part of the cost
+  bench.run("logInfoF", 200, []() -> uint32_t {
+    LOG_INFO_F("[BENCH] Temperature: %.1f °C at %.1f %% humidity\n", 21.5, 65.25);
+    return 0;
+  });
+
+  bench.run("configParse", 1000, []() -> uint32_t {
+    DynamicJsonDocument json(1024);
+    deserializeJson(json, BENCH_SAMPLE_CONFIG);
+    return json["humidityThr"] == 75 ? json.memoryUsage() : 0;
+  });
+
+  bench.run("espInfo", 50, []() -> uint32_t {
+    String output;
+    DynamicJsonDocument json(API_ESP_INFO_SIZE);
+    APIBuildEspInfo(json);
+    serializeJson(json, output);
+    return output.length();
+  });
+
+  bench.run("controlSpeed", 1000, []() -> uint32_t {
+    controlSpeed();
+    return 0;
+  });
+
+  // Body of a UI request in TCP segment sized chunks, the LittleFS path against the mapped bundle.
+  // With a bundle LittleFS holds no UI, the bundled index.html is copied to it for the run.
+  static uint8_t chunk[1460];
+  static const char *littlefsIndex = NULL;
+  const assetbundleentry_t *bundled = Assets && Assets->isBundled() ? Assets->getBundle().find("/index.html") : NULL;
+  littlefsIndex = NULL;
+  if (bundled) {
+    File copy = LittleFS.open(BENCH_ASSET_COPY, "w");
+    if (copy && copy.write(Assets->getBundle().getData(*bundled), bundled->dataSize) == bundled->dataSize) littlefsIndex = BENCH_ASSET_COPY;
+    if (copy) copy.close();
+  } else if (LittleFS.exists("/index.html.gz")) littlefsIndex = "/index.html.gz";
+  else if (LittleFS.exists("/index.html")) littlefsIndex = "/index.html";
+
+  if (!littlefsIndex) bench.fail("assetLittleFS", bundled ? "Unable to copy index.html to LittleFS" : "No index.html on LittleFS");
+  else {
+    bench.run("assetLittleFS", 20, []() -> uint32_t {
+      File file = LittleFS.open(littlefsIndex, "r");
+      uint32_t bytes = 0;
+      while (file && file.available()) bytes += file.read(chunk, sizeof(chunk));
+      return bytes;
+    });
+  }
+  if (bundled) LittleFS.remove(BENCH_ASSET_COPY);
+
+  if (!bundled) bench.fail("assetBundle", "No index.html in the asset bundle");
+  else {
+    bench.run("assetBundle", 20, [bundled]() -> uint32_t {
+      const uint8_t *data = Assets->getBundle().getData(*bundled);
+      for (uint32_t offset = 0; offset < bundled->dataSize; offset += sizeof(chunk)) {
+        memcpy(chunk, data + offset, min(sizeof(chunk), (size_t)(bundled->dataSize - offset)));
+      }
+      return bundled->dataSize;
+    });
+  }
+
+  return bench.toJson(buffer, size, AUTO_FW_VERSION);
+}
+#endif
+
+// Periodic jobs, executed from loop() by the Scheduler
+void serviceJob() {
+  PERF_SCOPE(PERF_PROBE_SERVICE);
+
+  // Check if all the services work
+  // MQTT reconnects on its own in the MQTT_task, with backoff and without blocking this loop
+  if (enableMqtt && Mqtt.getState() == MQTT_STATE_WAITING) {
+    LOG_INFO_F("[MQTT] Not connected, %u of %u connection attempts failed\n", Mqtt.getConnectFailures(), Mqtt.getConnectAttempts());
+  }
+
+  if (enableMqtt && perfMqtt && Perf.isEnabled() && Mqtt.isReady()) {
+    char payload[PERF_MQTT_SIZE];
+    Perf.summary(payload, sizeof(payload));
+    Mqtt.publishPayload(MQTT_PERF, payload, true);
+  }
+}
+
+// The control logic lives in control.cpp, so the simulator runs the same code
+void mixerJob() {
+  PERF_SCOPE(PERF_PROBE_MIXER);
+  runMixerControl();
+}
+
+void speedJob() {
+  PERF_SCOPE(PERF_PROBE_SPEED);
+  // Time since the previous deadline, capped for the first run after boot
+  runSpeedControl(min((runtime() - Timing.lastSpeedUpdate) / 1000.f, 1.f));
+}
+
+// Snapshot of the current state, shared by the status report and the telemetry
+void collectStatus(status_t &status) {
+  // Without a TACHO signal the fan is reported as stalled with 0 RPM
+  status.stateFanRpm = Tacho.getRpm();
+  status.stateFanStalled = Tacho.isStalled() && targetPwmSpeed > 0;
+  status.lastMixer = runtime() - lastMixerRun;
+  status.stateMixer = stateMixer;
+  status.stateDplus = stateDplus;
+  status.statePoti = statePoti;
+  status.statePwmSpeed = map(targetPwmSpeed, 0, PWM_MAX_DUTY_CYCLE, 0, 100);
+  status.stateTemperature = currentTemperature;
+  status.stateHumidity = currentHumidity;
+  status.stateDehumidification = stateDehumidification;
+}
+
+void statusJob() {
+  if (otaRunning) return;
+  PERF_SCOPE(PERF_PROBE_STATUS);
+
+  status_t status;
+  collectStatus(status);
+
+  LOG_INFO_F("FAN target speed: %d %%\n", status.statePwmSpeed);
+  if (status.stateFanStalled) LOG_INFO_LN(F("FAN stalled, no tacho pulses received"));
+  else LOG_INFO_F("FAN current RPM:  %u\n", status.stateFanRpm);
+  if (closedLoop && fanOpenLoop) {
+    LOG_INFO_LN(F("FAN closed loop paused, running open loop without a tacho signal"));
+  } else if (closedLoop) {
+    LOG_INFO_F("FAN setpoint RPM: %u, PWM output %.1f %%, overshoot %.1f %%, settling %u ms%s\n",
+      targetPwmSpeed * maxFanRpm / PWM_MAX_DUTY_CYCLE, FanPid.getOutput() * 100.f,
+      FanPid.getOvershootPercent(), FanPid.getSettlingTimeMs(), FanPid.isSettled() ? "" : " (settling)");
+  }
+
+  History.add(runtime() / 1000, status);
+
+  // Encoded once into a fixed buffer, shared by SSE and MQTT
+  StatusReport.serialize(status);
+  events.send(StatusReport.c_str(), "status", millis());
+
+  if (enableMqtt && Mqtt.isReady()) {
+    bool changed = false;
+    changed |= Mqtt.publishValue(MQTT_FAN_RPM, status.stateFanRpm);
+    changed |= Mqtt.publishValue(MQTT_MIXER, status.stateMixer);
+    changed |= Mqtt.publishValue(MQTT_DPLUS, status.stateDplus);
+    changed |= Mqtt.publishValue(MQTT_DEHUMIDIFICATION, status.stateDehumidification);
+    changed |= Mqtt.publishValue(MQTT_POTENTIOMETER, status.statePoti);
+    changed |= Mqtt.publishValue(MQTT_PWM_SPEED, status.statePwmSpeed);
+    changed |= Mqtt.publishValue(MQTT_TEMPERATURE, status.stateTemperature, 2);
+    changed |= Mqtt.publishValue(MQTT_HUMIDITY, status.stateHumidity, 2);
+    // lastMixer changes on every tick, so the json follows the other topics. The topic is
+    // retained, a subscriber only sees the last message, so it always gets a full snapshot.
+    if (StatusReport.getDeltaMode()) {
+      char json[STATUS_JSON_SIZE];
+      StatusSerializer::serializeFields(status, STATUS_ALL_FIELDS, json, sizeof(json));
+      Mqtt.publishPayload(MQTT_JSON, json, changed);
+    } else {
+      Mqtt.publishPayload(MQTT_JSON, StatusReport.c_str(), changed);
+    }
+  }
+
+  LOG_INFO_F("Temperature:      %.1f °C at %.1f %% humidity\n", currentTemperature, currentHumidity);
+}
+
+void telemetryJob() {
+  if (otaRunning) return;
+  status_t status;
+  collectStatus(status);
+  // Also frees the buffers of clients that are gone, without any the job only runs once per idle wakeup
+  Telemetry.tick(status);
+  Scheduler.setPeriod("telemetry", Telemetry.getClientCount() ? TELEMETRY_TICK_MS : SCHEDULER_MAX_IDLE_MS);
 }
 
 void setup() {
   Serial.begin(115200);
   Serial.setDebugOutput(true);
+  LogSink.begin();
 
   LOG_INFO_LN(F("\n\n==== starting ESP32 setup() ===="));
   LOG_INFO_F("Firmware build date: %s %s\n", __DATE__, __TIME__);
@@ -187,7 +331,6 @@ void setup() {
   pinMode(MIXER_STATUS_PIN, INPUT_PULLDOWN);
 
   pinMode(TACHO_PIN, INPUT_PULLUP);
-  attachInterrupt(digitalPinToInterrupt(TACHO_PIN), tacho_interrupt_handler, FALLING);
 
   // run PWM on 25% on startup
   analogWrite(PWM_PIN, targetPwmSpeed);
@@ -201,40 +344,74 @@ void setup() {
     // This won't fix the problem, a check of the sensor log is required
     deepsleepForSeconds(5);
   }
-  if (!preferences.begin(NVS_NAMESPACE)) preferences.clear();
   LOG_INFO_LN(F("[LITTLEFS] initialized"));
 
-  // Load Settings from NVS
-  hostName = preferences.getString("hostName");
-  if (hostName.isEmpty()) {
-    hostName = "ogotoilet";
-    preferences.putString("hostName", hostName);
-  }
-  enableWifi = preferences.getBool("enableWifi", enableWifi);
-  enableMqtt = preferences.getBool("enableMqtt", enableMqtt);
+  // Load Settings from NVS, one blob read, the per-key layout of older firmware is migrated
+  Config.begin(NVS_NAMESPACE);
+  const config_t &config = Config.get();
+  if (!config.hostName[0]) ConfigClass::copyString(Config.edit().hostName, "ogotoilet");
+  hostName = config.hostName;
+  enableWifi = config.enableWifi;
+  enableMqtt = config.enableMqtt;
+
+  runMixerAfter = config.runMixerAfter;
+  noMixerBelowTempC = config.noMixerBelowTempC;
+
+  overrideSpeedPoti = config.overrideSpeedPoti;
+  overrideSpeed = config.overrideSpeed;
+
+  humidityThr = config.humidityThr;
+  humiditySpeed = config.humiditySpeed;
+
+  StatusReport.setDeltaMode(config.statusDelta);
 
-  runMixerAfter = preferences.getULong("runMixerAfter", runMixerAfter);
-  noMixerBelowTempC = preferences.getInt("noMixerBelow", noMixerBelowTempC);
+  Power.begin((power_mode_t)config.powerMode);
+  Power.addWakeupPin(DPLUS_PIN);
+  Power.addWakeupPin(MIXER_STATUS_PIN);
 
-  overrideSpeedPoti = preferences.getBool("overridePoti", overrideSpeedPoti);
-  overrideSpeed = preferences.getUInt("overrideSpeed", overrideSpeed);
+  Sensors.setAggregate((sensor_aggregate_t)config.sensorAggregate);
 
-  humidityThr = preferences.getUInt("humidityThr", humidityThr);
-  humiditySpeed = preferences.getUInt("humiditySpeed", humiditySpeed);
+  Perf.begin(config.perfEnabled);
+  perfMqtt = config.perfMqtt;
+
+  closedLoop = config.closedLoop;
+  maxFanRpm = max(config.maxFanRpm, (uint32_t)1);
+  FanPid.setTunings(config.pidKp, config.pidKi, config.pidKd);
+
+  // Pulses are counted in hardware, the pin keeps its pull up from above
+  Tacho.begin(TACHO_PIN, config.tachoPpr);
+
+  History.begin();
+  HistoryLog.begin(runtime() / 1000);
+  History.onCommit([](uint8_t tier, const historyrow_t &row) {
+    if (tier == HISTORYLOG_TIER) HistoryLog.add(row);
+  });
+
+  // Only changed values are published, each topic with its own deadband
+  Mqtt.addSlot(MQTT_JSON, "json");
+  Mqtt.addSlot(MQTT_FAN_RPM, "fan-rpm", 50);
+  Mqtt.addSlot(MQTT_MIXER, "mixer");
+  Mqtt.addSlot(MQTT_DPLUS, "dplus");
+  Mqtt.addSlot(MQTT_DEHUMIDIFICATION, "dehumidification");
+  Mqtt.addSlot(MQTT_POTENTIOMETER, "potentiometer", 2);
+  Mqtt.addSlot(MQTT_PWM_SPEED, "pwm-speed");
+  Mqtt.addSlot(MQTT_TEMPERATURE, "temperature", 0.2);
+  Mqtt.addSlot(MQTT_HUMIDITY, "humidity", 1);
+  Mqtt.addSlot(MQTT_PERF, "perf");
 
   if (enableWifi) {
     initWifiAndServices();
   } else LOG_INFO_LN(F("[WIFI] Not starting WiFi!"));
 
-  String otaPassword = preferences.getString("otaPassword");
-  if (otaPassword.isEmpty()) {
-    otaPassword = String((uint32_t)ESP.getEfuseMac());
-    preferences.putString("otaPassword", otaPassword);
+  if (!config.otaPassword[0]) {
+    ConfigClass::copyString(Config.edit().otaPassword, String((uint32_t)ESP.getEfuseMac()).c_str());
+    LOG_INFO_LN(F("[OTA] No password configured, using the default one"));
   }
-  LOG_INFO_F("[OTA] Password set to '%s'\n", otaPassword);
+  Config.save();
+  // Never log the password, the log is mirrored to WebSerial
   ArduinoOTA
     .setHostname(hostName.c_str())
-    .setPassword(otaPassword.c_str())
+    .setPassword(config.otaPassword)
     .onStart([]() {
       String type;
       if (ArduinoOTA.getCommand() == U_FLASH) type = "sketch";
@@ -261,10 +438,35 @@ void setup() {
 
   ArduinoOTA.begin();
 
-  preferences.end();
-
-  // Update the DHT Temperature and Humidity in a background task
-  xTaskCreate(&DHT_task, "DHT_task", 2048, NULL, 5, NULL);
+  // Updates pulled from the manifest URL, the PULL_task waits for WiFi on its own
+  OtaPull.onSuccess([]() {
+    LOG_INFO_LN("[PULL] Update complete, rebooting now!");
+    HistoryLog.flush();
+    LogSink.flush();
+    Serial.flush();
+    ESP.restart();
+  });
+  OtaPull.begin(AUTO_FW_VERSION);
+  OtaPull.configure(config);
+
+  // Update the DHT Temperature and Humidity in a background task, I2C sensors in another one
+  dhtSensor = Sensors.addExternal("dht22");
+  Sensors.begin(I2C_SDA_PIN, I2C_SCL_PIN);
+  xTaskCreate(&DHT_task, "DHT_task", DHT22_TASK_STACK, NULL, 5, NULL);
+
+  loopTaskHandle = xTaskGetCurrentTaskHandle();
+  Scheduler.begin(runtime, []() -> uint64_t { return esp_timer_get_time(); });
+  Scheduler.add("speed", Timing.speedUpdateInterval, 3, speedJob, &Timing.lastSpeedUpdate);
+  Scheduler.add("mixer", Timing.mixerUpdateInterval, 2, mixerJob, &Timing.lastMixerUpdate);
+  Scheduler.add("status", Timing.statusUpdateInterval, 1, statusJob, &Timing.lastStatusUpdate);
+  Scheduler.add("telemetry", SCHEDULER_MAX_IDLE_MS, 1, telemetryJob, &Timing.lastTelemetryUpdate);
+  Scheduler.add("service", Timing.serviceInterval, 0, serviceJob, &Timing.lastServiceCheck);
+
+#ifdef BENCHMARK
+  static char benchmarks[BENCH_JSON_SIZE];
+  runBenchmarks(benchmarks, sizeof(benchmarks));
+  Serial.println(benchmarks);
+#endif
 }
 
 // Soft reset the ESP to start with setup() again, but without loosing RTC_DATA as it would be with ESP.reset()
@@ -276,18 +478,28 @@ void softReset() {
     WifiManager.stopWifi();
   }
   esp_sleep_enable_timer_wakeup(1);
+  HistoryLog.flush();
+  LogSink.flush();
   esp_deep_sleep_start();
 }
 
 void loop() {
-  ArduinoOTA.handle();
+  {
+    PERF_SCOPE(PERF_PROBE_OTA);
+    ArduinoOTA.handle();
+  }
 
-  if (runtime() > UINT64_MAX - (1000 * 60 * 60 * 24)) {
+  if (runtimeNearOverflow(runtime())) {
     // overflow in the next 24 hours, let's reset the ESP32 to prevent millis overflow side effects.
     // Haven't figured out why, but it seems to cause some issues.
     ESP.restart();
   } 
 
+  if (mixerEnded) {
+    mixerEnded = false;
+    LOG_INFO_LN(F("[MIXER] Output pin released"));
+  }
+
   if (button1.pressed) {
     LOG_INFO_LN(F("[EVENT] Button pressed!"));
     button1.pressed = false;
@@ -300,123 +512,6 @@ void loop() {
     // softReset();
   }
 
-  if (runtime() - Timing.lastServiceCheck > Timing.serviceInterval) {
-    Timing.lastServiceCheck = runtime();
-    // Check if all the services work
-    if (enableWifi && WiFi.status() == WL_CONNECTED && WiFi.getMode() & WIFI_MODE_STA) {
-      if (enableMqtt && !Mqtt.isConnected()) Mqtt.connect();
-    }
-  }
-
-  // Do not continue regular operation as long as a OTA is running
-  // Reason: Background workload can cause upgrade issues that we want to avoid!
-  if (otaRunning) return sleepOrDelay();
-
-  if (runtime() - Timing.lastMixerUpdate > Timing.mixerUpdateInterval) {
-    Timing.lastMixerUpdate = runtime();
-    
-    // When the Mixer of the toilet is active, we have a 12V Signal on the MIXER_STATUS_PIN using
-    // a voltage devider ~12 to ~3V. We use that signal to reset the mixer timer so that
-    // we can run it after X hours of the last run.
-    stateMixer = digitalRead(MIXER_STATUS_PIN);
-    if (stateMixer) {
-      lastMixerRun = runtime();
-      LOG_INFO_LN("MIXER - runs now!");
-    } else if (runtime() - lastMixerRun > runMixerAfter) {
-      // Some time has passed, we run the mixer using a transistor on MIXER_START_PIN to improve the rotting
-      if (currentTemperature > noMixerBelowTempC) {
-        activateMixer();
-      } else {
-        LOG_INFO(F("[INFO] Temerature below configured limit, not running the mixer. Next retry after configured timeout."));
-      }
-      lastMixerRun = runtime();
-    }
-  }
-
-  if (runtime() - Timing.lastSpeedUpdate > Timing.speedUpdateInterval) {
-    Timing.lastSpeedUpdate = runtime();
-    
-    // If the engine is running, we have a D+ signal on the DPLUS_PIN using a voltage devider ~12 to ~3V
-    // When the signal is running, the fan should run on 100% speed to improve toilet drying
-    // While the mixer is working, we again want to get full speed fan.
-    stateDplus = digitalRead(DPLUS_PIN);
-    if (stateDplus || stateMixer) {
-      // LOG_INFO_LN("DPLUS active, max power!");
-      digitalWrite(LED_BUILTIN, HIGH);
-      targetPwmSpeed = PWM_MAX_DUTY_CYCLE;
-    } else {
-      digitalWrite(LED_BUILTIN, LOW);
-      uint16_t potiRead = analogRead(SPEED_PIN);
-      statePoti = map(potiRead, 0, MAX_ADC_VALUE, 0, 100);
-      if (currentHumidity >= humidityThr && humidityThr > 0) {
-        stateDehumidification = true;
-        // Dehumidification required, overruling all other options
-        if (humiditySpeed >= 100) targetPwmSpeed = PWM_MAX_DUTY_CYCLE;
-        else targetPwmSpeed = map(humiditySpeed, 0, 100, 0, PWM_MAX_DUTY_CYCLE);
-      } else {
-        stateDehumidification = false;
-        if (overrideSpeedPoti) {
-          // Ignore potentiometer, use config value
-          if (overrideSpeed >= 100) targetPwmSpeed = PWM_MAX_DUTY_CYCLE;
-          else if(overrideSpeed <= 0) targetPwmSpeed = 0; // it's uint8, this should never happen ;)
-          else targetPwmSpeed = map(overrideSpeed, 0, 100, 0, PWM_MAX_DUTY_CYCLE);
-        } else {
-          targetPwmSpeed = map(potiRead, 0, MAX_ADC_VALUE, 0, PWM_MAX_DUTY_CYCLE);
-        }
-      }
-    }
-    ledcWrite(PWM_CHANNEL, targetPwmSpeed);
-  }
-
-  if (runtime() - Timing.lastStatusUpdate > Timing.statusUpdateInterval) {
-    Timing.lastStatusUpdate = runtime();
-
-    String jsonOutput;
-    StaticJsonDocument<1024> jsonDoc;
-
-    uint8_t fanSpeed = map(targetPwmSpeed, 0, PWM_MAX_DUTY_CYCLE, 0, 100);
-    LOG_INFO_F("FAN target speed: %d %%\n", fanSpeed);
-
-    // Tacho Delay is not working, if the FAN doesn't provide the TACHO signal
-    if (tachoDelay != 0) {
-      unsigned long freq = 100000000 / tachoDelay;
-      LOG_INFO_F("FAN tacho delay:  %d µs\n", tachoDelay);
-      LOG_INFO_F("FAN frequency:    %d.%d Hz\n", freq/100, freq%100);
-
-      freq *= 60;
-      freq /= 200;
-      LOG_INFO_F("FAN current RPM:  %d \n", freq);
-
-      jsonDoc["stateFanRpm"] = freq;
-      if (enableMqtt && Mqtt.isReady()) Mqtt.client.publish((Mqtt.mqttTopic + "/fan-rpm").c_str(), String(freq).c_str(), true);
-    } else {
-      jsonDoc["stateFanRpm"] = 0;
-    }
-
-    jsonDoc["lastMixer"] = runtime() - lastMixerRun;
-    jsonDoc["stateMixer"] = stateMixer;
-    jsonDoc["stateDplus"] = stateDplus;
-    jsonDoc["statePoti"] = statePoti;
-    jsonDoc["statePwmSpeed"] = fanSpeed;
-    jsonDoc["stateTemperature"] = currentTemperature;
-    jsonDoc["stateHumidity"] = currentHumidity;
-    jsonDoc["stateDehumidification"] = stateDehumidification;
-
-    serializeJsonPretty(jsonDoc, jsonOutput);
-    events.send(jsonOutput.c_str(), "status", millis());
-
-    if (enableMqtt && Mqtt.isReady()) {
-      Mqtt.client.publish((Mqtt.mqttTopic + "/json").c_str(), jsonOutput.c_str(), true);
-      Mqtt.client.publish((Mqtt.mqttTopic + "/mixer").c_str(), String(stateMixer).c_str(), true);
-      Mqtt.client.publish((Mqtt.mqttTopic + "/dplus").c_str(), String(stateDplus).c_str(), true);
-      Mqtt.client.publish((Mqtt.mqttTopic + "/dehumidification").c_str(), String(stateDehumidification).c_str(), true);
-      Mqtt.client.publish((Mqtt.mqttTopic + "/potentiometer").c_str(), String(statePoti).c_str(), true);
-      Mqtt.client.publish((Mqtt.mqttTopic + "/pwm-speed").c_str(), String(fanSpeed).c_str(), true);
-      Mqtt.client.publish((Mqtt.mqttTopic + "/temperature").c_str(), String(currentTemperature).c_str(), true);
-      Mqtt.client.publish((Mqtt.mqttTopic + "/humidity").c_str(), String(currentHumidity).c_str(), true);
-    }
-
-    LOG_INFO_F("Temperature:      %.1f °C at %.1f %% humidity\n", currentTemperature, currentHumidity);
-  }
-  sleepOrDelay();
+  // Run the due jobs and idle until the next deadline, the button interrupt wakes us earlier
+  sleepOrDelay(Scheduler.runDue());
 }
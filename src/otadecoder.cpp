@@ -0,0 +1,288 @@
+/**
+ * @file otadecoder.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Streaming decoder of gzip compressed and delta OTA images
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <esp_rom_crc.h>
+#include "otadecoder.h"
+
+#define GZIP_FLAG_HCRC      0x02
+#define GZIP_FLAG_EXTRA     0x04
+#define GZIP_FLAG_NAME      0x08
+#define GZIP_FLAG_COMMENT   0x10
+
+static uint32_t readLe32(const uint8_t *data) {
+  return data[0] | data[1] << 8 | data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+void OtaDecoder::begin(otasink_fn sink, otasource_fn source, void *context) {
+  end();
+  this->sink = sink;
+  this->source = source;
+  this->context = context;
+  error = NULL;
+  detected = false;
+  outputBytes = 0;
+  gzip = GZ_NONE;
+  delta = DELTA_NONE;
+}
+
+void OtaDecoder::end() {
+  free(inflater);
+  free(dictionary);
+  free(scratch);
+  inflater = NULL;
+  dictionary = NULL;
+  scratch = NULL;
+  if (shaActive) mbedtls_sha256_free(&sha);
+  shaActive = false;
+}
+
+ota_format_t OtaDecoder::getFormat() {
+  bool isDelta = delta >= DELTA_HEADER;
+  if (gzip != GZ_NONE) return isDelta ? OTA_FORMAT_GZIP_DELTA : OTA_FORMAT_GZIP;
+  if (isDelta) return OTA_FORMAT_DELTA;
+  return detected ? OTA_FORMAT_PLAIN : OTA_FORMAT_UNKNOWN;
+}
+
+bool OtaDecoder::feed(const uint8_t *data, size_t len) {
+  if (error) return false;
+  if (!len) return true;
+
+  if (!detected) {
+    detected = true;
+    delta = DELTA_DETECT;
+    deltaLength = 0;
+    if (data[0] == 0x1F && (len < 2 || data[1] == 0x8B)) {
+      // The ROM inflater needs its 32 KiB dictionary, both only live during the update
+      inflater = (tinfl_decompressor *)malloc(sizeof(tinfl_decompressor));
+      dictionary = (uint8_t *)malloc(TINFL_LZ_DICT_SIZE);
+      if (!inflater || !dictionary) return fail("Out of memory for the gzip decoder");
+      tinfl_init(inflater);
+      dictionaryOffset = 0;
+      crc = inflated = 0;
+      gzip = GZ_HEADER;
+      gzipLength = 0;
+    }
+  }
+  return gzip != GZ_NONE ? feedGzip(data, len) : feedImage(data, len);
+}
+
+bool OtaDecoder::feedGzip(const uint8_t *data, size_t len) {
+  while (len) {
+    if (gzip < GZ_DATA) {
+      if (!feedGzipHeader(*data++)) return false;
+      len--;
+    } else if (gzip == GZ_DATA) {
+      if (!inflate(data, len)) return false;
+    } else if (gzip == GZ_TRAILER) {
+      gzipBytes[gzipLength++] = *data++;
+      len--;
+      if (gzipLength == 8) {
+        if (readLe32(gzipBytes) != crc || readLe32(gzipBytes + 4) != inflated) return fail("gzip CRC or size mismatch");
+        gzip = GZ_DONE;
+      }
+    } else return fail("Data after the end of the gzip stream");
+  }
+  return true;
+}
+
+OtaDecoder::gzip_stage_t OtaDecoder::nextGzipStage(gzip_stage_t after) {
+  if (after < GZ_EXTRA_LENGTH && gzipFlags & GZIP_FLAG_EXTRA) return GZ_EXTRA_LENGTH;
+  if (after < GZ_NAME && gzipFlags & GZIP_FLAG_NAME) return GZ_NAME;
+  if (after < GZ_COMMENT && gzipFlags & GZIP_FLAG_COMMENT) return GZ_COMMENT;
+  if (after < GZ_HCRC && gzipFlags & GZIP_FLAG_HCRC) return GZ_HCRC;
+  return GZ_DATA;
+}
+
+bool OtaDecoder::feedGzipHeader(uint8_t byte) {
+  switch (gzip) {
+    case GZ_HEADER:
+      gzipBytes[gzipLength++] = byte;
+      if (gzipLength < 10) return true;
+      if (gzipBytes[0] != 0x1F || gzipBytes[1] != 0x8B || gzipBytes[2] != 8) return fail("Unsupported gzip stream");
+      gzipFlags = gzipBytes[3];
+      gzipLength = 0;
+      gzip = nextGzipStage(GZ_HEADER);
+      break;
+    case GZ_EXTRA_LENGTH:
+      gzipBytes[gzipLength++] = byte;
+      if (gzipLength < 2) return true;
+      skip = gzipBytes[0] | gzipBytes[1] << 8;
+      gzipLength = 0;
+      gzip = skip ? GZ_EXTRA : nextGzipStage(GZ_EXTRA);
+      break;
+    case GZ_EXTRA:
+      if (--skip == 0) gzip = nextGzipStage(GZ_EXTRA);
+      break;
+    case GZ_NAME:
+    case GZ_COMMENT:
+      if (!byte) gzip = nextGzipStage(gzip);
+      break;
+    case GZ_HCRC:
+      if (++gzipLength == 2) {
+        gzipLength = 0;
+        gzip = GZ_DATA;
+      }
+      break;
+    default:
+      break;
+  }
+  return true;
+}
+
+bool OtaDecoder::inflate(const uint8_t *&data, size_t &len) {
+  while (true) {
+    size_t inSize = len;
+    size_t outSize = TINFL_LZ_DICT_SIZE - dictionaryOffset;
+    tinfl_status status = tinfl_decompress(inflater, data, &inSize, dictionary, dictionary + dictionaryOffset,
+      &outSize, TINFL_FLAG_HAS_MORE_INPUT);
+    data += inSize;
+    len -= inSize;
+
+    if (outSize) {
+      crc = esp_rom_crc32_le(crc, dictionary + dictionaryOffset, outSize);
+      inflated += outSize;
+      if (!feedImage(dictionary + dictionaryOffset, outSize)) return false;
+    }
+    dictionaryOffset = (dictionaryOffset + outSize) & (TINFL_LZ_DICT_SIZE - 1);
+
+    if (status == TINFL_STATUS_DONE) {
+      gzip = GZ_TRAILER;
+      gzipLength = 0;
+      return true;
+    }
+    if (status < 0) return fail("Corrupt gzip data");
+    if (status == TINFL_STATUS_NEEDS_MORE_INPUT && !len) return true;
+  }
+}
+
+bool OtaDecoder::feedImage(const uint8_t *data, size_t len) {
+  // Only the first bytes are buffered, to tell a delta apart from a plain image
+  if (delta == DELTA_DETECT && data[0] != OTADELTA_MAGIC[0] && !deltaLength) delta = DELTA_NONE;
+  while (len && (delta == DELTA_DETECT || delta == DELTA_HEADER)) {
+    deltaHeader[deltaLength++] = *data++;
+    len--;
+    if (delta == DELTA_DETECT && deltaLength == 4) {
+      if (memcmp(deltaHeader, OTADELTA_MAGIC, 4) == 0) delta = DELTA_HEADER;
+      else {
+        delta = DELTA_NONE;
+        if (!emit(deltaHeader, deltaLength)) return false;
+      }
+    } else if (delta == DELTA_HEADER && deltaLength == OTADELTA_HEADER_SIZE) {
+      if (!startDelta()) return false;
+    }
+  }
+  if (!len) return true;
+  return delta == DELTA_NONE ? emit(data, len) : feedDelta(data, len);
+}
+
+bool OtaDecoder::startDelta() {
+  if ((deltaHeader[4] | deltaHeader[5] << 8) != OTADELTA_VERSION) return fail("Unsupported delta version");
+  sourceSize = readLe32(deltaHeader + 8);
+  targetSize = readLe32(deltaHeader + 12);
+  memcpy(targetSha, deltaHeader + 48, sizeof(targetSha));
+  if (!source) return fail("No source for a delta update");
+
+  scratch = (uint8_t *)malloc(OTADECODER_SCRATCH);
+  if (!scratch) return fail("Out of memory for the delta decoder");
+
+  // The delta is only valid for the exact source image, check it before anything is written
+  uint8_t hash[32];
+  mbedtls_sha256_init(&sha);
+  shaActive = true;
+  mbedtls_sha256_starts_ret(&sha, 0);
+  for (uint32_t offset = 0; offset < sourceSize; offset += OTADECODER_SCRATCH) {
+    size_t chunk = sourceSize - offset < OTADECODER_SCRATCH ? sourceSize - offset : OTADECODER_SCRATCH;
+    if (!source(context, offset, scratch, chunk)) return fail("Unable to read the running firmware");
+    mbedtls_sha256_update_ret(&sha, scratch, chunk);
+  }
+  mbedtls_sha256_finish_ret(&sha, hash);
+  if (memcmp(hash, deltaHeader + 16, sizeof(hash))) return fail("Delta does not match the running firmware");
+
+  // From here on the hash covers the target image
+  mbedtls_sha256_starts_ret(&sha, 0);
+  deltaLength = 0;
+  delta = targetSize ? DELTA_OP : DELTA_DONE;
+  return true;
+}
+
+bool OtaDecoder::feedDelta(const uint8_t *data, size_t len) {
+  while (len) {
+    if (delta == DELTA_OP) {
+      deltaHeader[deltaLength++] = *data++;
+      len--;
+      uint8_t needed = deltaHeader[0] == OTADELTA_OP_ADD ? 9 : deltaHeader[0] == OTADELTA_OP_INSERT ? 5 : 0;
+      if (!needed) return fail("Invalid delta operation");
+      if (deltaLength < needed) continue;
+
+      if (deltaHeader[0] == OTADELTA_OP_ADD) {
+        sourceOffset = readLe32(deltaHeader + 1);
+        remaining = readLe32(deltaHeader + 5);
+        if (sourceOffset > sourceSize || remaining > sourceSize - sourceOffset) return fail("Delta reads beyond the source");
+        delta = DELTA_ADD;
+      } else {
+        remaining = readLe32(deltaHeader + 1);
+        delta = DELTA_INSERT;
+      }
+      if (remaining > targetSize - outputBytes) return fail("Delta exceeds the target size");
+      deltaLength = 0;
+    } else if (delta == DELTA_ADD) {
+      size_t chunk = std::min(std::min(len, (size_t)remaining), (size_t)OTADECODER_SCRATCH);
+      if (!source(context, sourceOffset, scratch, chunk)) return fail("Unable to read the running firmware");
+      for (size_t i = 0; i < chunk; i++) scratch[i] += data[i];
+      if (!emit(scratch, chunk)) return false;
+      data += chunk;
+      len -= chunk;
+      sourceOffset += chunk;
+      remaining -= chunk;
+    } else if (delta == DELTA_INSERT) {
+      size_t chunk = std::min(len, (size_t)remaining);
+      if (!emit(data, chunk)) return false;
+      data += chunk;
+      len -= chunk;
+      remaining -= chunk;
+    } else return fail("Data after the end of the delta");
+
+    if ((delta == DELTA_ADD || delta == DELTA_INSERT) && !remaining) delta = DELTA_OP;
+    if (delta == DELTA_OP && !deltaLength && outputBytes == targetSize) delta = DELTA_DONE;
+  }
+  return true;
+}
+
+bool OtaDecoder::emit(const uint8_t *data, size_t len) {
+  outputBytes += len;
+  if (shaActive) mbedtls_sha256_update_ret(&sha, data, len);
+  return sink(context, data, len) || fail("Unable to write the image");
+}
+
+bool OtaDecoder::finish() {
+  if (error) return false;
+  if (!detected) return fail("Empty image");
+  if (gzip != GZ_NONE && gzip != GZ_DONE) return fail("Incomplete gzip stream");
+
+  // An image shorter than the delta magic
+  if (delta == DELTA_DETECT) {
+    delta = DELTA_NONE;
+    if (deltaLength && !emit(deltaHeader, deltaLength)) return false;
+  }
+  if (delta != DELTA_NONE && delta != DELTA_DONE) return fail("Incomplete delta");
+
+  if (delta == DELTA_DONE) {
+    uint8_t hash[32];
+    mbedtls_sha256_finish_ret(&sha, hash);
+    if (memcmp(hash, targetSha, sizeof(hash))) return fail("Delta result does not match the target");
+  }
+  return true;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file otadecoder.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Streaming decoder of gzip compressed and delta OTA images
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef OTADECODER_h
+#define OTADECODER_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <esp32/rom/miniz.h>
+#include <mbedtls/sha256.h>
+
+// Images are detected by their first bytes, written by tools/ota-compress.py:
+//   0xE9        plain ESP32 app image (or any other image, e.g. LittleFS)
+//   1F 8B       gzip, inflated with the miniz of the ROM, may contain a delta
+//   "OGOD"      delta against the running app partition
+#define OTADELTA_MAGIC          "OGOD"
+#define OTADELTA_VERSION        1
+#define OTADELTA_HEADER_SIZE    80
+#define OTADELTA_OP_ADD         0x01    // u32 source offset, u32 length, then length bytes added to the source
+#define OTADELTA_OP_INSERT      0x02    // u32 length, then length literal bytes
+#define OTADECODER_SCRATCH      512
+
+enum ota_format_t : uint8_t {
+  OTA_FORMAT_UNKNOWN,
+  OTA_FORMAT_PLAIN,
+  OTA_FORMAT_GZIP,
+  OTA_FORMAT_DELTA,
+  OTA_FORMAT_GZIP_DELTA
+};
+
+// Receives the decoded image, false aborts the update
+typedef bool (*otasink_fn)(void *context, const uint8_t *data, size_t len);
+// Reads the source of a delta, i.e. the running app partition
+typedef bool (*otasource_fn)(void *context, uint32_t offset, uint8_t *data, size_t len);
+
+class OtaDecoder {
+    public:
+        ~OtaDecoder() { end(); }
+        void begin(otasink_fn sink, otasource_fn source, void *context);
+        bool feed(const uint8_t *data, size_t len);
+        // The gzip trailer and the delta target are verified here, before the image is activated
+        bool finish();
+        void end();
+
+        ota_format_t getFormat();
+        const char *getError() { return error; }
+        uint32_t getOutputBytes() { return outputBytes; }
+
+    private:
+        enum gzip_stage_t : uint8_t { GZ_NONE, GZ_HEADER, GZ_EXTRA_LENGTH, GZ_EXTRA, GZ_NAME, GZ_COMMENT, GZ_HCRC, GZ_DATA, GZ_TRAILER, GZ_DONE };
+        enum delta_stage_t : uint8_t { DELTA_NONE, DELTA_DETECT, DELTA_HEADER, DELTA_OP, DELTA_ADD, DELTA_INSERT, DELTA_DONE };
+
+        otasink_fn sink = NULL;
+        otasource_fn source = NULL;
+        void *context = NULL;
+        const char *error = NULL;
+        bool detected = false;
+        uint32_t outputBytes = 0;
+
+        // gzip
+        gzip_stage_t gzip = GZ_NONE;
+        uint8_t gzipBytes[10];          // Fixed part of the header, later the trailer
+        uint8_t gzipLength = 0;
+        uint8_t gzipFlags = 0;
+        uint16_t skip = 0;
+        tinfl_decompressor *inflater = NULL;
+        uint8_t *dictionary = NULL;
+        size_t dictionaryOffset = 0;
+        uint32_t crc = 0;
+        uint32_t inflated = 0;
+
+        // delta
+        delta_stage_t delta = DELTA_NONE;
+        uint8_t deltaHeader[OTADELTA_HEADER_SIZE];  // Also collects the header of each operation
+        uint8_t deltaLength = 0;
+        uint32_t sourceSize = 0;
+        uint32_t targetSize = 0;
+        uint8_t targetSha[32];
+        uint32_t sourceOffset = 0;
+        uint32_t remaining = 0;
+        uint8_t *scratch = NULL;
+        mbedtls_sha256_context sha;
+        bool shaActive = false;
+
+        bool fail(const char *message) { error = message; return false; }
+        bool feedGzip(const uint8_t *data, size_t len);
+        bool feedGzipHeader(uint8_t byte);
+        gzip_stage_t nextGzipStage(gzip_stage_t after);
+        bool inflate(const uint8_t *&data, size_t &len);
+        bool feedImage(const uint8_t *data, size_t len);
+        bool feedDelta(const uint8_t *data, size_t len);
+        bool startDelta();
+        bool emit(const uint8_t *data, size_t len);
+};
+
+#endif // OTADECODER_h
@@ -0,0 +1,356 @@
+/**
+ * @file otapull.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Pull firmware updates from a webinstaller manifest, resumed with HTTP range requests
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <ArduinoJson.h>
+#include <HTTPClient.h>
+#include <algorithm>
+#include <Update.h>
+#include <WiFi.h>
+#include <esp_ota_ops.h>
+#include "log.h"
+#include "otapull.h"
+#include "otawriter.h"
+
+#define OTAPULL_OFFLINE_RETRY_MS    60000   // Next periodic check if WiFi was not connected
+
+extern OtaWriterClass OtaWriter;
+extern bool otaRunning;
+
+// Paths without a scheme are relative to the manifest, e.g. for a plain local HTTP server
+static bool resolveUrl(char *target, size_t size, const char *base, const char *path) {
+  if (strstr(path, "://")) return strlcpy(target, path, size) < size;
+  const char *host = strstr(base, "://");
+  host = host ? host + 3 : base;
+  // An absolute path replaces everything after the host, a relative one only the file name
+  const char *end = path[0] == '/' ? strchr(host, '/') : strrchr(host, '/');
+  size_t prefix = !end ? strlen(base) : end - base + (path[0] != '/');
+  const char *separator = !end && path[0] != '/' ? "/" : "";
+  int length = snprintf(target, size, "%.*s%s%s", (int)prefix, base, separator, path);
+  return length >= 0 && (size_t)length < size;
+}
+
+// Output of "git describe --tags": "v1.2.3" or "v1.2.3-4-gabcdef0", 4 commits after the tag.
+// Missing parts are 0, a suffix like "-rc1" or "-dirty" is ignored.
+static bool parseVersion(const char *text, uint32_t parts[OTAPULL_VERSION_PARTS]) {
+  memset(parts, 0, OTAPULL_VERSION_PARTS * sizeof(uint32_t));
+  if (*text == 'v' || *text == 'V') text++;
+  if (!isdigit(*text)) return false;
+  char *end;
+  for (uint8_t i = 0; i < OTAPULL_VERSION_PARTS - 1; i++) {
+    parts[i] = strtoul(text, &end, 10);
+    text = end;
+    if (*text != '.' || !isdigit(text[1])) break;
+    text++;
+  }
+  if (*text == '-' && isdigit(text[1])) parts[OTAPULL_VERSION_PARTS - 1] = strtoul(text + 1, NULL, 10);
+  return true;
+}
+
+void OtaPullClass::begin(const char *currentVersion) {
+  this->currentVersion = currentVersion;
+  if (taskHandle) return;
+  lock = xSemaphoreCreateMutex();
+  xTaskCreate(&OtaPullClass::task, "PULL_task", OTAPULL_TASK_STACK, this, 1, &taskHandle);
+}
+
+void OtaPullClass::configure(const config_t &config) {
+  xSemaphoreTake(lock, portMAX_DELAY);
+  strlcpy(url, config.updateUrl, sizeof(url));
+  intervalMs = config.updateInterval * 60000UL;
+  autoUpdate = config.autoUpdate;
+  xSemaphoreGive(lock);
+  if (taskHandle) xTaskNotifyGive(taskHandle);
+}
+
+bool OtaPullClass::check(bool install) {
+  if (!taskHandle) return false;
+  // The PULL_task takes the requests and enters OTAPULL_STATE_CHECKING under the same lock
+  xSemaphoreTake(lock, portMAX_DELAY);
+  bool busy = state == OTAPULL_STATE_CHECKING || state == OTAPULL_STATE_DOWNLOADING;
+  if (!busy) {
+    checkRequested = true;
+    installRequested = install;
+  }
+  xSemaphoreGive(lock);
+  if (busy) return false;
+  xTaskNotifyGive(taskHandle);
+  return true;
+}
+
+otapullstats_t OtaPullClass::getStats() {
+  uint32_t elapsed = state == OTAPULL_STATE_DOWNLOADING ? millis() - startMs : durationMs;
+  uint32_t kbps = elapsed ? (uint64_t)bytes * 1000 / 1024 / elapsed : 0;
+  return { state, checks, downloads, resumes, bytes, imageSize, elapsed, kbps, error };
+}
+
+void OtaPullClass::fail(const char *message) {
+  error = message;
+  state = OTAPULL_STATE_FAILED;
+  LOG_INFO_F("[PULL] Error: %s\n", message);
+}
+
+bool OtaPullClass::fetchManifest(const char *manifestUrl) {
+  // See otapull.h, a plain WiFiClient can not talk to a TLS server
+  if (!strncasecmp(manifestUrl, "https://", 8)) {
+    fail("HTTPS is not supported for the manifest");
+    return false;
+  }
+  WiFiClient client;
+  HTTPClient http;
+  http.setConnectTimeout(OTAPULL_TIMEOUT_MS);
+  http.setTimeout(OTAPULL_TIMEOUT_MS);
+  http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
+  if (!http.begin(client, manifestUrl)) {
+    fail("Invalid manifest URL");
+    return false;
+  }
+  int code = http.GET();
+  if (code != HTTP_CODE_OK) {
+    LOG_INFO_F("[PULL] Manifest %s: HTTP %d\n", manifestUrl, code);
+    http.end();
+    fail("Unable to load the manifest");
+    return false;
+  }
+  DynamicJsonDocument doc(OTAPULL_MANIFEST_SIZE);
+  DeserializationError result = deserializeJson(doc, http.getString());
+  http.end();
+  if (result) {
+    fail("Invalid manifest");
+    return false;
+  }
+
+  // The part written to the inactive app slot, the manifest lists the same image for both
+  const esp_partition_t *next = esp_ota_get_next_update_partition(NULL);
+  const char *path = NULL;
+  for (JsonObject part : doc["builds"][0]["parts"].as<JsonArray>()) {
+    if (!next || part["offset"] != next->address) continue;
+    path = part["path"];
+    imageSize = part["size"] | 0;
+    strlcpy(imageSha256, part["sha256"] | "", sizeof(imageSha256));
+    break;
+  }
+  if (!path) {
+    fail("No image for the next app partition in the manifest");
+    return false;
+  }
+  strlcpy(availableVersion, doc["version"] | "", sizeof(availableVersion));
+  if (!availableVersion[0]) {
+    fail("Manifest without a version");
+    return false;
+  }
+
+  if (!resolveUrl(imageUrl, sizeof(imageUrl), manifestUrl, path)) {
+    fail("Image URL too long");
+    return false;
+  }
+  if (!strncasecmp(imageUrl, "https://", 8)) {
+    fail("HTTPS is not supported for the image");
+    return false;
+  }
+  return true;
+}
+
+// 1 when the image is complete, 0 if the connection was interrupted, -1 if a retry makes no sense
+int8_t OtaPullClass::transfer(uint32_t &offset, uint8_t *buffer) {
+  WiFiClient client;
+  HTTPClient http;
+  http.setConnectTimeout(OTAPULL_TIMEOUT_MS);
+  http.setTimeout(OTAPULL_TIMEOUT_MS);
+  http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
+  http.setReuse(false);
+  if (!http.begin(client, imageUrl)) {
+    fail("Invalid image URL");
+    return -1;
+  }
+  const char *headers[] = { "Content-Range" };
+  http.collectHeaders(headers, 1);
+  if (offset) {
+    char range[24];
+    snprintf(range, sizeof(range), "bytes=%u-", offset);
+    http.addHeader("Range", range);
+  }
+
+  int code = http.GET();
+  uint32_t skip = 0;
+  if (code == HTTP_CODE_PARTIAL_CONTENT) {
+    // Content-Range: bytes <first>-<last>/<size>
+    uint32_t first, last, size = 0;
+    if (sscanf(http.header("Content-Range").c_str(), "bytes %u-%u/%u", &first, &last, &size) < 2 || first > offset) {
+      http.end();
+      fail("Invalid Content-Range of the server");
+      return -1;
+    }
+    skip = offset - first;
+    if (!imageSize) imageSize = size;
+  } else if (code == HTTP_CODE_OK) {
+    // No range support, the part that is already written is downloaded again and dropped
+    skip = offset;
+    if (!imageSize && http.getSize() > 0) imageSize = http.getSize();
+  } else {
+    LOG_INFO_F("[PULL] Image %s: HTTP %d\n", imageUrl, code);
+    http.end();
+    if (code < 0 || code >= 500) return 0;
+    fail("Unable to download the image");
+    return -1;
+  }
+  if (!imageSize) {
+    http.end();
+    fail("Image size unknown");
+    return -1;
+  }
+
+  // OtaWriter.write() blocks while the flash is busy, the TCP window throttles the server meanwhile
+  WiFiClient *stream = http.getStreamPtr();
+  uint32_t lastData = millis();
+  while (offset < imageSize) {
+    size_t available = stream->available();
+    if (!available) {
+      if (!stream->connected() || millis() - lastData > OTAPULL_TIMEOUT_MS) break;
+      vTaskDelay(1);
+      continue;
+    }
+    int len = stream->read(buffer, min(available, (size_t)OTAPULL_READ_SIZE));
+    if (len <= 0) break;
+    lastData = millis();
+    bytes += len;
+
+    uint32_t drop = min(skip, (uint32_t)len);
+    skip -= drop;
+    uint32_t chunk = min((uint32_t)len - drop, imageSize - offset);
+    if (chunk && !OtaWriter.write(buffer + drop, chunk, OTA_STALL_TIMEOUT_MS)) {
+      http.end();
+      fail(OtaWriter.getError() ? OtaWriter.getError() : "Unable to write the image");
+      return -1;
+    }
+    offset += chunk;
+  }
+  http.end();
+  return offset >= imageSize ? 1 : 0;
+}
+
+bool OtaPullClass::download() {
+  if (!OtaWriter.start(U_FLASH, this, imageSize, imageSha256[0] ? imageSha256 : NULL)) {
+    fail(OtaWriter.isRunning() ? "Another update is running" : OtaWriter.getError());
+    return false;
+  }
+  // Only once the writer is ours, an upload in the UI owns the flag otherwise.
+  // The mixer and the fan control pause until the download ended.
+  otaRunning = true;
+  uint8_t *buffer = (uint8_t *)malloc(OTAPULL_READ_SIZE);
+  if (!buffer) {
+    OtaWriter.abort();
+    otaRunning = false;
+    fail("Out of memory");
+    return false;
+  }
+
+  LOG_INFO_F("[PULL] Downloading %s from %s\n", availableVersion, imageUrl);
+  downloads++;
+  bytes = 0;
+  startMs = millis();
+  state = OTAPULL_STATE_DOWNLOADING;
+
+  // Only attempts in a row without progress count, a flaky link still gets the image through
+  uint32_t offset = 0;
+  uint8_t failures = 0;
+  int8_t result;
+  while (true) {
+    uint32_t previous = offset;
+    result = transfer(offset, buffer);
+    if (result != 0) break;
+    failures = offset > previous ? 1 : failures + 1;
+    if (failures >= OTAPULL_ATTEMPTS) break;
+    vTaskDelay(pdMS_TO_TICKS(OTAPULL_RETRY_DELAY_MS << (failures - 1)));
+    if (offset) {
+      resumes++;
+      LOG_INFO_F("[PULL] Resuming at %u of %u bytes\n", offset, imageSize);
+    }
+  }
+  free(buffer);
+  durationMs = millis() - startMs;
+
+  if (result <= 0) {
+    OtaWriter.abort();
+    otaRunning = false;
+    if (result == 0) fail("Download interrupted too often");
+    return false;
+  }
+  bool finished = OtaWriter.finish();
+  otaRunning = false;
+  if (!finished) {
+    fail(OtaWriter.getError() ? OtaWriter.getError() : "Update error");
+    return false;
+  }
+  otapullstats_t stats = getStats();
+  LOG_INFO_F("[PULL] Update to %s successful, %u bytes in %u ms (%u KiB/s), %u resumes\n",
+    availableVersion, stats.bytes, stats.durationMs, stats.kbps, resumes);
+  return true;
+}
+
+void OtaPullClass::task(void *parameter) {
+  OtaPullClass *self = (OtaPullClass *)parameter;
+  uint32_t waitMs = 0;
+  while (1) {
+    // Woken up early by check() and configure()
+    ulTaskNotifyTake(pdTRUE, waitMs ? pdMS_TO_TICKS(waitMs) : portMAX_DELAY);
+
+    char manifestUrl[CONFIG_URL_SIZE];
+    xSemaphoreTake(self->lock, portMAX_DELAY);
+    strlcpy(manifestUrl, self->url, sizeof(manifestUrl));
+    bool requested = self->checkRequested;
+    bool install = self->installRequested || self->autoUpdate;
+    self->checkRequested = self->installRequested = false;
+    waitMs = self->intervalMs;
+    bool connected = WiFi.isConnected();
+    if (manifestUrl[0] && connected) {
+      self->error = NULL;
+      self->state = OTAPULL_STATE_CHECKING;
+    }
+    xSemaphoreGive(self->lock);
+
+    if (!manifestUrl[0]) {
+      if (requested) self->fail("No update URL configured");
+      continue;
+    }
+    if (!connected) {
+      if (requested) self->fail("WiFi is not connected");
+      else if (waitMs) waitMs = min(waitMs, (uint32_t)OTAPULL_OFFLINE_RETRY_MS);
+      continue;
+    }
+
+    self->checks++;
+    if (!self->fetchManifest(manifestUrl)) continue;
+    // Only a newer version is installed, an older manifest must not downgrade the devices
+    uint32_t available[OTAPULL_VERSION_PARTS], running[OTAPULL_VERSION_PARTS];
+    if (!parseVersion(self->availableVersion, available) || !parseVersion(self->currentVersion, running)) {
+      LOG_INFO_F("[PULL] Unable to compare version %s with %s\n", self->availableVersion, self->currentVersion);
+      self->fail("Version of the manifest or the firmware is not comparable");
+      continue;
+    }
+    if (!std::lexicographical_compare(running, running + OTAPULL_VERSION_PARTS, available, available + OTAPULL_VERSION_PARTS)) {
+      if (strcmp(self->availableVersion, self->currentVersion)) {
+        LOG_INFO_F("[PULL] Ignoring version %s, running the newer %s\n", self->availableVersion, self->currentVersion);
+      }
+      self->state = OTAPULL_STATE_UPTODATE;
+      continue;
+    }
+    LOG_INFO_F("[PULL] Version %s available, running %s\n", self->availableVersion, self->currentVersion);
+    if (!install) {
+      self->state = OTAPULL_STATE_AVAILABLE;
+      continue;
+    }
+    if (!self->download()) continue;
+    self->state = OTAPULL_STATE_SUCCESS;
+    if (self->successCallback) self->successCallback();
+  }
+}
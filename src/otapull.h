@@ -0,0 +1,106 @@
+/**
+ * @file otapull.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Pull firmware updates from a webinstaller manifest, resumed with HTTP range requests
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef OTAPULL_h
+#define OTAPULL_h
+
+#include <Arduino.h>
+#include <functional>
+#include "config.h"
+
+#define OTAPULL_TASK_STACK          6144
+#define OTAPULL_MANIFEST_SIZE       3072    // JSON document of the manifest
+#define OTAPULL_READ_SIZE           2048    // Read from the socket per call
+#define OTAPULL_TIMEOUT_MS          10000   // Connect and read timeout
+#define OTAPULL_ATTEMPTS            6       // Failed connections in a row without any progress
+#define OTAPULL_RETRY_DELAY_MS      2000    // Doubled with every failure in a row
+#define OTAPULL_VERSION_SIZE        48
+#define OTAPULL_VERSION_PARTS       4       // major.minor.patch and the commits since the tag
+
+enum otapull_state_t : uint8_t {
+  OTAPULL_STATE_IDLE,
+  OTAPULL_STATE_CHECKING,
+  OTAPULL_STATE_UPTODATE,
+  OTAPULL_STATE_AVAILABLE,      // Newer version found, waiting for install()
+  OTAPULL_STATE_DOWNLOADING,
+  OTAPULL_STATE_SUCCESS,
+  OTAPULL_STATE_FAILED
+};
+
+struct otapullstats_t {
+  otapull_state_t state;
+  uint32_t checks;
+  uint32_t downloads;
+  uint32_t resumes;         // Range requests after an interrupted transfer, over all downloads
+  uint32_t bytes;           // Received in the last download, including data skipped for a server without range support
+  uint32_t size;            // Of the image in the last download
+  uint32_t durationMs;      // Of the last download, including the retry delays
+  uint32_t kbps;
+  const char *error;
+};
+
+// The manifest and the image are loaded over plain HTTP, https:// URLs are rejected. Nothing
+// authenticates the server: the SHA-256 of the manifest only detects a broken transfer, not a
+// tampered manifest. Use a server in a trusted network. Only versions newer than the running
+// one are installed (see parseVersion() in otapull.cpp), a replayed old manifest is ignored.
+class OtaPullClass {
+    public:
+        // Starts the PULL_task, it checks the manifest every updateInterval minutes
+        void begin(const char *currentVersion);
+        // Takes the URL, interval and auto install setting, the next check runs at once
+        void configure(const config_t &config);
+
+        // Runs the check in the PULL_task, with install the available version is installed right away
+        bool check(bool install);
+        // Called from the PULL_task after the image was verified and activated
+        void onSuccess(std::function<void()> callback) { successCallback = callback; }
+
+        otapull_state_t getState() { return state; }
+        const char *getCurrentVersion() { return currentVersion; }
+        const char *getAvailableVersion() { return availableVersion; }
+        otapullstats_t getStats();
+
+    private:
+        const char *currentVersion = "";
+        char url[CONFIG_URL_SIZE] = "";
+        uint32_t intervalMs = 0;
+        bool autoUpdate = false;
+        volatile bool checkRequested = false;
+        volatile bool installRequested = false;
+        SemaphoreHandle_t lock = NULL;
+        TaskHandle_t taskHandle = NULL;
+        std::function<void()> successCallback = NULL;
+
+        // Part of the manifest for the partition that is updated next
+        char availableVersion[OTAPULL_VERSION_SIZE] = "";
+        char imageUrl[2 * CONFIG_URL_SIZE] = "";
+        char imageSha256[65] = "";
+        uint32_t imageSize = 0;
+
+        volatile otapull_state_t state = OTAPULL_STATE_IDLE;
+        const char *error = NULL;
+        uint32_t checks = 0;
+        uint32_t downloads = 0;
+        uint32_t resumes = 0;
+        volatile uint32_t bytes = 0;
+        uint32_t startMs = 0;
+        uint32_t durationMs = 0;
+
+        bool fetchManifest(const char *manifestUrl);
+        bool download();
+        int8_t transfer(uint32_t &offset, uint8_t *buffer);
+        void fail(const char *message);
+        static void task(void *parameter);
+};
+
+#endif // OTAPULL_h
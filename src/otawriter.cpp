@@ -0,0 +1,296 @@
+/**
+ * @file otawriter.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Double buffered firmware writer, decoding, flash writes and SHA-256 run in their own task
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <Update.h>
+#include <esp_ota_ops.h>
+#include "assets.h"
+#include "log.h"
+#include "otawriter.h"
+
+bool OtaWriterClass::start(int command, const void *owner, uint32_t total, const char *sha256) {
+  if (state == OTA_STATE_WRITING && !ending) return false;
+  // The task has not confirmed the end of the previous update yet and may still use its buffers
+  if (buffers[0] && !settle(OTA_CMD_ABORT, OTA_WRITE_WAIT_MS)) return false;
+
+  // The task and the queues stay, only the buffers are allocated per update
+  if (blocks == NULL) {
+    blocks = xQueueCreate(OTA_BUFFERS + 1, sizeof(otablock_t));
+    freeBuffers = xQueueCreate(OTA_BUFFERS, sizeof(uint8_t *));
+    done = xSemaphoreCreateBinary();
+    if (!blocks || !freeBuffers || !done) {
+      fail("Unable to create the writer queues");
+      return false;
+    }
+    xTaskCreate(&OtaWriterClass::task, "OTA_task", OTA_TASK_STACK, this, 2, NULL);
+  }
+
+  error = NULL;
+  bytes = imageBytes = stallMs = durationMs = 0;
+  format = OTA_FORMAT_UNKNOWN;
+  this->total = total;
+  xQueueReset(blocks);
+  xQueueReset(freeBuffers);
+  xSemaphoreTake(done, 0);
+  for (uint8_t i = 0; i < OTA_BUFFERS; i++) {
+    buffers[i] = (uint8_t *)malloc(OTA_BLOCK_SIZE);
+    if (!buffers[i]) {
+      release();
+      fail("Out of memory");
+      return false;
+    }
+    if (i) xQueueSend(freeBuffers, &buffers[i], 0);
+  }
+  current = buffers[0];
+  filled = 0;
+
+  expected[0] = '\0';
+  if (sha256 && strlen(sha256) == 64) {
+    for (uint8_t i = 0; i <= 64; i++) expected[i] = tolower(sha256[i]);
+  }
+  digest[0] = '\0';
+
+  assets = NULL;
+  if (command == OTA_COMMAND_ASSETS) {
+    // Erased sector by sector while writing, the bundle in use stays mapped until the reboot
+    assets = esp_partition_find_first(ASSETS_PARTITION_TYPE, ESP_PARTITION_SUBTYPE_ANY, ASSETS_PARTITION_LABEL);
+    erased = 0;
+    if (!assets) {
+      release();
+      fail("No assets partition, flash the new partition table first");
+      return false;
+    }
+  } else if (!Update.begin(UPDATE_SIZE_UNKNOWN, command)) {
+    release();
+    fail(Update.errorString());
+    return false;
+  }
+  mbedtls_sha256_init(&sha);
+  mbedtls_sha256_starts_ret(&sha, 0);
+  // A delta is always relative to the running app, there is no source for the filesystem
+  decoder.begin(&OtaWriterClass::writeImage, command == U_FLASH ? &OtaWriterClass::readRunning : NULL, this);
+
+  this->owner = owner;
+  startMs = millis();
+  lastProgress = 0;
+  state = OTA_STATE_WRITING;
+  report(true);
+  return true;
+}
+
+bool OtaWriterClass::write(const uint8_t *data, size_t len, uint32_t waitMs) {
+  while (len) {
+    if (state != OTA_STATE_WRITING) return false;
+    if (!current) {
+      // Both buffers are queued for the flash, this is where the TCP window would stall
+      uint32_t waitStart = millis();
+      if (xQueueReceive(freeBuffers, &current, pdMS_TO_TICKS(waitMs)) != pdTRUE) {
+        current = NULL;
+        fail("Timeout while writing to the flash");
+        return false;
+      }
+      stallMs += millis() - waitStart;
+      filled = 0;
+    }
+
+    size_t chunk = min(len, (size_t)(OTA_BLOCK_SIZE - filled));
+    memcpy(current + filled, data, chunk);
+    filled += chunk;
+    data += chunk;
+    len -= chunk;
+    if (filled == OTA_BLOCK_SIZE) {
+      if (!submit(OTA_CMD_WRITE, current, filled, waitMs)) return false;
+      current = NULL;
+    }
+  }
+  return true;
+}
+
+bool OtaWriterClass::finish() {
+  if (state != OTA_STATE_WRITING) {
+    abort();
+    return false;
+  }
+  if (current && filled) submit(OTA_CMD_WRITE, current, filled, OTA_WRITE_WAIT_MS);
+  current = NULL;
+
+  if (!settle(OTA_CMD_FINISH, OTA_FINISH_TIMEOUT_MS)) {
+    fail("Timeout while finishing the update");
+    return false;
+  }
+  return state == OTA_STATE_SUCCESS;
+}
+
+void OtaWriterClass::abort() {
+  if (!buffers[0]) return;
+  settle(OTA_CMD_ABORT, OTA_WRITE_WAIT_MS);
+}
+
+otaprogress_t OtaWriterClass::getProgress() {
+  uint32_t elapsed = state == OTA_STATE_WRITING ? millis() - startMs : durationMs;
+  uint32_t kbps = elapsed ? (uint64_t)bytes * 1000 / 1024 / elapsed : 0;
+  return { state, bytes, total, kbps, stallMs, error };
+}
+
+bool OtaWriterClass::submit(otacommand_t command, uint8_t *data, uint16_t length, uint32_t waitMs) {
+  otablock_t block = { command, data, length };
+  if (xQueueSend(blocks, &block, pdMS_TO_TICKS(waitMs)) == pdTRUE) return true;
+  fail("Writer task does not respond");
+  return false;
+}
+
+// Ends the update with FINISH or ABORT and frees the buffers once the task confirmed it. Until then
+// queued blocks still point into them, so without the confirmation they stay allocated and the next
+// call of abort() or start() picks up the outstanding confirmation.
+bool OtaWriterClass::settle(otacommand_t command, uint32_t waitMs) {
+  if (!ending) ending = submit(command, NULL, 0, waitMs);
+  if (!ending || xSemaphoreTake(done, pdMS_TO_TICKS(waitMs)) != pdTRUE) {
+    current = NULL;
+    owner = NULL;
+    return false;
+  }
+  ending = false;
+  release();
+  return true;
+}
+
+void OtaWriterClass::fail(const char *message) {
+  if (state == OTA_STATE_FAILED && error) return;
+  error = message;
+  state = OTA_STATE_FAILED;
+  LOG_INFO_F("[OTA] Error: %s\n", message);
+}
+
+void OtaWriterClass::report(bool force) {
+  uint32_t now = millis();
+  if (!progressCallback || (!force && now - lastProgress < OTA_PROGRESS_INTERVAL_MS)) return;
+  lastProgress = now;
+  progressCallback(getProgress());
+}
+
+void OtaWriterClass::release() {
+  for (uint8_t i = 0; i < OTA_BUFFERS; i++) {
+    free(buffers[i]);
+    buffers[i] = NULL;
+  }
+  current = NULL;
+  owner = NULL;
+}
+
+const char *OtaWriterClass::imageError() {
+  if (!assets && Update.hasError()) return Update.errorString();
+  return decoder.getError();
+}
+
+// The header sector is erased, so the AssetHandler falls back to LittleFS instead of checking a partial bundle
+void OtaWriterClass::abortImage() {
+  if (!assets) Update.abort();
+  else if (erased) esp_partition_erase_range(assets, 0, SPI_FLASH_SEC_SIZE);
+}
+
+bool OtaWriterClass::endImage() {
+  if (!assets) return Update.end(true);
+
+  // Only a bundle the AssetHandler accepts after the reboot is a success
+  const void *mapped = NULL;
+  spi_flash_mmap_handle_t handle;
+  bool valid = false;
+  if (esp_partition_mmap(assets, 0, assets->size, SPI_FLASH_MMAP_DATA, &mapped, &handle) == ESP_OK) {
+    AssetBundle bundle;
+    valid = bundle.open((const uint8_t *)mapped, assets->size) && bundle.getSize() == imageBytes;
+    spi_flash_munmap(handle);
+  }
+  if (!valid) {
+    abortImage();
+    fail("Invalid asset bundle");
+  }
+  return valid;
+}
+
+bool OtaWriterClass::writeImage(void *context, const uint8_t *data, size_t len) {
+  OtaWriterClass *self = (OtaWriterClass *)context;
+  if (self->assets) {
+    uint32_t offset = self->imageBytes;
+    if (len > self->assets->size - offset) {
+      self->fail("Asset bundle exceeds the partition");
+      return false;
+    }
+    if (offset + len > self->erased) {
+      uint32_t end = (offset + len + SPI_FLASH_SEC_SIZE - 1) / SPI_FLASH_SEC_SIZE * SPI_FLASH_SEC_SIZE;
+      if (esp_partition_erase_range(self->assets, self->erased, end - self->erased) != ESP_OK) {
+        self->fail("Unable to erase the assets partition");
+        return false;
+      }
+      self->erased = end;
+    }
+    if (esp_partition_write(self->assets, offset, data, len) != ESP_OK) {
+      self->fail("Unable to write the assets partition");
+      return false;
+    }
+  } else if (Update.write((uint8_t *)data, len) != len) return false;
+  self->imageBytes += len;
+  return true;
+}
+
+bool OtaWriterClass::readRunning(void *context, uint32_t offset, uint8_t *data, size_t len) {
+  const esp_partition_t *running = esp_ota_get_running_partition();
+  return running && esp_partition_read(running, offset, data, len) == ESP_OK;
+}
+
+void OtaWriterClass::task(void *parameter) {
+  OtaWriterClass *self = (OtaWriterClass *)parameter;
+  otablock_t block;
+  while (1) {
+    if (xQueueReceive(self->blocks, &block, portMAX_DELAY) != pdTRUE) continue;
+
+    if (block.command == OTA_CMD_WRITE) {
+      // After an error the blocks are only returned until the update is finished or aborted
+      if (self->state == OTA_STATE_WRITING) {
+        mbedtls_sha256_update_ret(&self->sha, block.data, block.length);
+        bool written = self->decoder.feed(block.data, block.length);
+        self->format = self->decoder.getFormat();
+        if (!written) self->fail(self->imageError());
+        else {
+          self->bytes += block.length;
+          self->report(false);
+        }
+      }
+      xQueueSend(self->freeBuffers, &block.data, 0);
+      continue;
+    }
+
+    if (block.command == OTA_CMD_FINISH && self->state == OTA_STATE_WRITING) {
+      uint8_t hash[32];
+      mbedtls_sha256_finish_ret(&self->sha, hash);
+      for (uint8_t i = 0; i < sizeof(hash); i++) sprintf(self->digest + 2 * i, "%02x", hash[i]);
+
+      if (self->expected[0] && strcmp(self->expected, self->digest)) {
+        self->abortImage();
+        self->fail("SHA-256 does not match");
+      } else if (!self->decoder.finish()) {
+        // gzip trailer or delta target mismatch, the boot partition stays untouched
+        self->abortImage();
+        self->fail(self->imageError());
+      } else if (!self->endImage()) {
+        self->fail(self->imageError());
+      } else self->state = OTA_STATE_SUCCESS;
+    } else {
+      self->abortImage();
+      self->fail("Update aborted");
+    }
+    mbedtls_sha256_free(&self->sha);
+    self->decoder.end();
+    self->durationMs = millis() - self->startMs;
+    self->report(true);
+    xSemaphoreGive(self->done);
+  }
+}
@@ -0,0 +1,127 @@
+/**
+ * @file otawriter.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Double buffered firmware writer, decoding, flash writes and SHA-256 run in their own task
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef OTAWRITER_h
+#define OTAWRITER_h
+
+#include <Arduino.h>
+#include <functional>
+#include <esp_partition.h>
+#include <esp_spi_flash.h>
+#include <mbedtls/sha256.h>
+#include "otadecoder.h"
+
+#define OTA_BLOCK_SIZE              (2 * SPI_FLASH_SEC_SIZE)  // Whole sectors, each block ends in a flash write
+#define OTA_BUFFERS                 2
+#define OTA_TASK_STACK              4096
+#define OTA_STALL_TIMEOUT_MS        10000   // Give up if the flash does not keep up for this long
+#define OTA_WRITE_WAIT_MS           2000    // Default wait in write() and abort(), below the 5 s watchdog of async_tcp
+#define OTA_FINISH_TIMEOUT_MS       15000
+#define OTA_PROGRESS_INTERVAL_MS    500
+#define OTA_COMMAND_ASSETS          300     // Asset bundle partition, next to U_FLASH (0) and U_SPIFFS (100) of Update.h
+
+enum ota_state_t : uint8_t {
+  OTA_STATE_IDLE,
+  OTA_STATE_WRITING,
+  OTA_STATE_SUCCESS,
+  OTA_STATE_FAILED
+};
+
+struct otaprogress_t {
+  ota_state_t state;
+  uint32_t bytes;           // Written to flash
+  uint32_t total;           // Expected size, 0 if unknown
+  uint32_t kbps;            // Average since the start in KiB/s
+  uint32_t stallMs;         // Time the network side waited for a free buffer
+  const char *error;
+};
+
+typedef std::function<void(const otaprogress_t &progress)> otaprogress_fn;
+
+class OtaWriterClass {
+    public:
+        // Called from the writer task, at most every OTA_PROGRESS_INTERVAL_MS and once at the end
+        void onProgress(otaprogress_fn callback) { progressCallback = callback; }
+
+        // command is U_FLASH, U_SPIFFS or OTA_COMMAND_ASSETS, sha256 is an optional hex digest the uploaded file must match.
+        // The asset bundle is written to its partition without Update and checked by AssetBundle::open before success.
+        // The owner, e.g. the request, tells apart the chunks of the running update.
+        // Plain, gzip compressed and (only for U_FLASH) delta images are accepted, see otadecoder.h.
+        bool start(int command, const void *owner, uint32_t total = 0, const char *sha256 = NULL);
+        // Copies into the current buffer, blocks only while both buffers wait for the flash and
+        // fails after waitMs. Tasks that may block, e.g. the pull update, pass OTA_STALL_TIMEOUT_MS.
+        bool write(const uint8_t *data, size_t len, uint32_t waitMs = OTA_WRITE_WAIT_MS);
+        // Flushes the last block, verifies the digest and activates the image
+        bool finish();
+        // Waits at most OTA_WRITE_WAIT_MS for the task, the buffers are kept until it confirmed
+        void abort();
+
+        bool isRunning() { return state == OTA_STATE_WRITING; }
+        bool isOwnedBy(const void *owner) { return owner && this->owner == owner; }
+        ota_state_t getState() { return state; }
+        const char *getError() { return error; }
+        const char *getDigest() { return digest; }
+        ota_format_t getFormat() { return format; }
+        uint32_t getImageBytes() { return imageBytes; }
+        otaprogress_t getProgress();
+
+    private:
+        enum otacommand_t : uint8_t { OTA_CMD_WRITE, OTA_CMD_FINISH, OTA_CMD_ABORT };
+        struct otablock_t {
+          otacommand_t command;
+          uint8_t *data;
+          uint16_t length;
+        };
+
+        const void *owner = NULL;
+        QueueHandle_t blocks = NULL;        // To the writer task
+        QueueHandle_t freeBuffers = NULL;   // Back to the network side
+        SemaphoreHandle_t done = NULL;
+        volatile bool ending = false;       // FINISH or ABORT is queued, done not taken yet
+        uint8_t *buffers[OTA_BUFFERS] = {};
+        uint8_t *current = NULL;
+        uint16_t filled = 0;
+
+        mbedtls_sha256_context sha;
+        OtaDecoder decoder;
+        const esp_partition_t *assets = NULL;   // Target of OTA_COMMAND_ASSETS, NULL for Update
+        uint32_t erased = 0;                    // Bytes of the assets partition erased so far
+        volatile ota_format_t format = OTA_FORMAT_UNKNOWN;
+        volatile uint32_t imageBytes = 0;  // Decoded, differs from bytes for compressed images
+        char expected[65] = "";
+        char digest[65] = "";
+
+        volatile ota_state_t state = OTA_STATE_IDLE;
+        const char *error = NULL;
+        uint32_t total = 0;
+        volatile uint32_t bytes = 0;
+        uint32_t startMs = 0;
+        uint32_t durationMs = 0;
+        uint32_t stallMs = 0;
+        uint32_t lastProgress = 0;
+        otaprogress_fn progressCallback = NULL;
+
+        bool submit(otacommand_t command, uint8_t *data, uint16_t length, uint32_t waitMs);
+        bool settle(otacommand_t command, uint32_t waitMs);
+        void fail(const char *message);
+        void report(bool force);
+        void release();
+        const char *imageError();
+        void abortImage();
+        bool endImage();
+        static void task(void *parameter);
+        static bool writeImage(void *context, const uint8_t *data, size_t len);
+        static bool readRunning(void *context, uint32_t offset, uint8_t *data, size_t len);
+};
+
+#endif // OTAWRITER_h
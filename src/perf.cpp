@@ -0,0 +1,91 @@
+/**
+ * @file perf.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Scoped timer probes with latency histograms
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <esp_timer.h>
+#include "format.h"
+#include "perf.h"
+
+void PerfClass::begin(bool enabled) {
+  // Cost of one empty scope, used to estimate the overhead. A single scope is below the
+  // resolution of the timer, so average over a batch.
+  const uint16_t rounds = 1000;
+  bool previous = this->enabled;
+  this->enabled = true;
+  int64_t start = esp_timer_get_time();
+  for (uint16_t i = 0; i < rounds; i++) {
+    PERF_SCOPE(PERF_PROBE_OTA);
+  }
+  probeCostNs = (esp_timer_get_time() - start) * 1000 / rounds;
+  this->enabled = previous;
+
+  reset();
+  setEnabled(enabled);
+}
+
+void PerfClass::reset() {
+  memset(probes, 0, sizeof(probes));
+  since = esp_timer_get_time();
+}
+
+void PerfClass::record(perf_probe_t probe, uint32_t us) {
+  perfprobe_t &p = probes[probe];
+  p.count++;
+  p.totalUs += us;
+  if (us > p.maxUs) p.maxUs = us;
+  uint8_t bucket = us ? 32 - __builtin_clz(us) : 0;
+  p.histogram[min(bucket, (uint8_t)(PERF_BUCKETS - 1))]++;
+}
+
+const char *PerfClass::getName(perf_probe_t probe) {
+  switch (probe) {
+    case PERF_PROBE_OTA:     return "ota";
+    case PERF_PROBE_MIXER:   return "mixer";
+    case PERF_PROBE_SPEED:   return "speed";
+    case PERF_PROBE_STATUS:  return "status";
+    case PERF_PROBE_SERVICE: return "service";
+    case PERF_PROBE_WEB:     return "web";
+    case PERF_PROBE_DHT:     return "dht";
+    default:                 return "unknown";
+  }
+}
+
+float PerfClass::getSharePercent(perf_probe_t probe) const {
+  int64_t elapsed = esp_timer_get_time() - since;
+  return elapsed > 0 ? probes[probe].totalUs * 100.f / elapsed : 0;
+}
+
+float PerfClass::getOverheadPercent() const {
+  int64_t elapsed = esp_timer_get_time() - since;
+  if (elapsed <= 0) return 0;
+  uint64_t count = 0;
+  for (uint8_t i = 0; i < PERF_PROBE_COUNT; i++) count += probes[i].count;
+  return count * probeCostNs / 1000.f * 100.f / elapsed;
+}
+
+size_t PerfClass::summary(char *buffer, size_t size) const {
+  BufferWriter writer(buffer, size);
+  writer.print(F("{\"overhead\":"));
+  writer.printFloat(getOverheadPercent(), 3);
+  for (uint8_t i = 0; i < PERF_PROBE_COUNT; i++) {
+    const perfprobe_t &p = probes[i];
+    writer.print(F(",\""));
+    writer.print(getName((perf_probe_t)i));
+    writer.print(F("\":["));
+    writer.print(p.count ? (uint32_t)(p.totalUs / p.count) : 0);
+    writer.print(',');
+    writer.print(p.maxUs);
+    writer.print(']');
+  }
+  writer.print('}');
+  return writer.getLength();
+}
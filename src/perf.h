@@ -0,0 +1,91 @@
+/**
+ * @file perf.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Scoped timer probes with latency histograms
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef PERF_h
+#define PERF_h
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+#define PERF_BUCKETS      16    // Bucket i counts durations below 2^i µs, the last one everything above
+#define PERF_MQTT_SIZE    200   // Summary payload, must fit into the PubSubClient buffer with the topic
+
+enum perf_probe_t : uint8_t {
+  PERF_PROBE_OTA,
+  PERF_PROBE_MIXER,
+  PERF_PROBE_SPEED,
+  PERF_PROBE_STATUS,
+  PERF_PROBE_SERVICE,
+  PERF_PROBE_WEB,
+  PERF_PROBE_DHT,
+  PERF_PROBE_COUNT
+};
+
+// Each probe is only recorded from one task, so no locking is required
+struct perfprobe_t {
+  uint32_t count;
+  uint64_t totalUs;
+  uint32_t maxUs;
+  uint32_t histogram[PERF_BUCKETS];
+};
+
+class PerfClass {
+    public:
+        void begin(bool enabled);
+        void setEnabled(bool enabled) { this->enabled = enabled; }
+        bool isEnabled() const { return enabled; }
+        void reset();
+
+        void record(perf_probe_t probe, uint32_t us);
+
+        static const char *getName(perf_probe_t probe);
+        const perfprobe_t &getProbe(perf_probe_t probe) const { return probes[probe]; }
+        // Share of the wall time spent in the probe since the last reset
+        float getSharePercent(perf_probe_t probe) const;
+        uint32_t getProbeCostNs() const { return probeCostNs; }
+        // Time spent in the probes themselves, relative to the wall time
+        float getOverheadPercent() const;
+
+        // {"overhead":0.01,"ota":[avgUs,maxUs],...}
+        size_t summary(char *buffer, size_t size) const;
+
+    private:
+        perfprobe_t probes[PERF_PROBE_COUNT] = {};
+        volatile bool enabled = false;
+        uint32_t probeCostNs = 0;
+        int64_t since = 0;
+};
+
+extern PerfClass Perf;
+
+// Measures the enclosing block, costs two esp_timer reads when enabled. Unlike the cycle
+// counter the timer is shared by both cores and independent of the CPU frequency, so a task
+// that migrates or a clock change within the scope does not corrupt the sample.
+class PerfScope {
+    public:
+        PerfScope(perf_probe_t probe) : probe(probe), enabled(Perf.isEnabled()) {
+            if (enabled) start = esp_timer_get_time();
+        }
+        ~PerfScope() {
+            if (enabled) Perf.record(probe, (uint32_t)min(esp_timer_get_time() - start, (int64_t)UINT32_MAX));
+        }
+
+    private:
+        perf_probe_t probe;
+        bool enabled;
+        int64_t start = 0;
+};
+
+#define PERF_SCOPE(probe) PerfScope _perfScope(probe)
+
+#endif // PERF_h
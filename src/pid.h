@@ -0,0 +1,123 @@
+/**
+ * @file pid.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief PID controller with feed-forward, anti-windup and step response metrics
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef PID_h
+#define PID_h
+
+#include <stdint.h>
+
+// No Arduino dependency on purpose, the controller is reused by host side tools
+#define PID_SETTLE_BAND       0.05f   // Settled if the error stays within +/- 5% of the setpoint
+#define PID_SETTLE_SAMPLES    8       // ... for this many consecutive updates
+#define PID_STEP_THRESHOLD    0.02f   // Setpoint changes above 2% of the range start a new step
+
+// Controls the fan RPM. Setpoint and measurement are normalized by the max RPM of the fan,
+// the output is 0.0-1.0 of the PWM range. The feed-forward term assumes a linear fan,
+// so the PID only has to correct the remaining deviation.
+class PidController {
+    public:
+        void setTunings(float kp, float ki, float kd, float kff = 1.0f) {
+            this->kp = kp;
+            this->ki = ki;
+            this->kd = kd;
+            this->kff = kff;
+        }
+        float getKp() const { return kp; }
+        float getKi() const { return ki; }
+        float getKd() const { return kd; }
+
+        void reset() {
+            integral = 0.0f;
+            lastMeasurement = -1.0f;
+        }
+
+        // Calculate a new output, dt is the time since the last update in seconds
+        float update(float setpoint, float measurement, float dt, uint32_t nowMs) {
+            trackStep(setpoint, measurement, nowMs);
+            if (setpoint <= 0.0f) {
+                reset();
+                return output = 0.0f;
+            }
+
+            float error = setpoint - measurement;
+            // Derivative on measurement, no kick on setpoint changes
+            float derivative = (lastMeasurement < 0.0f || dt <= 0.0f) ? 0.0f : (lastMeasurement - measurement) / dt;
+            lastMeasurement = measurement;
+
+            float unclamped = kff * setpoint + kp * error + ki * (integral + error * dt) + kd * derivative;
+            // Anti-windup by conditional integration, stop integrating while saturated in the error direction
+            if (!(unclamped > 1.0f && error > 0.0f) && !(unclamped < 0.0f && error < 0.0f)) integral += error * dt;
+
+            output = kff * setpoint + kp * error + ki * integral + kd * derivative;
+            if (output > 1.0f) output = 1.0f;
+            if (output < 0.0f) output = 0.0f;
+            return output;
+        }
+        float getOutput() const { return output; }
+
+        // Metrics of the last setpoint step
+        uint32_t getSettlingTimeMs() const { return settlingTimeMs; }
+        float getOvershootPercent() const { return overshootPercent; }
+        bool isSettled() const { return settled; }
+
+    private:
+        float kp = 0.5f;
+        float ki = 0.5f;
+        float kd = 0.0f;
+        float kff = 1.0f;
+
+        float integral = 0.0f;
+        float lastMeasurement = -1.0f;
+        float output = 0.0f;
+
+        float stepSetpoint = 0.0f;
+        float stepStartValue = 0.0f;
+        float stepPeak = 0.0f;
+        uint32_t stepStartMs = 0;
+        uint8_t inBand = 0;
+        bool settled = true;
+        uint32_t settlingTimeMs = 0;
+        float overshootPercent = 0.0f;
+
+        void trackStep(float setpoint, float measurement, uint32_t nowMs) {
+            float change = setpoint - stepSetpoint;
+            if (change > PID_STEP_THRESHOLD || change < -PID_STEP_THRESHOLD) {
+                stepStartValue = measurement;
+                stepPeak = measurement;
+                stepStartMs = nowMs;
+                inBand = 0;
+                settled = false;
+                overshootPercent = 0.0f;
+            }
+            stepSetpoint = setpoint;
+            if (settled) return;
+
+            // Peak in step direction, overshoot is relative to the step height
+            float height = setpoint - stepStartValue;
+            if ((height > 0.0f && measurement > stepPeak) || (height < 0.0f && measurement < stepPeak)) stepPeak = measurement;
+            if (height > PID_STEP_THRESHOLD || height < -PID_STEP_THRESHOLD) {
+                float overshoot = (stepPeak - setpoint) / height * 100.0f;
+                overshootPercent = overshoot > 0.0f ? overshoot : 0.0f;
+            }
+
+            float band = setpoint * PID_SETTLE_BAND;
+            if (band < PID_STEP_THRESHOLD) band = PID_STEP_THRESHOLD;
+            float error = setpoint - measurement;
+            if (error <= band && error >= -band) {
+                if (inBand++ == 0) settlingTimeMs = nowMs - stepStartMs;
+                if (inBand >= PID_SETTLE_SAMPLES) settled = true;
+            } else inBand = 0;
+        }
+};
+
+#endif // PID_h
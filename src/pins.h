@@ -0,0 +1,36 @@
+/**
+ * @file pins.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief GPIO assignment, shared by the firmware and the host simulator
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef PINS_h
+#define PINS_h
+
+#include "hal.h"
+
+const int TACHO_PIN = GPIO_NUM_25;                // Digital Input Pin
+const int DPLUS_PIN = GPIO_NUM_35;                // Digital Input Pin
+const int SPEED_PIN = GPIO_NUM_34;                // Potentiometer ADC Pin
+
+const int DHT22_PIN = GPIO_NUM_26;                // DHT22 Data Pin
+const int I2C_SDA_PIN = GPIO_NUM_21;              // Optional I2C sensors like SHT3x or BME280
+const int I2C_SCL_PIN = GPIO_NUM_22;
+
+const int PWM_PIN = GPIO_NUM_0;                   // PWM Pin
+const int PWM_CHANNEL = 0;                        // PWM Channel to assign
+const int PWM_MAX_DUTY_CYCLE = (int)(pow(2, 10)-1); // 10 Bit == 1024
+
+const int MIXER_STATUS_PIN = GPIO_NUM_33;         // Digital Input Pin
+const int MIXER_START_PIN = GPIO_NUM_27;          // Digital Output Pin to activate transistor
+
+const uint16_t MAX_ADC_VALUE = 4096;              // pow(2, __analogReturnedWidth);
+
+#endif // PINS_h
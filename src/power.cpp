@@ -0,0 +1,111 @@
+/**
+ * @file power.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Power modes between full-on and deep sleep
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <WiFi.h>
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <esp_wifi.h>
+#include <driver/gpio.h>
+#include "log.h"
+#include "power.h"
+
+void PowerClass::begin(power_mode_t mode) {
+#ifdef CONFIG_PM_ENABLE
+  if (noSleepLock == NULL) esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "busy", &noSleepLock);
+#endif
+  stateSince = esp_timer_get_time();
+
+  // The WiFi library resets the power save type on each start, so apply it once connected
+  WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info) {
+    applyWifi();
+  }, ARDUINO_EVENT_WIFI_STA_CONNECTED);
+
+  setMode(mode);
+}
+
+void PowerClass::setMode(power_mode_t mode) {
+  this->mode = mode;
+  lightSleepSupported = false;
+  dfsEnabled = false;
+
+#ifdef CONFIG_PM_ENABLE
+  esp_pm_config_esp32_t config = {};
+  config.max_freq_mhz = POWER_MAX_CPU_MHZ;
+  config.min_freq_mhz = mode == POWER_MODE_PERFORMANCE ? POWER_MAX_CPU_MHZ : POWER_MIN_CPU_MHZ;
+  config.light_sleep_enable = mode == POWER_MODE_LOWPOWER;
+  esp_err_t err = esp_pm_configure(&config);
+  if (err != ESP_OK && config.light_sleep_enable) {
+    // Automatic light sleep requires a framework build with tickless idle
+    LOG_INFO_LN(F("[POWER] Automatic light sleep is not supported by this build"));
+    config.light_sleep_enable = false;
+    err = esp_pm_configure(&config);
+  }
+  dfsEnabled = err == ESP_OK;
+  lightSleepSupported = dfsEnabled && config.light_sleep_enable;
+#endif
+  // Without power management at least scale the CPU clock statically
+  if (!dfsEnabled) setCpuFrequencyMhz(mode == POWER_MODE_PERFORMANCE ? POWER_MAX_CPU_MHZ : POWER_MIN_CPU_MHZ);
+
+  applyWifi();
+  updateState();
+  LOG_INFO_F("[POWER] Mode %u, dynamic clock %s, light sleep %s\n", mode,
+    dfsEnabled ? "on" : "off", lightSleepSupported ? "on" : "off");
+}
+
+// Wake up from light sleep if one of the pins gets high, e.g. D+ or the mixer
+void PowerClass::addWakeupPin(int pin) {
+  gpio_wakeup_enable((gpio_num_t)pin, GPIO_INTR_HIGH_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
+}
+
+// Modem sleep only works as a station, the SoftAP has to stay awake
+void PowerClass::applyWifi() {
+  if (WiFi.getMode() != WIFI_MODE_STA) return;
+  switch (mode) {
+    case POWER_MODE_PERFORMANCE: esp_wifi_set_ps(WIFI_PS_NONE); break;
+    case POWER_MODE_BALANCED:    esp_wifi_set_ps(WIFI_PS_MIN_MODEM); break;
+    // Wakes up every listen interval (3 beacons by default) instead of every DTIM
+    case POWER_MODE_LOWPOWER:    esp_wifi_set_ps(WIFI_PS_MAX_MODEM); break;
+  }
+}
+
+void PowerClass::setBusy(bool busy) {
+  if (this->busy == busy) return;
+  this->busy = busy;
+#ifdef CONFIG_PM_ENABLE
+  if (noSleepLock) {
+    if (busy) esp_pm_lock_acquire(noSleepLock);
+    else esp_pm_lock_release(noSleepLock);
+  }
+#endif
+  updateState();
+}
+
+void PowerClass::updateState() {
+  power_state_t next = POWER_STATE_ACTIVE;
+  if (mode == POWER_MODE_LOWPOWER && lightSleepSupported && !busy) next = POWER_STATE_LIGHT_SLEEP;
+  else if (mode != POWER_MODE_PERFORMANCE) next = POWER_STATE_MODEM_SLEEP;
+  if (next == state) return;
+
+  int64_t now = esp_timer_get_time();
+  policyUs[state] += now - stateSince;
+  stateSince = now;
+  state = next;
+  transitions++;
+}
+
+uint64_t PowerClass::getPolicyMs(power_state_t state) {
+  int64_t duration = policyUs[state];
+  if (state == this->state) duration += esp_timer_get_time() - stateSince;
+  return duration / 1000;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file power.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Power modes between full-on and deep sleep
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef POWER_h
+#define POWER_h
+
+#include <Arduino.h>
+#include <esp_pm.h>
+
+#define POWER_MAX_CPU_MHZ   240
+#define POWER_MIN_CPU_MHZ   80    // APB stays at 80 MHz, so LEDC, PCNT and UART timings are not affected
+
+enum power_mode_t : uint8_t {
+  POWER_MODE_PERFORMANCE,   // No modem sleep, fixed max CPU clock
+  POWER_MODE_BALANCED,      // Modem sleep on every DTIM, dynamic CPU clock
+  POWER_MODE_LOWPOWER       // Modem sleep with listen interval, dynamic CPU clock, automatic light sleep
+};
+
+// What the policy allows, the chip only sleeps if it is idle and, for the modem, between beacons
+enum power_state_t : uint8_t {
+  POWER_STATE_ACTIVE,
+  POWER_STATE_MODEM_SLEEP,
+  POWER_STATE_LIGHT_SLEEP,  // Light sleep allowed whenever the CPU is idle
+  POWER_STATES
+};
+
+class PowerClass {
+    public:
+        void begin(power_mode_t mode);
+        void setMode(power_mode_t mode);
+        power_mode_t getMode() { return mode; }
+        void addWakeupPin(int pin);
+
+        // The LEDC PWM and the mixer timer stop in light sleep, so it is blocked while they are in use
+        void setBusy(bool busy);
+
+        power_state_t getState() { return state; }
+        // Time the policy spent in a state. The framework has no hook to measure the
+        // real sleep time, so the savings per mode have to be measured on the supply.
+        uint64_t getPolicyMs(power_state_t state);
+        uint32_t getTransitions() { return transitions; }
+        bool isLightSleepSupported() { return lightSleepSupported; }
+        bool isDfsEnabled() { return dfsEnabled; }
+
+    private:
+        power_mode_t mode = POWER_MODE_PERFORMANCE;
+        power_state_t state = POWER_STATE_ACTIVE;
+        bool busy = false;
+        bool lightSleepSupported = false;
+        bool dfsEnabled = false;
+        esp_pm_lock_handle_t noSleepLock = NULL;
+
+        int64_t policyUs[POWER_STATES] = {};
+        int64_t stateSince = 0;
+        uint32_t transitions = 0;
+
+        void applyWifi();
+        void updateState();
+};
+
+#endif // POWER_h
@@ -0,0 +1,116 @@
+/**
+ * @file scheduler.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Deadline scheduler for the periodic jobs of the main loop
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef SCHEDULER_h
+#define SCHEDULER_h
+
+#include <stdint.h>
+#include <string.h>
+
+// No Arduino dependency on purpose, the clock is injected so it runs with a virtual one on the host
+#define SCHEDULER_MAX_JOBS      8
+#define SCHEDULER_MAX_IDLE_MS   1000    // Wake up at least this often, e.g. for ArduinoOTA.handle()
+
+typedef void (*schedulerjob_fn)();
+typedef uint64_t (*schedulerclock_fn)();
+
+struct schedulerjob_t {
+  const char *name;
+  uint32_t period;          // Interval in ms
+  uint8_t priority;         // Jobs that are due at the same time run in descending priority
+  schedulerjob_fn run;
+  uint64_t *lastRun;        // Deadline state, may point to RTC memory to survive deep sleep
+
+  uint32_t runs;
+  uint64_t totalUs;
+  uint32_t worstUs;
+  uint32_t maxLateMs;       // Worst delay between the deadline and the start of the job
+};
+
+class SchedulerClass {
+    public:
+        void begin(schedulerclock_fn clockMs, schedulerclock_fn clockUs) {
+            this->clockMs = clockMs;
+            this->clockUs = clockUs;
+        }
+
+        bool add(const char *name, uint32_t period, uint8_t priority, schedulerjob_fn run, uint64_t *lastRun) {
+            if (jobCount >= SCHEDULER_MAX_JOBS || !run || !lastRun || period == 0) return false;
+            uint8_t i = jobCount++;
+            for (; i > 0 && jobs[i - 1].priority < priority; i--) jobs[i] = jobs[i - 1];
+            jobs[i] = { name, period, priority, run, lastRun, 0, 0, 0, 0 };
+            return true;
+        }
+
+        // Change the interval of a job, e.g. to only run at a high rate while it has work
+        bool setPeriod(const char *name, uint32_t period) {
+            if (period == 0) return false;
+            for (uint8_t i = 0; i < jobCount; i++) {
+                if (strcmp(jobs[i].name, name)) continue;
+                jobs[i].period = period;
+                return true;
+            }
+            return false;
+        }
+
+        // Run every job whose deadline has passed, returns the ms until the next deadline
+        uint32_t runDue() {
+            wakeups++;
+            uint64_t now = clockMs();
+            for (uint8_t i = 0; i < jobCount; i++) {
+                schedulerjob_t &job = jobs[i];
+                if (*job.lastRun > now) *job.lastRun = now;   // clock was reset
+                if (now - *job.lastRun < job.period) continue;
+
+                uint64_t late = now - *job.lastRun - job.period;
+                uint64_t start = clockUs();
+                job.run();
+                uint32_t duration = clockUs() - start;
+
+                job.runs++;
+                job.totalUs += duration;
+                if (duration > job.worstUs) job.worstUs = duration;
+                // The first run after boot or a long blocking call resyncs instead of catching up
+                if (late < job.period) {
+                    if (late > job.maxLateMs) job.maxLateMs = late;
+                    *job.lastRun += job.period;
+                } else *job.lastRun = now;
+            }
+            return untilNextDeadline();
+        }
+
+        uint32_t untilNextDeadline() {
+            uint64_t now = clockMs();
+            uint64_t next = SCHEDULER_MAX_IDLE_MS;
+            for (uint8_t i = 0; i < jobCount; i++) {
+                uint64_t deadline = *jobs[i].lastRun + jobs[i].period;
+                if (deadline <= now) return 0;
+                if (deadline - now < next) next = deadline - now;
+            }
+            return next;
+        }
+
+        uint8_t getJobCount() const { return jobCount; }
+        const schedulerjob_t &getJob(uint8_t i) const { return jobs[i]; }
+        uint32_t getAverageUs(uint8_t i) const { return jobs[i].runs ? jobs[i].totalUs / jobs[i].runs : 0; }
+        uint32_t getWakeups() const { return wakeups; }
+
+    private:
+        schedulerjob_t jobs[SCHEDULER_MAX_JOBS];
+        uint8_t jobCount = 0;
+        uint32_t wakeups = 0;
+        schedulerclock_fn clockMs = 0;
+        schedulerclock_fn clockUs = 0;
+};
+
+#endif // SCHEDULER_h
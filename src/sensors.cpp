@@ -0,0 +1,120 @@
+/**
+ * @file sensors.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Temperature and humidity from several sensors
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include "bme280.h"
+#include "log.h"
+#include "sensors.h"
+#include "sht3x.h"
+
+void SensorsClass::begin(int sda, int scl) {
+  Wire.begin(sda, scl, SENSORS_I2C_FREQUENCY);
+
+  // Probe the default and the alternative address of each supported sensor
+  bool polled = false;
+  const uint8_t shtAddresses[] = { SHT3X_ADDRESS, SHT3X_ADDRESS + 1 };
+  for (uint8_t address : shtAddresses) {
+    if (!bus.probe(address)) continue;
+    Sht3xSensor *sensor = new Sht3xSensor(bus, address);
+    if (sensor->begin() && add(sensor->getName(), sensor) >= 0) polled = true;
+    else delete sensor;
+  }
+  const uint8_t bmeAddresses[] = { BME280_ADDRESS, BME280_ADDRESS + 1 };
+  for (uint8_t address : bmeAddresses) {
+    if (!bus.probe(address)) continue;
+    Bme280Sensor *sensor = new Bme280Sensor(bus, address);
+    if (sensor->begin() && add(sensor->getName(), sensor) >= 0) polled = true;
+    else delete sensor;
+  }
+
+  if (polled) xTaskCreate(&task, "SENSOR_task", SENSORS_TASK_STACK, this, 5, NULL);
+  else LOG_INFO_LN(F("[SENSOR] No I2C sensor found"));
+}
+
+int8_t SensorsClass::addExternal(const char *name) {
+  return add(name, NULL);
+}
+
+int8_t SensorsClass::add(const char *name, ClimateSensor *sensor) {
+  if (count >= SENSORS_MAX) return -1;
+  slots[count] = { name, sensor, climatesample_t(), 0 };
+  LOG_INFO_F("[SENSOR] Added %s as sensor %u\n", name, count);
+  return count++;
+}
+
+void SensorsClass::submit(uint8_t slot, bool ok, float temperature, float humidity) {
+  if (slot >= count) return;
+
+  // Verify if that value can be true
+  if (ok && (temperature > 125.0 or temperature < -40.0 or humidity > 100.0 or humidity < 0.0)) {
+    LOG_INFO_F("[SENSOR] %s out of range: %0.2f °C, %0.2f %%\n", slots[slot].name, temperature, humidity);
+    ok = false;
+  }
+
+  portENTER_CRITICAL(&lock);
+  climatesample_t &sample = slots[slot].sample;
+  if (ok) {
+    sample.temperature = temperature;
+    sample.humidity = humidity;
+    sample.timestamp = millis();
+    sample.quality = SENSOR_QUALITY_GOOD;
+  } else {
+    // Keep the values of the last good read, the age tells how old they are
+    if (sample.quality != SENSOR_QUALITY_NONE) sample.quality = SENSOR_QUALITY_ERROR;
+    slots[slot].errors++;
+  }
+  portEXIT_CRITICAL(&lock);
+}
+
+climatesample_t SensorsClass::getSample(uint8_t slot) {
+  portENTER_CRITICAL(&lock);
+  climatesample_t sample = slots[slot].sample;
+  portEXIT_CRITICAL(&lock);
+  return sample;
+}
+
+bool SensorsClass::aggregate(float &temperature, float &humidity) {
+  climatesample_t samples[SENSORS_MAX];
+  portENTER_CRITICAL(&lock);
+  for (uint8_t i = 0; i < count; i++) samples[i] = slots[i].sample;
+  portEXIT_CRITICAL(&lock);
+  return climateAggregate(samples, count, aggregateMode, millis(), temperature, humidity);
+}
+
+// One batch for all I2C sensors: trigger every conversion, wait once for the slowest, collect
+void SensorsClass::poll() {
+  bool triggered[SENSORS_MAX] = {};
+  uint16_t conversionMs = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    ClimateSensor *sensor = slots[i].sensor;
+    if (sensor == NULL) continue;
+    triggered[i] = sensor->trigger();
+    if (triggered[i] && sensor->getConversionMs() > conversionMs) conversionMs = sensor->getConversionMs();
+  }
+  vTaskDelay(pdMS_TO_TICKS(conversionMs) + 1);
+
+  for (uint8_t i = 0; i < count; i++) {
+    ClimateSensor *sensor = slots[i].sensor;
+    if (sensor == NULL) continue;
+    float temperature = 0, humidity = 0;
+    bool ok = triggered[i] && sensor->collect(temperature, humidity);
+    submit(i, ok, temperature, humidity);
+  }
+}
+
+void SensorsClass::task(void *pvParameter) {
+  SensorsClass *sensors = (SensorsClass *)pvParameter;
+  while(1) {
+    sensors->poll();
+    vTaskDelay(SENSORS_INTERVAL_MS / portTICK_RATE_MS);
+  }
+}
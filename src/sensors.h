@@ -0,0 +1,80 @@
+/**
+ * @file sensors.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Temperature and humidity from several sensors
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef SENSORS_h
+#define SENSORS_h
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "climatesensor.h"
+#include "i2cbus.h"
+
+#define SENSORS_MAX             4
+#define SENSORS_INTERVAL_MS     5000    // I2C sensors convert in ms, no need to wait 2s as for the DHT22
+#define SENSORS_TASK_STACK      3072
+#define SENSORS_I2C_FREQUENCY   100000
+
+class WireBus : public I2CBus {
+    public:
+        WireBus(TwoWire &wire) : wire(wire) {}
+        bool write(uint8_t address, const uint8_t *data, size_t length) {
+            wire.beginTransmission(address);
+            if (length) wire.write(data, length);
+            return wire.endTransmission() == 0;
+        }
+        bool read(uint8_t address, uint8_t *data, size_t length) {
+            if (wire.requestFrom(address, length) != length) return false;
+            return wire.readBytes(data, length) == length;
+        }
+
+    private:
+        TwoWire &wire;
+};
+
+struct sensorslot_t {
+  const char *name;
+  ClimateSensor *sensor;    // NULL for sensors read by their own task, e.g. the DHT22
+  climatesample_t sample;
+  uint32_t errors;
+};
+
+class SensorsClass {
+    public:
+        // Detects the supported I2C sensors and starts polling them if there are any
+        void begin(int sda, int scl);
+        // Register a sensor that delivers its samples with submit(), returns the slot or -1
+        int8_t addExternal(const char *name);
+        void submit(uint8_t slot, bool ok, float temperature, float humidity);
+
+        void setAggregate(sensor_aggregate_t mode) { if (mode < SENSOR_AGGREGATE_MODES) aggregateMode = mode; }
+        sensor_aggregate_t getAggregate() { return aggregateMode; }
+        bool aggregate(float &temperature, float &humidity);
+
+        uint8_t getCount() { return count; }
+        const char *getName(uint8_t slot) { return slots[slot].name; }
+        uint32_t getErrors(uint8_t slot) { return slots[slot].errors; }
+        climatesample_t getSample(uint8_t slot);
+
+    private:
+        sensorslot_t slots[SENSORS_MAX];
+        uint8_t count = 0;
+        sensor_aggregate_t aggregateMode = SENSOR_AGGREGATE_MEAN;
+        portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+        WireBus bus = WireBus(Wire);
+
+        int8_t add(const char *name, ClimateSensor *sensor);
+        void poll();
+        static void task(void *pvParameter);
+};
+
+#endif // SENSORS_h
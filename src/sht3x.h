@@ -0,0 +1,67 @@
+/**
+ * @file sht3x.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Sensirion SHT30/SHT31/SHT35 driver
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef SHT3X_h
+#define SHT3X_h
+
+#include "climatesensor.h"
+#include "i2cbus.h"
+
+#define SHT3X_ADDRESS           0x44    // 0x45 with ADDR pulled high
+#define SHT3X_CONVERSION_MS     16      // Single shot with high repeatability
+
+class Sht3xSensor : public ClimateSensor {
+    public:
+        Sht3xSensor(I2CBus &bus, uint8_t address = SHT3X_ADDRESS) : bus(bus), address(address) {}
+
+        const char *getName() { return "sht3x"; }
+        uint16_t getConversionMs() { return SHT3X_CONVERSION_MS; }
+
+        bool begin() {
+            return command(0x30A2);     // Soft reset
+        }
+
+        bool trigger() {
+            return command(0x2400);     // Single shot, high repeatability, no clock stretching
+        }
+
+        bool collect(float &temperature, float &humidity) {
+            uint8_t data[6];
+            if (!bus.read(address, data, sizeof(data))) return false;
+            if (crc8(data, 2) != data[2] || crc8(data + 3, 2) != data[5]) return false;
+            temperature = -45.f + 175.f * ((data[0] << 8) | data[1]) / 65535.f;
+            humidity = 100.f * ((data[3] << 8) | data[4]) / 65535.f;
+            return true;
+        }
+
+        // CRC-8 with polynomial 0x31 and init 0xFF, over each 16 bit word
+        static uint8_t crc8(const uint8_t *data, size_t length) {
+            uint8_t crc = 0xFF;
+            for (size_t i = 0; i < length; i++) {
+                crc ^= data[i];
+                for (uint8_t bit = 0; bit < 8; bit++) crc = crc & 0x80 ? (crc << 1) ^ 0x31 : crc << 1;
+            }
+            return crc;
+        }
+
+    private:
+        I2CBus &bus;
+        uint8_t address;
+
+        bool command(uint16_t cmd) {
+            uint8_t data[2] = { (uint8_t)(cmd >> 8), (uint8_t)cmd };
+            return bus.write(address, data, sizeof(data));
+        }
+};
+
+#endif // SHT3X_h
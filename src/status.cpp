@@ -0,0 +1,112 @@
+/**
+ * @file status.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Allocation free JSON serializer for the periodic status report
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <stddef.h>
+#include "format.h"
+#include "status.h"
+
+enum status_type_t : uint8_t {
+  STATUS_BOOL,
+  STATUS_UINT8,
+  STATUS_UINT32,
+  STATUS_UINT64,
+  STATUS_FLOAT
+};
+
+struct status_field_t {
+  const char *key;        // precomputed "name": prefix
+  uint8_t keyLength;
+  status_type_t type;
+  uint8_t offset;
+  uint8_t size;
+};
+
+#define STATUS_FIELD(name, type) \
+  { "\"" #name "\":", sizeof("\"" #name "\":") - 1, type, offsetof(status_t, name), sizeof(status_t::name) }
+
+static const status_field_t statusSchema[] = {
+  STATUS_FIELD(stateFanRpm, STATUS_UINT32),
+  STATUS_FIELD(stateFanStalled, STATUS_BOOL),
+  STATUS_FIELD(lastMixer, STATUS_UINT64),
+  STATUS_FIELD(stateMixer, STATUS_BOOL),
+  STATUS_FIELD(stateDplus, STATUS_BOOL),
+  STATUS_FIELD(statePoti, STATUS_UINT8),
+  STATUS_FIELD(statePwmSpeed, STATUS_UINT8),
+  STATUS_FIELD(stateTemperature, STATUS_FLOAT),
+  STATUS_FIELD(stateHumidity, STATUS_FLOAT),
+  STATUS_FIELD(stateDehumidification, STATUS_BOOL),
+};
+
+static_assert(sizeof(statusSchema) / sizeof(statusSchema[0]) == STATUS_FIELD_COUNT, "STATUS_FIELD_COUNT is outdated");
+
+static void writeField(BufferWriter &writer, const status_field_t &field, const uint8_t *value) {
+  writer.write((const uint8_t *)field.key, field.keyLength);
+  switch (field.type) {
+    case STATUS_BOOL:   writer.print(*(const bool *)value ? "true" : "false"); break;
+    case STATUS_UINT8:  writer.print(*(const uint8_t *)value); break;
+    case STATUS_UINT32: writer.print(*(const uint32_t *)value); break;
+    case STATUS_UINT64: writer.print(*(const uint64_t *)value); break;
+    case STATUS_FLOAT:  writer.printFloat(*(const float *)value, 2); break;
+  }
+}
+
+// Serialize the status, in delta mode only the fields that changed since the last report
+size_t StatusSerializer::serialize(const status_t &status) {
+  bool full = !deltaMode || keyframeCountdown == 0;
+  if (full) keyframeCountdown = STATUS_KEYFRAME_INTERVAL;
+  keyframeCountdown--;
+
+  const uint8_t *current = (const uint8_t *)&status;
+  const uint8_t *previous = (const uint8_t *)&last;
+
+  BufferWriter writer(json, sizeof(json));
+  writer.print('{');
+  fields = 0;
+  for (const status_field_t &field : statusSchema) {
+    const uint8_t *value = current + field.offset;
+    if (!full && memcmp(value, previous + field.offset, field.size) == 0) continue;
+
+    if (fields++) writer.print(',');
+    writeField(writer, field, value);
+  }
+  writer.print('}');
+
+  last = status;
+  jsonLength = writer.getLength();
+  return jsonLength;
+}
+
+size_t StatusSerializer::serializeFields(const status_t &status, statusmask_t mask, char *buffer, size_t size) {
+  BufferWriter writer(buffer, size);
+  writer.print('{');
+  bool first = true;
+  for (uint8_t i = 0; i < STATUS_FIELD_COUNT; i++) {
+    if (!(mask & (1 << i))) continue;
+    if (!first) writer.print(',');
+    first = false;
+    writeField(writer, statusSchema[i], (const uint8_t *)&status + statusSchema[i].offset);
+  }
+  writer.print('}');
+  return writer.getLength();
+}
+
+statusmask_t StatusSerializer::fieldMask(const char *name) {
+  if (!name) return 0;
+  size_t length = strlen(name);
+  for (uint8_t i = 0; i < STATUS_FIELD_COUNT; i++) {
+    // The key is stored as "name":
+    const status_field_t &field = statusSchema[i];
+    if (field.keyLength == length + 3 && memcmp(field.key + 1, name, length) == 0) return 1 << i;
+  }
+  return 0;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file status.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Allocation free JSON serializer for the periodic status report
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef STATUS_h
+#define STATUS_h
+
+#include <Arduino.h>
+
+#define STATUS_JSON_SIZE          320   // Max size of one serialized status report
+#define STATUS_KEYFRAME_INTERVAL  12    // In delta mode, send a full report every X reports
+#define STATUS_FIELD_COUNT        10    // Fields of status_t in the schema of status.cpp
+#define STATUS_ALL_FIELDS         ((statusmask_t)((1 << STATUS_FIELD_COUNT) - 1))
+
+typedef uint16_t statusmask_t;          // Bit i selects the i-th field of the schema
+
+// Everything that is reported on each status tick
+struct status_t {
+  uint32_t stateFanRpm;
+  bool stateFanStalled;
+  uint64_t lastMixer;
+  bool stateMixer;
+  bool stateDplus;
+  uint8_t statePoti;
+  uint8_t statePwmSpeed;
+  float stateTemperature;
+  float stateHumidity;
+  bool stateDehumidification;
+};
+
+// Serializes a status_t into a fixed buffer as compact JSON. The buffer is
+// reused for the SSE and MQTT consumers, so the payload is encoded once.
+class StatusSerializer {
+    public:
+        size_t serialize(const status_t &status);
+        void requestFullSnapshot() { keyframeCountdown = 0; }
+        void setDeltaMode(bool enabled) { deltaMode = enabled; requestFullSnapshot(); }
+        bool getDeltaMode() { return deltaMode; }
+
+        // A subset of the fields, e.g. for the telemetry subscriptions, returns the length
+        static size_t serializeFields(const status_t &status, statusmask_t mask, char *buffer, size_t size);
+        // Bit of a field by its JSON key, 0 for unknown names
+        static statusmask_t fieldMask(const char *name);
+
+        const char *c_str() const { return json; }
+        size_t length() const { return jsonLength; }
+        uint8_t fieldCount() const { return fields; }
+
+    private:
+        char json[STATUS_JSON_SIZE];
+        size_t jsonLength = 0;
+        uint8_t fields = 0;
+
+        bool deltaMode = false;
+        uint8_t keyframeCountdown = 0;
+        status_t last;
+};
+
+#endif // STATUS_h
@@ -0,0 +1,138 @@
+/**
+ * @file tacho.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Fan tacho measurement using the ESP32 pulse counter
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include "log.h"
+#include "tacho.h"
+
+#define TACHO_COUNTER_LIMIT 32767   // The counter wraps to 0 when reaching this value
+
+// The pulse counter counts the falling edges in hardware, no interrupt per tacho edge is required.
+bool TachoClass::begin(int pin, uint8_t pulsesPerRevolution, pcnt_unit_t pcntUnit) {
+  unit = pcntUnit;
+  if (pulsesPerRevolution > 0) pulsesPerRev = pulsesPerRevolution;
+  // The timer is not running yet, the counter starts from 0 again
+  lastCounter = 0;
+  memset(rawRpm, 0, sizeof(rawRpm));
+  rawIndex = 0;
+  resetWindow = false;
+  head = 0;
+  count = 0;
+
+  pcnt_config_t config = {};
+  config.pulse_gpio_num = pin;
+  config.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+  config.lctrl_mode = PCNT_MODE_KEEP;
+  config.hctrl_mode = PCNT_MODE_KEEP;
+  config.pos_mode = PCNT_COUNT_DIS;
+  config.neg_mode = PCNT_COUNT_INC;
+  config.counter_h_lim = TACHO_COUNTER_LIMIT;
+  config.counter_l_lim = 0;
+  config.unit = unit;
+  config.channel = PCNT_CHANNEL_0;
+
+  if (pcnt_unit_config(&config) != ESP_OK) {
+    LOG_INFO_LN(F("[TACHO] Unable to configure the pulse counter"));
+    return false;
+  }
+  pcnt_set_filter_value(unit, TACHO_GLITCH_FILTER);
+  pcnt_filter_enable(unit);
+  pcnt_counter_pause(unit);
+  pcnt_counter_clear(unit);
+  pcnt_counter_resume(unit);
+
+  startTime = esp_timer_get_time();
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = &TachoClass::onTimer;
+  timerArgs.arg = this;
+  timerArgs.name = "tacho";
+  if (esp_timer_create(&timerArgs, &timer) != ESP_OK || esp_timer_start_periodic(timer, TACHO_WINDOW_MS * 1000) != ESP_OK) {
+    LOG_INFO_LN(F("[TACHO] Unable to start the sample timer"));
+    return false;
+  }
+
+  LOG_INFO_F("[TACHO] Counting pulses on GPIO %d with %u pulses per revolution\n", pin, pulsesPerRev);
+  return true;
+}
+
+// The RPM of the old setting would stay in the median for a few windows, sample() starts it over
+void TachoClass::setPulsesPerRevolution(uint8_t ppr) {
+  if (ppr == 0 || ppr == pulsesPerRev) return;
+  pulsesPerRev = ppr;
+  resetWindow = true;
+}
+
+void TachoClass::onTimer(void *arg) {
+  ((TachoClass *)arg)->sample();
+}
+
+// Executed every TACHO_WINDOW_MS from the esp_timer task
+void TachoClass::sample() {
+  int16_t counter = 0;
+  pcnt_get_counter_value(unit, &counter);
+  uint16_t pulses = (counter - lastCounter + TACHO_COUNTER_LIMIT) % TACHO_COUNTER_LIMIT;
+  lastCounter = counter;
+
+  int64_t now = esp_timer_get_time();
+  if (pulses > 0) lastPulse = now;
+
+  // RPM over the last TACHO_SPAN_WINDOWS windows, to get a usable resolution
+  uint8_t windows = min(count, (uint8_t)(TACHO_SPAN_WINDOWS - 1));
+  uint32_t spanPulses = pulses;
+  for (uint8_t i = 0; i < windows; i++) spanPulses += history[(head + TACHO_HISTORY - i) % TACHO_HISTORY].pulses;
+  int64_t spanStart = count > windows ? history[(head + TACHO_HISTORY - windows) % TACHO_HISTORY].timestamp : startTime;
+
+  int64_t span = now - spanStart;
+  uint32_t raw = span > 0 ? (uint32_t)(spanPulses * 60000000LL / (pulsesPerRev * span)) : 0;
+  if (resetWindow) {
+    // The pulses of the span are still valid, only the ones converted with the old setting are dropped
+    resetWindow = false;
+    for (uint8_t i = 0; i < TACHO_MEDIAN_SAMPLES; i++) rawRpm[i] = raw;
+    rawIndex = 0;
+  }
+  rawRpm[rawIndex] = raw;
+  rawIndex = (rawIndex + 1) % TACHO_MEDIAN_SAMPLES;
+
+  // Windowed median, removes single outliers caused by electrical noise
+  uint32_t sorted[TACHO_MEDIAN_SAMPLES];
+  memcpy(sorted, rawRpm, sizeof(sorted));
+  for (uint8_t i = 1; i < TACHO_MEDIAN_SAMPLES; i++) {
+    for (uint8_t j = i; j > 0 && sorted[j - 1] > sorted[j]; j--) {
+      uint32_t tmp = sorted[j];
+      sorted[j] = sorted[j - 1];
+      sorted[j - 1] = tmp;
+    }
+  }
+
+  stalled = now - lastPulse > TACHO_STALL_TIMEOUT_MS * 1000LL;
+  rpm = stalled ? 0 : sorted[TACHO_MEDIAN_SAMPLES / 2];
+
+  portENTER_CRITICAL(&lock);
+  head = (head + 1) % TACHO_HISTORY;
+  history[head].timestamp = now;
+  history[head].pulses = pulses;
+  history[head].rpm = rpm;
+  if (count < TACHO_HISTORY) count++;
+  portEXIT_CRITICAL(&lock);
+}
+
+// Get a sample with its timestamp, age 0 is the latest one
+bool TachoClass::getSample(uint8_t age, tachosample_t &sample) {
+  bool found = false;
+  portENTER_CRITICAL(&lock);
+  if (age < count) {
+    sample = history[(head + TACHO_HISTORY - age) % TACHO_HISTORY];
+    found = true;
+  }
+  portEXIT_CRITICAL(&lock);
+  return found;
+}
@@ -0,0 +1,70 @@
+/**
+ * @file tacho.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Fan tacho measurement using the ESP32 pulse counter
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef TACHO_h
+#define TACHO_h
+
+#include <Arduino.h>
+#include <driver/pcnt.h>
+#include <esp_timer.h>
+
+#define TACHO_WINDOW_MS         250   // Pulse counter sample interval
+#define TACHO_SPAN_WINDOWS      4     // Number of windows to calculate one RPM value (resolution)
+#define TACHO_MEDIAN_SAMPLES    5     // Median filter over the last X RPM values
+#define TACHO_HISTORY           16    // Samples available to consumers, must be >= the values above
+#define TACHO_STALL_TIMEOUT_MS  1500  // No pulse within this time means the fan stands still
+#define TACHO_GLITCH_FILTER     1023  // Ignore pulses shorter than X APB cycles (12.8µs @ 80MHz)
+
+struct tachosample_t {
+  int64_t timestamp;    // esp_timer_get_time() in µs at the end of the window
+  uint16_t pulses;      // Falling edges counted within the window
+  uint32_t rpm;         // Filtered RPM at that time
+};
+
+class TachoClass {
+    public:
+        bool begin(int pin, uint8_t pulsesPerRevolution = 2, pcnt_unit_t unit = PCNT_UNIT_0);
+        void setPulsesPerRevolution(uint8_t ppr);
+        uint8_t getPulsesPerRevolution() { return pulsesPerRev; }
+
+        uint32_t getRpm() { return rpm; }
+        bool isStalled() { return stalled; }
+        int64_t getLastPulse() { return lastPulse; }
+        bool getSample(uint8_t age, tachosample_t &sample);
+
+    private:
+        pcnt_unit_t unit;
+        esp_timer_handle_t timer = NULL;
+        uint8_t pulsesPerRev = 2;
+
+        tachosample_t history[TACHO_HISTORY];
+        uint8_t head = 0;
+        uint8_t count = 0;
+        portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+        volatile uint32_t rpm = 0;
+        volatile bool stalled = true;
+        volatile int64_t lastPulse = 0;
+        int64_t startTime = 0;
+
+        // Window state of sample(), reset by begin() and on a new pulses per revolution setting
+        int16_t lastCounter = 0;
+        uint32_t rawRpm[TACHO_MEDIAN_SAMPLES] = {};
+        uint8_t rawIndex = 0;
+        volatile bool resetWindow = false;
+
+        void sample();
+        static void onTimer(void *arg);
+};
+
+#endif // TACHO_h
@@ -0,0 +1,156 @@
+/**
+ * @file telemetry.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Live status over a WebSocket, each client subscribes to its own fields and rate
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <ArduinoJson.h>
+#include "log.h"
+#include "telemetry.h"
+
+void TelemetryClass::begin() {
+  if (lock) return;
+  lock = xSemaphoreCreateMutex();
+  socket.onEvent([this](AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
+    onEvent(client, type, arg, data, len);
+  });
+}
+
+// Called from the async_tcp task
+void TelemetryClass::onEvent(AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
+  if (type == WS_EVT_CONNECT) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int8_t slot = -1;
+    for (uint8_t i = 0; i < TELEMETRY_MAX_CLIENTS && slot < 0; i++) if (!clients[i].client) slot = i;
+    if (slot >= 0) {
+      // The first snapshot goes out with the next tick
+      clients[slot] = { client, STATUS_ALL_FIELDS, TELEMETRY_DEFAULT_INTERVAL_MS, (uint32_t)millis() - TELEMETRY_DEFAULT_INTERVAL_MS, 0 };
+      clientCount++;
+    } else rejected++;
+    xSemaphoreGive(lock);
+    if (slot < 0) {
+      LOG_INFO_F("[TELEMETRY] Client %u rejected, %u clients connected\n", client->id(), TELEMETRY_MAX_CLIENTS);
+      client->close(1013, "Too many clients");
+    }
+  } else if (type == WS_EVT_DISCONNECT) {
+    // Sent from the destructor of the client, waits for a running tick() to finish with it
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (uint8_t i = 0; i < TELEMETRY_MAX_CLIENTS; i++) {
+      if (clients[i].client != client) continue;
+      clients[i].client = NULL;
+      clientCount--;
+    }
+    xSemaphoreGive(lock);
+  } else if (type == WS_EVT_DATA) {
+    // Subscriptions are small, fragmented frames are not supported
+    AwsFrameInfo *info = (AwsFrameInfo *)arg;
+    if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) subscribe(client, data, len);
+    else client->text("{\"error\":\"Fragmented or binary frames are not supported\"}");
+  }
+}
+
+void TelemetryClass::subscribe(AsyncWebSocketClient *client, uint8_t *data, size_t len) {
+  StaticJsonDocument<TELEMETRY_REQUEST_SIZE> doc;
+  if (deserializeJson(doc, (const char *)data, len)) {
+    client->text("{\"error\":\"Invalid JSON\"}");
+    return;
+  }
+
+  statusmask_t mask = STATUS_ALL_FIELDS;
+  if (doc.containsKey("fields")) {
+    mask = 0;
+    for (JsonVariant name : doc["fields"].as<JsonArray>()) {
+      statusmask_t field = StatusSerializer::fieldMask(name.as<const char *>());
+      if (!field) {
+        client->text("{\"error\":\"Unknown field\"}");
+        return;
+      }
+      mask |= field;
+    }
+    if (!mask) {
+      client->text("{\"error\":\"No fields selected\"}");
+      return;
+    }
+  }
+  // Rounded to whole ticks, so all clients with the same rate are due in the same tick
+  uint32_t interval = doc["interval"] | TELEMETRY_DEFAULT_INTERVAL_MS;
+  interval = constrain(interval, TELEMETRY_TICK_MS, TELEMETRY_MAX_INTERVAL_MS);
+  interval = (interval + TELEMETRY_TICK_MS / 2) / TELEMETRY_TICK_MS * TELEMETRY_TICK_MS;
+
+  bool found = false;
+  xSemaphoreTake(lock, portMAX_DELAY);
+  for (uint8_t i = 0; i < TELEMETRY_MAX_CLIENTS; i++) {
+    if (clients[i].client != client) continue;
+    clients[i].mask = mask;
+    clients[i].interval = interval;
+    clients[i].lastSent = millis() - interval;
+    found = true;
+  }
+  xSemaphoreGive(lock);
+  if (!found) return;
+
+  char reply[64];
+  snprintf(reply, sizeof(reply), "{\"subscribed\":%u,\"interval\":%u}", mask, interval);
+  client->text(reply);
+}
+
+bool TelemetryClass::isDue(const telemetryclient_t &entry, uint32_t now) {
+  // A dropped client stays in the table until its disconnect event arrives
+  if (!entry.client || entry.slowTicks >= TELEMETRY_SLOW_TICKS) return false;
+  return now - entry.lastSent + TELEMETRY_TICK_MS / 2 >= entry.interval;
+}
+
+void TelemetryClass::tick(const status_t &status) {
+  if (!lock) return;
+
+  uint32_t now = millis();
+  char json[STATUS_JSON_SIZE];
+  bool done[TELEMETRY_MAX_CLIENTS] = {};
+  // Held across the sends, a disconnecting client is not freed before its slot is cleared
+  xSemaphoreTake(lock, portMAX_DELAY);
+  for (uint8_t i = 0; i < TELEMETRY_MAX_CLIENTS; i++) {
+    if (done[i] || !isDue(clients[i], now)) continue;
+
+    // Each distinct field set is encoded once, every client gets a copy in its own queue
+    size_t length = 0;
+    for (uint8_t j = i; j < TELEMETRY_MAX_CLIENTS; j++) {
+      telemetryclient_t &entry = clients[j];
+      if (done[j] || entry.mask != clients[i].mask || !isDue(entry, now)) continue;
+      done[j] = true;
+      if (entry.client->status() != WS_CONNECTED) continue;
+      if (entry.client->queueIsFull()) {
+        skipped++;
+        if (++entry.slowTicks < TELEMETRY_SLOW_TICKS) continue;
+        dropped++;
+        LOG_INFO_F("[TELEMETRY] Client %u too slow, closing the connection\n", entry.client->id());
+        entry.client->close(1008, "Too slow");
+        continue;
+      }
+      // Not the fault of the client, retried on the next tick
+      if (ESP.getMaxAllocHeap() < TELEMETRY_MIN_HEAP) {
+        starved++;
+        continue;
+      }
+      if (!length) {
+        length = StatusSerializer::serializeFields(status, entry.mask, json, sizeof(json));
+        frames++;
+      }
+      entry.client->text(json, length);
+      messages++;
+      entry.slowTicks = 0;
+      entry.lastSent = now;
+    }
+  }
+  xSemaphoreGive(lock);
+}
+
+telemetrystats_t TelemetryClass::getStats() {
+  return { clientCount, frames, messages, skipped, dropped, rejected, starved };
+}
@@ -0,0 +1,80 @@
+/**
+ * @file telemetry.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Live status over a WebSocket, each client subscribes to its own fields and rate
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef TELEMETRY_h
+#define TELEMETRY_h
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "status.h"
+
+#define TELEMETRY_TICK_MS             250     // Fastest rate, all intervals are multiples of it
+#define TELEMETRY_MAX_INTERVAL_MS     60000
+#define TELEMETRY_DEFAULT_INTERVAL_MS 5000    // Until the client subscribes, like the SSE status
+#define TELEMETRY_MAX_CLIENTS         8       // More connections are closed right away
+#define TELEMETRY_SLOW_TICKS          20      // Ticks in a row with a full queue until the client is dropped
+#define TELEMETRY_MIN_HEAP            24576   // Largest free block below which no payload is encoded
+#define TELEMETRY_REQUEST_SIZE        512     // JSON document of a subscription
+
+// {"fields":["stateFanRpm",...],"interval":1000}, missing fields select all of them
+struct telemetryclient_t {
+  AsyncWebSocketClient *client;   // NULL for a free slot, cleared by the disconnect event before the client is freed
+  statusmask_t mask;
+  uint32_t interval;
+  uint32_t lastSent;
+  uint8_t slowTicks;
+};
+
+struct telemetrystats_t {
+  uint8_t clients;
+  uint32_t frames;          // Distinct payloads encoded, one per field set and tick
+  uint32_t messages;        // Frames queued to the clients
+  uint32_t skipped;         // Due updates postponed because of a full client queue
+  uint32_t dropped;         // Clients closed for being too slow
+  uint32_t rejected;        // Connections beyond TELEMETRY_MAX_CLIENTS
+  uint32_t starved;         // Due updates postponed for low heap
+};
+
+class TelemetryClass {
+    public:
+        TelemetryClass(const char *url) : socket(url) {}
+
+        void begin();
+        AsyncWebSocket &getSocket() { return socket; }
+
+        // Sends the snapshot to every client whose interval is due, called every TELEMETRY_TICK_MS.
+        // Runs outside of the async_tcp task, the clients are only used while holding the lock.
+        void tick(const status_t &status);
+
+        uint8_t getClientCount() { return clientCount; }
+        telemetrystats_t getStats();
+
+    private:
+        AsyncWebSocket socket;
+        SemaphoreHandle_t lock = NULL;
+        telemetryclient_t clients[TELEMETRY_MAX_CLIENTS] = {};
+        volatile uint8_t clientCount = 0;
+
+        uint32_t frames = 0;
+        uint32_t messages = 0;
+        uint32_t skipped = 0;
+        uint32_t dropped = 0;
+        uint32_t rejected = 0;
+        uint32_t starved = 0;
+
+        void onEvent(AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
+        void subscribe(AsyncWebSocketClient *client, uint8_t *data, size_t len);
+        bool isDue(const telemetryclient_t &entry, uint32_t now);
+};
+
+#endif // TELEMETRY_h
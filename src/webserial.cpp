@@ -15,12 +15,20 @@
 
 void WebSerialClass::begin(AsyncWebServer *server, const char* url) {
   webServer = server;
+  clientLock = xSemaphoreCreateMutex();
 
   webSocket = new AsyncWebSocket("/api/webserial");
   webSocket->onEvent([&](AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventType type, void * arg, uint8_t *data, size_t len) -> void {
     if(type == WS_EVT_CONNECT){
-      LOG_INFO_LN(F("[WEBSERIAL] Client connection received"));
+      if (addClient(client)) {
+        LOG_INFO_LN(F("[WEBSERIAL] Client connection received"));
+      } else {
+        LOG_INFO_LN(F("[WEBSERIAL] Too many clients, connection refused"));
+        client->close();
+      }
     } else if(type == WS_EVT_DISCONNECT){
+      // Sent from the destructor of the client, waits until flush() is done with it
+      removeClient(client);
       LOG_INFO_LN(F("[WEBSERIAL] Client disconnected"));
     } else if(type == WS_EVT_DATA){
       LOG_INFO_LN(F("[WEBSERIAL] Received Websocket Data"));
@@ -31,121 +39,107 @@ void WebSerialClass::begin(AsyncWebServer *server, const char* url) {
   LOG_INFO_LN(F("[WEBSERIAL] Attached AsyncWebServer along with Websockets"));
 }
 
-void WebSerialClass::print(int c) {
-  if (webServer != nullptr) webSocket->textAll(String(c));
-}
-
-void WebSerialClass::print(uint8_t c) {
-  if (webServer != nullptr) webSocket->textAll(String(c));
-}
-
-void WebSerialClass::print(uint16_t c) {
-  if (webServer != nullptr) webSocket->textAll(String(c));
-}
-
-void WebSerialClass::print(uint32_t c) {
-  if (webServer != nullptr) webSocket->textAll(String(c));
-}
-
-void WebSerialClass::print(double c) {
-  if (webServer != nullptr) webSocket->textAll(String(c));
-}
-
-void WebSerialClass::print(float c) {
-  if (webServer != nullptr) webSocket->textAll(String(c));
-}
-
-void WebSerialClass::print(const char * c) {
-  if (webServer != nullptr) webSocket->textAll(c);
-}
-
-void WebSerialClass::print(char * c) {
-  if (webServer != nullptr) webSocket->textAll(c);
-}
-
-void WebSerialClass::print(String c) {
-  if (webServer != nullptr) webSocket->textAll(c);
-}
-
-void WebSerialClass::print(long c) {
-  if (webServer != nullptr) webSocket->textAll(String(c));
-}
-
-void WebSerialClass::print(unsigned long c) {
-  if (webServer != nullptr) webSocket->textAll(String(c));
-}
-
-////////////// PRINT with LN ////////////////
-void WebSerialClass::println(int c) {
-  if (webServer != nullptr) webSocket->textAll(String(c) + "\n");        
-}
-
-void WebSerialClass::println(uint8_t c) {
-  if (webServer != nullptr) webSocket->textAll(String(c) + "\n");        
-}
-
-void WebSerialClass::println(uint16_t c) {
-  if (webServer != nullptr) webSocket->textAll(String(c) + "\n");        
-}
-
-void WebSerialClass::println(uint32_t c) {
-  if (webServer != nullptr) webSocket->textAll(String(c) + "\n");        
-}
-
-void WebSerialClass::println(float c) {
-  if (webServer != nullptr) webSocket->textAll(String(c) + "\n");        
-}
-
-void WebSerialClass::println(double c) {
-  if (webServer != nullptr) webSocket->textAll(String(c) + "\n");        
-}
-
-void WebSerialClass::println(const char * c) {
-  if (webServer != nullptr) webSocket->textAll(String(c) + "\n");        
-}
-
-void WebSerialClass::println(char * c) {
-  if (webServer != nullptr) webSocket->textAll(String(c) + "\n");        
+bool WebSerialClass::addClient(AsyncWebSocketClient *client) {
+  bool added = false;
+  xSemaphoreTake(clientLock, portMAX_DELAY);
+  if (clientCount < WEBSERIAL_MAX_CLIENTS) {
+    clients[clientCount++] = { client, 0 };
+    added = true;
+  }
+  xSemaphoreGive(clientLock);
+  return added;
 }
 
-void WebSerialClass::println(String c) {
-  if (webServer != nullptr) webSocket->textAll(c + "\n");        
-}
+void WebSerialClass::removeClient(AsyncWebSocketClient *client) {
+  xSemaphoreTake(clientLock, portMAX_DELAY);
+  for (uint8_t i = 0; i < clientCount; i++) {
+    if (clients[i].client == client) {
+      clients[i] = clients[--clientCount];
+      break;
+    }
+  }
+  xSemaphoreGive(clientLock);
+}
+
+// Send the collected output if the flush interval has passed
+void WebSerialClass::loop() {
+  uint32_t now = millis();
+  if (now - rateStart >= 1000) {
+    framesPerSecond = rateFrames * 1000 / (now - rateStart);
+    bytesPerSecond = rateBytes * 1000 / (now - rateStart);
+    rateFrames = 0;
+    rateBytes = 0;
+    rateStart = now;
+  }
+  if (frameLength > 0 && now - lastFlush >= flushInterval) flush();
+}
+
+// Send the collected output as one frame to every client that is able to take it.
+// Clients with a full queue are skipped and dropped if they don't recover.
+void WebSerialClass::flush() {
+  lastFlush = millis();
+  if (frameLength == 0 || webServer == nullptr) return;
+
+  // Held across the sends, the async_tcp task cannot free a client in between.
+  // The client list of the AsyncWebSocket is not touched outside of its task.
+  xSemaphoreTake(clientLock, portMAX_DELAY);
+  for (uint8_t i = 0; i < clientCount; i++) {
+    AsyncWebSocketClient * client = clients[i].client;
+    if (client->status() != WS_CONNECTED) continue;
+
+    if (client->queueIsFull()) {
+      framesSkipped++;
+      if (++clients[i].skipped >= WEBSERIAL_MAX_SKIPPED) {
+        clientsDropped++;
+        client->close();
+      }
+    } else {
+      clients[i].skipped = 0;
+      client->text(frame, frameLength);
+      framesSent++;
+      bytesSent += frameLength;
+      rateFrames++;
+      rateBytes += frameLength;
+    }
+  }
+  xSemaphoreGive(clientLock);
 
-void WebSerialClass::println(long c) {
-  if (webServer != nullptr) webSocket->textAll(String(c) + "\n");        
+  frameLength = 0;
 }
 
-void WebSerialClass::println(unsigned long c) {
-  if (webServer != nullptr) webSocket->textAll(String(c) + "\n");        
+void WebSerialClass::append(const char * data, size_t len) {
+  if (webServer == nullptr) return;
+  while (len > 0) {
+    if (frameLength >= WEBSERIAL_FRAME_SIZE) flush();
+    size_t chunk = min(len, (size_t)WEBSERIAL_FRAME_SIZE - frameLength);
+    memcpy(frame + frameLength, data, chunk);
+    frameLength += chunk;
+    data += chunk;
+    len -= chunk;
+  }
+  frame[frameLength] = '\0';
 }
 
-// Based on LOG_INFO_F() from arduino/esp32 core
+// Formats directly into the frame buffer, output larger than a frame is truncated
 size_t WebSerialClass::printf(const char *format, ...) {
-  char loc_buf[64];
-  char * temp = loc_buf;
+  if (webServer == nullptr) return 0;
+
+  size_t room = WEBSERIAL_FRAME_SIZE - frameLength;
   va_list arg;
-  va_list copy;
   va_start(arg, format);
-  va_copy(copy, arg);
-  int len = vsnprintf(temp, sizeof(loc_buf), format, copy);
-  va_end(copy);
-  if (len < 0) {
-    va_end(arg);
-    return 0;
-  };
-  if (len >= sizeof(loc_buf)) {
-    temp = (char*) malloc(len+1);
-    if(temp == NULL) {
-      va_end(arg);
-      return 0;
-    }
-    len = vsnprintf(temp, len+1, format, arg);
-  }
+  int len = vsnprintf(frame + frameLength, room + 1, format, arg);
   va_end(arg);
+  if (len < 0) return 0;
 
-  print(String((uint8_t*)temp, len));
-
-  if(temp != loc_buf) free(temp);
+  if ((size_t)len > room && frameLength > 0) {
+    flush();
+    room = WEBSERIAL_FRAME_SIZE;
+    va_start(arg, format);
+    len = vsnprintf(frame, room + 1, format, arg);
+    va_end(arg);
+    if (len < 0) return 0;
+  }
+  len = min((size_t)len, room);
+  frameLength += len;
   return len;
 }
@@ -14,40 +14,71 @@
 #define WEBSERIAL_h
 
 #include <ESPAsyncWebServer.h>
+#include "format.h"
+
+#define WEBSERIAL_FRAME_SIZE        1024  // Max bytes to collect before a frame gets send
+#define WEBSERIAL_FLUSH_INTERVAL_MS 100   // Max time in ms to collect output before sending it
+#define WEBSERIAL_MAX_CLIENTS       4     // Max concurrent console clients
+#define WEBSERIAL_MAX_SKIPPED       20    // Drop a client after X frames skipped due to a full queue
 
 class WebSerialClass {
     public:
         void begin(AsyncWebServer *server, const char* url = "/api/webserial");
+        void loop();
+        void flush();
+        void setFlushInterval(uint32_t ms) { flushInterval = ms; }
+
+        uint32_t getFramesPerSecond() { return framesPerSecond; }
+        uint32_t getBytesPerSecond() { return bytesPerSecond; }
+        uint32_t getFramesSent() { return framesSent; }
+        uint32_t getBytesSent() { return bytesSent; }
+        uint32_t getFramesSkipped() { return framesSkipped; }
+        uint32_t getClientsDropped() { return clientsDropped; }
 
-        void print(int c);
-        void print(uint8_t c);
-        void print(uint16_t c);
-        void print(uint32_t c);
-        void print(double c);
-        void print(float c);
-        void print(const char * c);
-        void print(char * c);
-        void print(String c);
-        void print(long c);
-        void print(unsigned long c);
-
-        void println(int c);
-        void println(uint8_t c);
-        void println(uint16_t c);
-        void println(uint32_t c);
-        void println(float c);
-        void println(double c);
-        void println(const char * c);
-        void println(char * c);
-        void println(String c);
-        void println(long c);
-        void println(unsigned long c);
-
-        size_t printf(const char *format, ...);
+        // Any value supported by BufferWriter, formatted on the stack without allocation
+        template<typename T> void print(const T &value) {
+            char scratch[FORMAT_SCRATCH_SIZE];
+            FormatView view = formatView(scratch, sizeof(scratch), value);
+            append(view.data, view.length);
+        }
+        template<typename T> void println(const T &value) {
+            print(value);
+            append("\n", 1);
+        }
+
+        size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
 
     private:
         AsyncWebSocket * webSocket;
         AsyncWebServer * webServer = nullptr;
+
+        char frame[WEBSERIAL_FRAME_SIZE + 1];
+        size_t frameLength = 0;
+        uint32_t flushInterval = WEBSERIAL_FLUSH_INTERVAL_MS;
+        uint32_t lastFlush = 0;
+
+        // Only used while holding clientLock, the disconnect event removes a client before it is freed
+        struct wsclient_t {
+            AsyncWebSocketClient *client;
+            uint16_t skipped;
+        };
+        wsclient_t clients[WEBSERIAL_MAX_CLIENTS];
+        uint8_t clientCount = 0;
+        SemaphoreHandle_t clientLock = NULL;
+
+        uint32_t framesSent = 0;
+        uint32_t bytesSent = 0;
+        uint32_t framesSkipped = 0;
+        uint32_t clientsDropped = 0;
+        uint32_t framesPerSecond = 0;
+        uint32_t bytesPerSecond = 0;
+        uint32_t rateFrames = 0;
+        uint32_t rateBytes = 0;
+        uint32_t rateStart = 0;
+
+        void append(const char * data, size_t len);
+        bool addClient(AsyncWebSocketClient *client);
+        void removeClient(AsyncWebSocketClient *client);
 };
 
 #endif // WEBSERIAL_h
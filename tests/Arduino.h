@@ -0,0 +1,103 @@
+/**
+ * @file Arduino.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Arduino core and FreeRTOS stand-ins for the host tests
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef TESTS_ARDUINO_h
+#define TESTS_ARDUINO_h
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <mutex>
+#include <string>
+#include "../bench/Arduino.h"
+
+// Tasks are never started on the host, the tests call the task bodies themselves.
+// Mutexes are real ones, so tests with several threads see the same locking as the device.
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void *TaskHandle_t;
+typedef std::recursive_timed_mutex *SemaphoreHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define IRAM_ATTR
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdPASS              1
+#define portMAX_DELAY       0xFFFFFFFF
+#define portTICK_RATE_MS    1
+#define portTICK_PERIOD_MS  1
+#define tskIDLE_PRIORITY    0
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stack, void *parameter,
+                       UBaseType_t priority, TaskHandle_t *handle);
+void vTaskDelay(TickType_t ticks);
+
+struct portMUX_TYPE {
+  std::recursive_mutex mutex;
+};
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(mux) (mux)->mutex.lock()
+#define portEXIT_CRITICAL(mux)  (mux)->mutex.unlock()
+
+// The clock only moves when a test sets it or a task delays
+extern volatile uint32_t hostMillis;
+unsigned long millis();
+unsigned long micros();
+
+// Keeps everything written to it, writes() and largestWrite tell how the output was batched
+class HardwareSerial : public Print {
+    public:
+        std::string output;
+        uint32_t writes = 0;
+        size_t largestWrite = 0;
+
+        size_t write(uint8_t c) override { return write(&c, 1); }
+        size_t write(const uint8_t *data, size_t len) override {
+            output.append((const char *)data, len);
+            writes++;
+            if (len > largestWrite) largestWrite = len;
+            return len;
+        }
+        void clear() {
+            output.clear();
+            writes = 0;
+            largestWrite = 0;
+        }
+};
+extern HardwareSerial Serial;
+extern std::string hostWebSerial;       // Output of the WebSerial stand-in in tests/host.cpp
+
+class EspClass {
+    public:
+        uint32_t maxAllocHeap = 110000;
+        uint32_t getMaxAllocHeap() { return maxAllocHeap; }
+};
+extern EspClass ESP;
+
+// esp_random() asks hostRandom if a test set it, otherwise it returns a fixed xorshift sequence
+uint32_t esp_random();
+extern uint32_t (*hostRandom)();
+
+// Part of newlib on the device, glibc has it since 2.38
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+size_t strlcpy(char *dst, const char *src, size_t size);
+#endif
+
+#define constrain(amount, low, high) ((amount) < (low) ? (low) : ((amount) > (high) ? (high) : (amount)))
+
+#endif // TESTS_ARDUINO_h
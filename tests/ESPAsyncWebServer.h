@@ -0,0 +1,121 @@
+/**
+ * @file ESPAsyncWebServer.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Stand-in for the parts of ESPAsyncWebServer the tested modules use
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef TESTS_ESPASYNCWEBSERVER_h
+#define TESTS_ESPASYNCWEBSERVER_h
+
+#include <Arduino.h>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef WS_MAX_QUEUED_MESSAGES
+#define WS_MAX_QUEUED_MESSAGES 32
+#endif
+
+#define WS_TEXT 0x01
+
+enum AwsEventType { WS_EVT_CONNECT, WS_EVT_DISCONNECT, WS_EVT_PONG, WS_EVT_ERROR, WS_EVT_DATA };
+enum AwsClientStatus { WS_DISCONNECTED, WS_CONNECTED, WS_DISCONNECTING };
+
+struct AwsFrameInfo {
+  uint8_t message_opcode;
+  uint32_t num;
+  uint8_t final;
+  uint8_t masked;
+  uint8_t opcode;
+  uint64_t len;
+  uint8_t mask[4];
+  uint64_t index;
+};
+
+class AsyncWebSocket;
+class AsyncWebSocketClient;
+typedef std::function<void(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type,
+                           void *arg, uint8_t *data, size_t len)> AwsEventHandler;
+
+class AsyncWebServer {};
+
+class AsyncWebSocket {
+    public:
+        AsyncWebSocket(const char *url = "") {}
+        void onEvent(AwsEventHandler handler) { this->handler = handler; }
+        void handleEvent(AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
+            if (handler) handler(this, client, type, arg, data, len);
+        }
+
+    private:
+        AwsEventHandler handler;
+};
+
+// Connects in the constructor and disconnects in the destructor, the order of the library.
+// The test plays the async_tcp task: it creates, drains and deletes the clients.
+class AsyncWebSocketClient {
+    public:
+        AsyncWebSocketClient(AsyncWebSocket *server, uint32_t id) : server(server), clientId(id) {
+            server->handleEvent(this, WS_EVT_CONNECT, NULL, NULL, 0);
+        }
+        ~AsyncWebSocketClient() {
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                clientStatus = WS_DISCONNECTED;
+                queue.clear();
+            }
+            server->handleEvent(this, WS_EVT_DISCONNECT, NULL, NULL, 0);
+        }
+
+        uint32_t id() { return clientId; }
+        AwsClientStatus status() {
+            std::lock_guard<std::mutex> guard(mutex);
+            return clientStatus;
+        }
+        bool queueIsFull() {
+            std::lock_guard<std::mutex> guard(mutex);
+            return queue.size() >= WS_MAX_QUEUED_MESSAGES || clientStatus != WS_CONNECTED;
+        }
+        void text(const char *message) { text(message, strlen(message)); }
+        void text(const char *message, size_t len) {
+            std::lock_guard<std::mutex> guard(mutex);
+            if (clientStatus != WS_CONNECTED || queue.size() >= WS_MAX_QUEUED_MESSAGES) return;
+            queue.push_back(std::string(message, len));
+        }
+        void close(uint16_t code = 0, const char *message = NULL) {
+            std::lock_guard<std::mutex> guard(mutex);
+            if (clientStatus != WS_CONNECTED) return;
+            closeCode = code;
+            clientStatus = WS_DISCONNECTING;
+        }
+
+        // Frames sent to the network since the last call
+        std::vector<std::string> take() {
+            std::lock_guard<std::mutex> guard(mutex);
+            std::vector<std::string> frames;
+            frames.swap(queue);
+            return frames;
+        }
+        uint16_t getCloseCode() {
+            std::lock_guard<std::mutex> guard(mutex);
+            return closeCode;
+        }
+
+    private:
+        AsyncWebSocket *server;
+        uint32_t clientId;
+        std::mutex mutex;
+        AwsClientStatus clientStatus = WS_CONNECTED;
+        std::vector<std::string> queue;
+        uint16_t closeCode = 0;
+};
+
+#endif // TESTS_ESPASYNCWEBSERVER_h
@@ -0,0 +1,19 @@
+/**
+ * @file Preferences.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Stand-in for the NVS Preferences of the Arduino core, only the type is used by the tested modules
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef TESTS_PREFERENCES_h
+#define TESTS_PREFERENCES_h
+
+class Preferences {};
+
+#endif // TESTS_PREFERENCES_h
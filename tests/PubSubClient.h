@@ -0,0 +1,84 @@
+/**
+ * @file PubSubClient.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Stand-in for PubSubClient, the tests script the broker answers and the connect time
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef TESTS_PUBSUBCLIENT_h
+#define TESTS_PUBSUBCLIENT_h
+
+#include <Arduino.h>
+#include <string>
+#include "WiFi.h"
+
+#define MQTT_CONNECTION_TIMEOUT     -4
+#define MQTT_CONNECTION_LOST        -3
+#define MQTT_CONNECT_FAILED         -2
+#define MQTT_DISCONNECTED           -1
+#define MQTT_CONNECTED               0
+#define MQTT_CONNECT_BAD_PROTOCOL    1
+#define MQTT_CONNECT_BAD_CLIENT_ID   2
+#define MQTT_CONNECT_UNAVAILABLE     3
+#define MQTT_CONNECT_BAD_CREDENTIALS 4
+#define MQTT_CONNECT_UNAUTHORIZED    5
+
+class PubSubClient {
+    public:
+        // Answers of the broker, connect() moves the host clock by connectMillis
+        bool connectResult = false;
+        int failureState = MQTT_CONNECT_FAILED;
+        uint32_t connectMillis = 0;
+        bool loopResult = true;
+
+        uint32_t connects = 0;
+        uint32_t disconnects = 0;
+        uint32_t publishes = 0;
+        std::string host;
+        IPAddress ip;
+        uint16_t port = 0;
+
+        void setClient(WiFiClient &client) {}
+        void setServer(IPAddress ip, uint16_t port) {
+            this->ip = ip;
+            this->host.clear();
+            this->port = port;
+        }
+        void setServer(const char *domain, uint16_t port) {
+            this->ip = IPAddress();
+            this->host = domain;
+            this->port = port;
+        }
+        bool connect(const char *id, const char *user, const char *pass, const char *willTopic,
+                     uint8_t willQos, bool willRetain, const char *willMessage, bool cleanSession) {
+            connects++;
+            hostMillis = hostMillis + connectMillis;
+            currentState = connectResult ? MQTT_CONNECTED : failureState;
+            return connectResult;
+        }
+        int state() { return currentState; }
+        bool loop() {
+            if (!loopResult) currentState = MQTT_CONNECTION_LOST;
+            return loopResult;
+        }
+        void disconnect() {
+            disconnects++;
+            currentState = MQTT_DISCONNECTED;
+        }
+        bool publish(const char *topic, const char *payload, bool retained) {
+            if (currentState != MQTT_CONNECTED) return false;
+            publishes++;
+            return true;
+        }
+
+    private:
+        int currentState = MQTT_DISCONNECTED;
+};
+
+#endif // TESTS_PUBSUBCLIENT_h
@@ -0,0 +1,65 @@
+/**
+ * @file WiFi.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Stand-in for the WiFi of the Arduino core, the tests set the link state
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef TESTS_WIFI_h
+#define TESTS_WIFI_h
+
+#include <Arduino.h>
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum { WIFI_MODE_NULL = 0, WIFI_MODE_STA, WIFI_MODE_AP, WIFI_MODE_APSTA } wifi_mode_t;
+
+class IPAddress : public Printable {
+    public:
+        uint8_t bytes[4] = {};
+
+        bool fromString(const String &address) { return fromString(address.c_str()); }
+        bool fromString(const char *address) {
+            unsigned int part[4];
+            char end;
+            if (sscanf(address, "%u.%u.%u.%u%c", &part[0], &part[1], &part[2], &part[3], &end) != 4) return false;
+            for (uint8_t i = 0; i < 4; i++) {
+                if (part[i] > 255) return false;
+                bytes[i] = part[i];
+            }
+            return true;
+        }
+        size_t printTo(Print &p) const override {
+            char text[16];
+            int len = snprintf(text, sizeof(text), "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+            return p.write((const uint8_t *)text, len);
+        }
+};
+
+class WiFiClient {};
+
+class WiFiClass {
+    public:
+        wl_status_t hostStatus = WL_CONNECTED;
+        wifi_mode_t hostMode = WIFI_MODE_STA;
+
+        wl_status_t status() { return hostStatus; }
+        wifi_mode_t getMode() { return hostMode; }
+};
+extern WiFiClass WiFi;
+
+#endif // TESTS_WIFI_h
@@ -0,0 +1,83 @@
+/**
+ * @file miniz.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Stand-in for the tinfl inflater of the ESP32 ROM, implemented with zlib
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef TESTS_MINIZ_h
+#define TESTS_MINIZ_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <zlib.h>
+
+#define TINFL_LZ_DICT_SIZE          32768
+#define TINFL_FLAG_HAS_MORE_INPUT   2
+
+typedef enum {
+  TINFL_STATUS_BAD_PARAM = -3,
+  TINFL_STATUS_ADLER32_MISMATCH = -2,
+  TINFL_STATUS_FAILED = -1,
+  TINFL_STATUS_DONE = 0,
+  TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+  TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+// The firmware releases the decompressor with free() only, like the ROM one it must not own
+// other allocations. zlib allocates its state and window from the arena behind the stream.
+struct tinfl_decompressor {
+  z_stream stream;
+  bool started;
+  size_t used;
+  alignas(16) uint8_t arena[48 * 1024];
+};
+
+static inline voidpf tinflArenaAlloc(voidpf opaque, uInt items, uInt size) {
+  tinfl_decompressor *r = (tinfl_decompressor *)opaque;
+  size_t bytes = ((size_t)items * size + 15) & ~(size_t)15;
+  if (r->used + bytes > sizeof(r->arena)) return Z_NULL;
+  voidpf pointer = r->arena + r->used;
+  r->used += bytes;
+  return pointer;
+}
+static inline void tinflArenaFree(voidpf opaque, voidpf address) {}
+
+static inline void tinfl_init(tinfl_decompressor *r) {
+  memset(&r->stream, 0, sizeof(r->stream));
+  r->started = false;
+  r->used = 0;
+}
+
+// Raw deflate into the wrapping dictionary, the back references are resolved by the zlib window
+static inline tinfl_status tinfl_decompress(tinfl_decompressor *r, const uint8_t *pIn_buf_next, size_t *pIn_buf_size,
+                                            uint8_t *pOut_buf_start, uint8_t *pOut_buf_next, size_t *pOut_buf_size,
+                                            const uint32_t decomp_flags) {
+  if (!r->started) {
+    r->stream.zalloc = tinflArenaAlloc;
+    r->stream.zfree = tinflArenaFree;
+    r->stream.opaque = r;
+    if (inflateInit2(&r->stream, -MAX_WBITS) != Z_OK) return TINFL_STATUS_BAD_PARAM;
+    r->started = true;
+  }
+  r->stream.next_in = (Bytef *)pIn_buf_next;
+  r->stream.avail_in = *pIn_buf_size;
+  r->stream.next_out = pOut_buf_next;
+  r->stream.avail_out = *pOut_buf_size;
+  int result = inflate(&r->stream, Z_NO_FLUSH);
+  *pIn_buf_size -= r->stream.avail_in;
+  *pOut_buf_size -= r->stream.avail_out;
+
+  if (result == Z_STREAM_END) return TINFL_STATUS_DONE;
+  if (result != Z_OK && result != Z_BUF_ERROR) return TINFL_STATUS_FAILED;
+  return r->stream.avail_out ? TINFL_STATUS_NEEDS_MORE_INPUT : TINFL_STATUS_HAS_MORE_OUTPUT;
+}
+
+#endif // TESTS_MINIZ_h
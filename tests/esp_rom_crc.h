@@ -0,0 +1,25 @@
+/**
+ * @file esp_rom_crc.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Stand-in for the CRC functions of the ESP32 ROM, implemented with zlib
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef TESTS_ESP_ROM_CRC_h
+#define TESTS_ESP_ROM_CRC_h
+
+#include <stdint.h>
+#include <zlib.h>
+
+// Same result as the ROM, the CRC-32 of gzip
+static inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len) {
+  return crc32(crc, buf, len);
+}
+
+#endif // TESTS_ESP_ROM_CRC_h
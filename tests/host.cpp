@@ -0,0 +1,124 @@
+/**
+ * @file host.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Arduino core and FreeRTOS stand-ins for the host tests
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <chrono>
+#include <new>
+#include <thread>
+#include "log.h"
+#include "WiFi.h"
+#include "test.h"
+
+volatile uint32_t hostMillis = 0;
+std::atomic<uint32_t> hostAllocations(0);
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+uint32_t (*hostRandom)() = NULL;
+
+// The firmware globals from main.cpp that the tested modules log to
+LogSinkClass LogSink;
+WebSerialClass WebSerial;
+std::string hostWebSerial;
+
+unsigned long millis() { return hostMillis; }
+unsigned long micros() { return hostMillis * 1000UL; }
+
+uint32_t esp_random() {
+  static uint32_t state = 0x3C6EF372;
+  if (hostRandom) return hostRandom();
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+size_t strlcpy(char *dst, const char *src, size_t size) {
+  size_t length = strlen(src);
+  if (size) {
+    size_t copy = length < size - 1 ? length : size - 1;
+    memcpy(dst, src, copy);
+    dst[copy] = '\0';
+  }
+  return length;
+}
+#endif
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return new std::recursive_timed_mutex();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+  if (ticks == portMAX_DELAY) {
+    semaphore->lock();
+    return pdTRUE;
+  }
+  return semaphore->try_lock_for(std::chrono::milliseconds(ticks)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  semaphore->unlock();
+  return pdTRUE;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stack, void *parameter,
+                       UBaseType_t priority, TaskHandle_t *handle) {
+  if (handle) *handle = NULL;
+  return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks) {
+  hostMillis = hostMillis + ticks;
+  std::this_thread::yield();
+}
+
+// WebSerial without a web server, the output is kept for the tests
+void WebSerialClass::append(const char *data, size_t len) { hostWebSerial.append(data, len); }
+void WebSerialClass::flush() {}
+void WebSerialClass::loop() {}
+
+// The malloc family is wrapped by the linker (see env:test), operator new ends up here as well.
+// Only calls from the compiled sources are seen, not the ones inside the C library.
+extern "C" {
+  void *__real_malloc(size_t size);
+  void *__real_calloc(size_t count, size_t size);
+  void *__real_realloc(void *pointer, size_t size);
+
+  void *__wrap_malloc(size_t size) {
+    hostAllocations++;
+    return __real_malloc(size);
+  }
+  void *__wrap_calloc(size_t count, size_t size) {
+    hostAllocations++;
+    return __real_calloc(count, size);
+  }
+  void *__wrap_realloc(void *pointer, size_t size) {
+    hostAllocations++;
+    return __real_realloc(pointer, size);
+  }
+}
+
+void *operator new(size_t size) {
+  void *pointer = malloc(size ? size : 1);
+  if (!pointer) throw std::bad_alloc();
+  return pointer;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return malloc(size ? size : 1);
+}
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept { return operator new(size, tag); }
+void operator delete(void *pointer) noexcept { free(pointer); }
+void operator delete[](void *pointer) noexcept { free(pointer); }
+void operator delete(void *pointer, size_t) noexcept { free(pointer); }
+void operator delete[](void *pointer, size_t) noexcept { free(pointer); }
@@ -0,0 +1,63 @@
+/**
+ * @file main.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Host tests of the portable firmware modules
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "test.h"
+
+TestCase *TestCase::first = NULL;
+static TestCase **last = &TestCase::first;
+static bool failed = false;
+
+TestCase::TestCase(const char *name, testcase_fn run) : name(name), run(run), next(NULL) {
+  *last = this;
+  last = &next;
+}
+
+bool testCheck(bool condition, const char *expression, const char *file, int line) {
+  if (condition) return true;
+  printf("  %s:%d: CHECK(%s) failed\n", file, line, expression);
+  failed = true;
+  return false;
+}
+
+bool testCheckEqual(int64_t expected, int64_t actual, const char *expression, const char *file, int line) {
+  if (expected == actual) return true;
+  printf("  %s:%d: %s is %" PRId64 ", expected %" PRId64 "\n", file, line, expression, actual, expected);
+  failed = true;
+  return false;
+}
+
+bool testCheckString(const char *expected, const char *actual, const char *expression, const char *file, int line) {
+  if (expected && actual && strcmp(expected, actual) == 0) return true;
+  printf("  %s:%d: %s is \"%s\", expected \"%s\"\n", file, line, expression, actual ? actual : "(null)", expected ? expected : "(null)");
+  failed = true;
+  return false;
+}
+
+// Runs all tests or the ones whose name contains the first argument, exits with 1 on any failure
+int main(int argc, char **argv) {
+  setvbuf(stdout, NULL, _IOLBF, 0);
+  const char *filter = argc > 1 ? argv[1] : NULL;
+  uint32_t passed = 0, failures = 0;
+  for (TestCase *test = TestCase::first; test; test = test->next) {
+    if (filter && !strstr(test->name, filter)) continue;
+    failed = false;
+    test->run();
+    printf("[%s] %s\n", failed ? "FAIL" : "PASS", test->name);
+    if (failed) failures++;
+    else passed++;
+  }
+  printf("%u passed, %u failed\n", passed, failures);
+  return failures ? 1 : 0;
+}
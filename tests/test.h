@@ -0,0 +1,50 @@
+/**
+ * @file test.h
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Minimal test runner for the host tests
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#ifndef TEST_h
+#define TEST_h
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+typedef void (*testcase_fn)();
+
+// Every TEST_CASE registers itself, tests/main.cpp runs them in the order of the linker
+struct TestCase {
+  const char *name;
+  testcase_fn run;
+  TestCase *next;
+
+  TestCase(const char *name, testcase_fn run);
+  static TestCase *first;
+};
+
+#define TEST_CASE(name) \
+  static void name(); \
+  static TestCase name##Case(#name, name); \
+  static void name()
+
+bool testCheck(bool condition, const char *expression, const char *file, int line);
+bool testCheckEqual(int64_t expected, int64_t actual, const char *expression, const char *file, int line);
+bool testCheckString(const char *expected, const char *actual, const char *expression, const char *file, int line);
+
+// All checks continue on failure, the test case is reported as failed at the end
+#define CHECK(condition) testCheck((condition), #condition, __FILE__, __LINE__)
+#define CHECK_EQUAL(expected, actual) testCheckEqual((int64_t)(expected), (int64_t)(actual), #actual, __FILE__, __LINE__)
+#define CHECK_STRING(expected, actual) testCheckString((expected), (actual), #actual, __FILE__, __LINE__)
+
+// Calls of malloc(), calloc(), realloc() and operator new since the start, counted by tests/host.cpp
+extern std::atomic<uint32_t> hostAllocations;
+
+#endif // TEST_h
@@ -0,0 +1,147 @@
+/**
+ * @file test_bodybuffer.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Chunk assembly of request bodies, directed cases and a fuzz run over broken chunk sequences
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <vector>
+#include "bodybuffer.h"
+#include "test.h"
+
+struct chunk_t {
+  size_t index;
+  size_t len;
+  size_t total;
+};
+
+// The statuses jsonBodyHandler() answers with a response
+static bool answers(body_status_t status) {
+  return status != BODY_PENDING && status != BODY_IGNORED;
+}
+
+TEST_CASE(bodyAssemblesChunks) {
+  const char *body = "{\"hello\":\"world\"}";
+  size_t total = strlen(body);
+  bodybuffer_t *buffer = NULL;
+  CHECK_EQUAL(BODY_PENDING, bodyFeed(buffer, (const uint8_t *)body, 5, 0, total, 64));
+  CHECK_EQUAL(BODY_PENDING, bodyFeed(buffer, (const uint8_t *)body + 5, 0, 5, total, 64));
+  CHECK_EQUAL(BODY_COMPLETE, bodyFeed(buffer, (const uint8_t *)body + 5, total - 5, 5, total, 64));
+  CHECK_STRING(body, buffer->data);
+  free(buffer);
+
+  // An empty body is complete with the first chunk
+  buffer = NULL;
+  CHECK_EQUAL(BODY_COMPLETE, bodyFeed(buffer, NULL, 0, 0, 0, 64));
+  CHECK_STRING("", buffer->data);
+  free(buffer);
+}
+
+TEST_CASE(bodyRejectsWithOneAnswer) {
+  const uint8_t data[16] = {};
+  bodybuffer_t *buffer = NULL;
+
+  // Above the budget, nothing is allocated and the rest of the body is ignored
+  CHECK_EQUAL(BODY_TOO_LARGE, bodyFeed(buffer, data, 8, 0, 65, 64));
+  CHECK(buffer == NULL);
+  CHECK_EQUAL(BODY_IGNORED, bodyFeed(buffer, data, 8, 8, 65, 64));
+
+  // The first chunk already exceeds the Content-Length
+  CHECK_EQUAL(BODY_INVALID, bodyFeed(buffer, data, 9, 0, 8, 64));
+  CHECK(buffer == NULL);
+  CHECK_EQUAL(BODY_IGNORED, bodyFeed(buffer, data, 8, 9, 8, 64));
+
+  // A gap in the middle of the body
+  CHECK_EQUAL(BODY_PENDING, bodyFeed(buffer, data, 4, 0, 16, 64));
+  CHECK_EQUAL(BODY_INVALID, bodyFeed(buffer, data, 4, 8, 16, 64));
+  CHECK(buffer == NULL);
+  CHECK_EQUAL(BODY_IGNORED, bodyFeed(buffer, data, 8, 8, 16, 64));
+}
+
+// xorshift32, the runs are reproducible
+static uint32_t fuzzState = 0x2F6B1D3A;
+static uint32_t fuzzRandom(uint32_t range) {
+  fuzzState ^= fuzzState << 13;
+  fuzzState ^= fuzzState >> 17;
+  fuzzState ^= fuzzState << 5;
+  return range ? fuzzState % range : 0;
+}
+
+enum fuzz_mutation_t { FUZZ_NONE, FUZZ_DROP, FUZZ_DUPLICATE, FUZZ_SWAP, FUZZ_GROW, FUZZ_SHRINK, FUZZ_TOTAL, FUZZ_MUTATIONS };
+
+// Splits random bodies into chunks the way ESPAsyncWebServer delivers them, breaks the sequence
+// and checks that a body is either complete and intact or answered with a single error.
+TEST_CASE(bodyFuzzChunkSequences) {
+  const size_t budget = 256;
+  uint32_t completed = 0, rejected = 0;
+
+  for (uint32_t round = 0; round < 20000; round++) {
+    size_t total = fuzzRandom(4) ? fuzzRandom(budget + 32) : 0;
+    std::vector<uint8_t> body(total + 8);
+    for (uint8_t &byte : body) byte = fuzzRandom(256);
+
+    // The first chunk starts at index 0, all chunks carry the Content-Length
+    std::vector<chunk_t> chunks;
+    size_t index = 0;
+    do {
+      size_t len = total - index ? 1 + fuzzRandom(total - index) : 0;
+      chunks.push_back({ index, len, total });
+      index += len;
+    } while (index < total);
+
+    fuzz_mutation_t mutation = (fuzz_mutation_t)(fuzzRandom(2) ? FUZZ_NONE : fuzzRandom(FUZZ_MUTATIONS));
+    // The server never drops, repeats or moves the first chunk
+    size_t victim = chunks.size() > 1 ? 1 + fuzzRandom(chunks.size() - 1) : 0;
+    if (!victim && mutation != FUZZ_GROW && mutation != FUZZ_TOTAL) mutation = FUZZ_NONE;
+    switch (mutation) {
+      case FUZZ_DROP:      chunks.erase(chunks.begin() + victim); break;
+      case FUZZ_DUPLICATE: chunks.insert(chunks.begin() + victim, chunks[victim]); break;
+      case FUZZ_SWAP:      if (victim + 1 < chunks.size()) std::swap(chunks[victim], chunks[victim + 1]); break;
+      case FUZZ_GROW:      chunks[victim].len += 1 + fuzzRandom(8); break;
+      case FUZZ_SHRINK:    if (chunks[victim].len) chunks[victim].len--; break;
+      case FUZZ_TOTAL:     chunks[victim].total += fuzzRandom(2) ? 1 : -1; break;
+      default: break;
+    }
+
+    // Same handling as jsonBodyHandler(), the buffer is released once the body is answered
+    bodybuffer_t *buffer = NULL;
+    uint32_t answered = 0;
+    body_status_t status = BODY_PENDING, answer = BODY_PENDING;
+    for (const chunk_t &chunk : chunks) {
+      size_t len = chunk.index < body.size() ? std::min(chunk.len, body.size() - chunk.index) : 0;
+      status = bodyFeed(buffer, body.data() + std::min(chunk.index, body.size()), len, chunk.index, chunk.total, budget);
+      if (!answers(status)) continue;
+      answered++;
+      answer = status;
+      if (status == BODY_COMPLETE) {
+        completed++;
+        if (!CHECK(buffer->size == total && memcmp(buffer->data, body.data(), total) == 0)) return;
+        CHECK_EQUAL(0, buffer->data[total]);
+      } else {
+        rejected++;
+        CHECK(buffer == NULL);
+      }
+      free(buffer);
+      buffer = NULL;
+    }
+    free(buffer);
+
+    if (!CHECK(answered <= 1)) return;
+    if (mutation == FUZZ_NONE) {
+      // Complete within the budget, otherwise rejected with the first chunk
+      if (!CHECK_EQUAL(total > budget ? BODY_TOO_LARGE : BODY_COMPLETE, answer)) return;
+      CHECK_EQUAL(1, answered);
+    } else if (!answered) {
+      // Only a missing end leaves the body open, the server times the request out
+      CHECK_EQUAL(BODY_PENDING, status);
+    }
+  }
+  CHECK(completed > 1000);
+  CHECK(rejected > 1000);
+}
@@ -0,0 +1,104 @@
+/**
+ * @file test_dht22.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Decoding of recorded DHT22 pulse traces
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <math.h>
+#include <vector>
+#include "dht22decoder.h"
+#include "test.h"
+
+// Captured by the RMT: released line, host start pulse, sensor acknowledge, 40 bits and the
+// low level of the stop bit. 0x028D 0x8025 with checksum 0x34, 65.3 % and -3.7 °C.
+static const dhtpulse_t recorded[] = {
+  { 1, 12 }, { 0, 1104 }, { 1, 31 }, { 0, 81 }, { 1, 79 }, { 0, 53 }, { 1, 24 }, { 0, 54 },
+  { 1, 28 }, { 0, 48 }, { 1, 23 }, { 0, 56 }, { 1, 23 }, { 0, 53 }, { 1, 27 }, { 0, 48 },
+  { 1, 27 }, { 0, 51 }, { 1, 68 }, { 0, 49 }, { 1, 26 }, { 0, 54 }, { 1, 68 }, { 0, 51 },
+  { 1, 23 }, { 0, 56 }, { 1, 26 }, { 0, 48 }, { 1, 29 }, { 0, 49 }, { 1, 69 }, { 0, 48 },
+  { 1, 72 }, { 0, 54 }, { 1, 23 }, { 0, 51 }, { 1, 68 }, { 0, 56 }, { 1, 74 }, { 0, 50 },
+  { 1, 25 }, { 0, 54 }, { 1, 24 }, { 0, 56 }, { 1, 23 }, { 0, 52 }, { 1, 27 }, { 0, 50 },
+  { 1, 23 }, { 0, 51 }, { 1, 25 }, { 0, 49 }, { 1, 27 }, { 0, 49 }, { 1, 27 }, { 0, 48 },
+  { 1, 27 }, { 0, 51 }, { 1, 71 }, { 0, 56 }, { 1, 26 }, { 0, 53 }, { 1, 26 }, { 0, 55 },
+  { 1, 70 }, { 0, 52 }, { 1, 24 }, { 0, 50 }, { 1, 73 }, { 0, 51 }, { 1, 23 }, { 0, 52 },
+  { 1, 27 }, { 0, 55 }, { 1, 70 }, { 0, 55 }, { 1, 70 }, { 0, 49 }, { 1, 23 }, { 0, 56 },
+  { 1, 71 }, { 0, 50 }, { 1, 29 }, { 0, 53 }, { 1, 24 }, { 0, 52 },
+};
+
+// 40 bits with nominal timing, as in the benchmark
+static std::vector<dhtpulse_t> trace(const uint8_t (&data)[5]) {
+  std::vector<dhtpulse_t> pulses;
+  for (uint8_t bit = 0; bit < DHT22_BITS; bit++) {
+    pulses.push_back({ 0, 50 });
+    pulses.push_back({ 1, (uint16_t)(data[bit / 8] & (0x80 >> (bit % 8)) ? 70 : 26) });
+  }
+  pulses.push_back({ 0, 50 });
+  return pulses;
+}
+
+static bool near(float expected, float actual) {
+  return fabsf(expected - actual) < 0.01f;
+}
+
+TEST_CASE(dht22DecodesRecordedTrace) {
+  dhtreading_t reading = {};
+  CHECK_EQUAL(DHT_OK, dht22Decode(recorded, sizeof(recorded) / sizeof(recorded[0]), reading));
+  CHECK(near(65.3f, reading.humidity));
+  CHECK(near(-3.7f, reading.temperature));
+}
+
+TEST_CASE(dht22DecodesWithoutPreamble) {
+  const uint8_t data[5] = { 0x02, 0x8C, 0x00, 0x65, 0xF3 };
+  std::vector<dhtpulse_t> pulses = trace(data);
+  dhtreading_t reading = {};
+  CHECK_EQUAL(DHT_OK, dht22Decode(pulses.data(), pulses.size(), reading));
+  CHECK(near(65.2f, reading.humidity));
+  CHECK(near(10.1f, reading.temperature));
+
+  // An idle high level behind the stop bit is ignored as well
+  pulses.push_back({ 1, 1000 });
+  CHECK_EQUAL(DHT_OK, dht22Decode(pulses.data(), pulses.size(), reading));
+}
+
+TEST_CASE(dht22BitThreshold) {
+  const uint8_t data[5] = { 0, 0, 0, 0, 0 };
+  std::vector<dhtpulse_t> pulses = trace(data);
+  dhtreading_t reading = {};
+  // The high level of the LSB of the checksum, a 0 up to the threshold
+  dhtpulse_t &last = pulses[pulses.size() - 2];
+  last.duration = DHT22_BIT_THRESHOLD;
+  CHECK_EQUAL(DHT_OK, dht22Decode(pulses.data(), pulses.size(), reading));
+  last.duration = DHT22_BIT_THRESHOLD + 1;
+  CHECK_EQUAL(DHT_ERROR_CRC, dht22Decode(pulses.data(), pulses.size(), reading));
+}
+
+TEST_CASE(dht22RejectsBrokenTraces) {
+  const size_t count = sizeof(recorded) / sizeof(recorded[0]);
+  std::vector<dhtpulse_t> pulses(recorded, recorded + count);
+  dhtreading_t reading = {};
+
+  // A flipped bit in the humidity
+  pulses[18].duration = 26;
+  CHECK_EQUAL(DHT_ERROR_CRC, dht22Decode(pulses.data(), pulses.size(), reading));
+
+  // The capture started too late and missed the first bits
+  CHECK_EQUAL(DHT_ERROR_TIMEOUT, dht22Decode(recorded + 20, count - 20, reading));
+  CHECK_EQUAL(DHT_ERROR_TIMEOUT, dht22Decode(recorded, 0, reading));
+
+  // A low level outside of the specified timing, e.g. a glitch merged two pulses
+  pulses.assign(recorded, recorded + count);
+  pulses[41].duration = DHT22_BIT_LOW_MAX + 1;
+  CHECK_EQUAL(DHT_ERROR_PULSE, dht22Decode(pulses.data(), pulses.size(), reading));
+
+  // Two high levels in a row
+  pulses.assign(recorded, recorded + count);
+  pulses[41].level = 1;
+  CHECK_EQUAL(DHT_ERROR_PULSE, dht22Decode(pulses.data(), pulses.size(), reading));
+}
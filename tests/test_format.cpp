@@ -0,0 +1,152 @@
+/**
+ * @file test_format.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Allocation free formatting of BufferWriter, LogLine and WebSerial
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <math.h>
+#include "format.h"
+#include "log.h"
+#include "test.h"
+
+template<typename T> static std::string format(const T &value) {
+  char buffer[64];
+  BufferWriter writer(buffer, sizeof(buffer));
+  writer.print(value);
+  return std::string(buffer, writer.getLength());
+}
+
+static std::string formatFloat(double value, uint8_t digits) {
+  char buffer[64];
+  BufferWriter writer(buffer, sizeof(buffer));
+  writer.printFloat(value, digits);
+  return buffer;
+}
+
+class Address : public Printable {
+    public:
+        size_t printTo(Print &p) const override {
+            size_t written = 0;
+            for (uint8_t i = 0; i < 4; i++) {
+                char part[4];
+                int len = snprintf(part, sizeof(part), "%u", octets[i]);
+                written += p.write((const uint8_t *)part, len);
+                if (i < 3) written += p.write('.');
+            }
+            return written;
+        }
+        uint8_t octets[4] = { 192, 168, 4, 1 };
+};
+
+// Same output as Print::print() of the Arduino core
+TEST_CASE(formatIntegers) {
+  CHECK(format(0) == "0");
+  CHECK(format(-1) == "-1");
+  CHECK(format(INT32_MIN) == "-2147483648");
+  CHECK(format(INT64_MIN) == "-9223372036854775808");
+  CHECK(format(UINT64_MAX) == "18446744073709551615");
+  CHECK(format((uint8_t)255) == "255");
+  CHECK(format((int8_t)-128) == "-128");
+  CHECK(format((unsigned long)4000000000UL) == "4000000000");
+}
+
+TEST_CASE(formatFloats) {
+  CHECK(format(3.14159f) == "3.14");
+  CHECK(format(1.0 / 3) == "0.33");
+  CHECK(format(-0.005) == "-0.01");
+  CHECK(format(99.999) == "100.00");
+  CHECK(formatFloat(2.5, 0) == "3");
+  CHECK(formatFloat(21.456, 1) == "21.5");
+  CHECK(formatFloat(NAN, 2) == "nan");
+  CHECK(formatFloat(INFINITY, 2) == "inf");
+  CHECK(formatFloat(-INFINITY, 2) == "-inf");
+  CHECK(formatFloat(5e9, 2) == "ovf");
+}
+
+TEST_CASE(formatOtherTypes) {
+  CHECK(format('A') == "A");
+  CHECK(format(true) == "1");
+  CHECK(format(false) == "0");
+  CHECK(format("text") == "text");
+  CHECK(format(String("string")) == "string");
+  CHECK(format(F("flash")) == "flash");
+  CHECK(format(Address()) == "192.168.4.1");
+}
+
+TEST_CASE(formatTruncates) {
+  char buffer[8];
+  BufferWriter writer(buffer, sizeof(buffer));
+  CHECK_EQUAL(7, writer.print("1234567890"));
+  CHECK_STRING("1234567", buffer);
+  CHECK(writer.full());
+  CHECK_EQUAL(0, writer.print(42));
+  writer.clear();
+  CHECK_EQUAL(3, writer.println(12));
+  CHECK_STRING("12\n", writer.c_str());
+
+  char empty[1] = { 'x' };
+  BufferWriter none(empty, 0);
+  CHECK_EQUAL(0, none.print(12345));
+  CHECK(none.full());
+  CHECK_EQUAL('x', empty[0]);
+}
+
+TEST_CASE(formatViewPassesStringsThrough) {
+  char scratch[FORMAT_SCRATCH_SIZE];
+  const char *text = "no copy";
+  FormatView view = formatView(scratch, sizeof(scratch), text);
+  CHECK(view.data == text);
+  CHECK_EQUAL(7, view.length);
+
+  view = formatView(scratch, sizeof(scratch), -4711);
+  CHECK(view.data == scratch);
+  CHECK(std::string(view.data, view.length) == "-4711");
+}
+
+TEST_CASE(formatWithoutAllocation) {
+  LogSink.flush();
+  Serial.clear();
+  // The counter sees malloc() itself, not only operator new
+  uint32_t before = hostAllocations;
+  void *volatile probe = malloc(16);
+  free(probe);
+  probe = calloc(2, 8);
+  probe = realloc(probe, 32);
+  free(probe);
+  CHECK_EQUAL(before + 3, hostAllocations);
+
+  before = hostAllocations;
+  char buffer[64];
+  BufferWriter writer(buffer, sizeof(buffer));
+  writer.print(123456789);
+  writer.printFloat(-273.15, 2);
+  writer.print(Address());
+  writer.print(F("flash"));
+  LOG_INFO_F("[TEST] %d %s\n", 42, "printf");
+  // Longer than the 64 byte stack buffer of Print::printf(), which mallocs for the rest
+  LOG_INFO_F("[TEST] %s %s %u\n", "a formatted line that does not fit into", "the 64 bytes", 64u);
+  LOG_INFO(3.5f);
+  LOG_INFO_LN((uint64_t)1 << 40);
+  CHECK_EQUAL(before, hostAllocations);
+
+  LogSink.flush();
+  CHECK_STRING("[TEST] 42 printf\n"
+               "[TEST] a formatted line that does not fit into the 64 bytes 64\n"
+               "3.501099511627776\n", Serial.output.c_str());
+}
+
+TEST_CASE(formatWebSerial) {
+  hostWebSerial.clear();
+  WebSerial.print(-7);
+  WebSerial.print(' ');
+  WebSerial.println(0.125f);
+  WebSerial.print(Address());
+  CHECK(hostWebSerial == "-7 0.13\n192.168.4.1");
+}
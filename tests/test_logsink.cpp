@@ -0,0 +1,192 @@
+/**
+ * @file test_logsink.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Ring buffer, batching and the never blocking producers of the log sink
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "log.h"
+#include "test.h"
+
+TEST_CASE(logSinkKeepsTheOrder) {
+  static LogSinkClass sink;
+  Serial.clear();
+  std::string expected;
+  for (uint32_t i = 0; i < LOGSINK_SLOT_COUNT; i++) {
+    char line[32];
+    int len = snprintf(line, sizeof(line), "record %u\n", i);
+    CHECK(sink.push(line, len));
+    expected += line;
+  }
+  sink.flush();
+  CHECK(Serial.output == expected);
+  CHECK_EQUAL(LOGSINK_SLOT_COUNT, sink.getWritten());
+  CHECK_EQUAL(0, sink.getDropped());
+}
+
+TEST_CASE(logSinkBatchesTheOutput) {
+  static LogSinkClass sink;
+  Serial.clear();
+  char line[100];
+  memset(line, 'x', sizeof(line) - 1);
+  line[sizeof(line) - 1] = '\n';
+  for (uint32_t i = 0; i < 20; i++) sink.push(line, sizeof(line));
+  sink.flush();
+  // 2000 bytes in whole records of 100 bytes, 5 per batch of 512 bytes
+  CHECK_EQUAL(20 * sizeof(line), Serial.output.size());
+  CHECK_EQUAL(4, Serial.writes);
+  CHECK(Serial.largestWrite <= LOGSINK_BATCH_SIZE);
+}
+
+TEST_CASE(logSinkDropsWhenFull) {
+  static LogSinkClass sink;
+  Serial.clear();
+  // Nothing drains, the producer must return right away instead of waiting for space
+  for (uint32_t i = 0; i < LOGSINK_SLOT_COUNT; i++) CHECK(sink.push("a", 1));
+  for (uint32_t i = 0; i < 5; i++) CHECK(!sink.push("b", 1));
+  CHECK_EQUAL(5, sink.getDropped());
+
+  sink.flush();
+  CHECK(Serial.output == std::string(LOGSINK_SLOT_COUNT, 'a') + "[LOG] 5 messages dropped\n");
+  // The ring is usable again and the drops are only reported once
+  Serial.clear();
+  CHECK(sink.push("c", 1));
+  sink.flush();
+  CHECK_STRING("c", Serial.output.c_str());
+}
+
+TEST_CASE(logSinkTruncatesLongRecords) {
+  static LogSinkClass sink;
+  Serial.clear();
+  char line[LOGSINK_SLOT_SIZE + 50];
+  memset(line, 'y', sizeof(line));
+  CHECK(sink.push(line, sizeof(line)));
+  CHECK(sink.push("", 0));
+  sink.flush();
+  CHECK_EQUAL(LOGSINK_SLOT_SIZE, Serial.output.size());
+}
+
+TEST_CASE(logMacrosFormatOneRecord) {
+  LogSink.flush();
+  Serial.clear();
+  hostWebSerial.clear();
+  uint32_t before = LogSink.getWritten();
+  LOG_INFO_F("[TEST] %s %u\n", "value", 42u);
+  LOG_INFO(-12);
+  LOG_INFO_LN(3.14159f);
+  LOG_INFO_LN(F("flash string"));
+  CHECK_EQUAL(before + 4, LogSink.getWritten());
+  LogSink.flush();
+  CHECK_STRING("[TEST] value 42\n-123.14\nflash string\n", Serial.output.c_str());
+  // Serial and WebSerial get the same batches
+  CHECK(hostWebSerial == Serial.output);
+}
+
+TEST_CASE(logLinePrintfStartsANewRecord) {
+  LogSink.flush();
+  Serial.clear();
+  uint32_t before = LogSink.getWritten();
+  {
+    LogLine line;
+    char text[LOGSINK_SLOT_SIZE];
+    memset(text, 'z', sizeof(text) - 1);
+    text[sizeof(text) - 1] = '\0';
+    line.print("head ");
+    // Does not fit behind "head ", the pending output becomes a record of its own
+    line.printf("%s", text);
+    line.commit();
+  }
+  CHECK_EQUAL(before + 2, LogSink.getWritten());
+  LogSink.flush();
+  CHECK_EQUAL(5 + LOGSINK_SLOT_SIZE - 1, Serial.output.size());
+  CHECK(Serial.output.compare(0, 5, "head ") == 0);
+}
+
+// What a caller pays for a log statement, with room in the ring and with a full one
+TEST_CASE(logProducerCallTime) {
+  const uint32_t calls = 20000;
+  const double boundUs = 10;        // Generous for the sanitizer build, a blocking producer takes ms
+  LogSink.flush();
+  Serial.clear();
+
+  double totalUs = 0, slowestUs = 0;
+  uint32_t accepted = 0;
+  uint32_t before = LogSink.getWritten();
+  for (uint32_t i = 0; i < calls; i++) {
+    auto call = std::chrono::steady_clock::now();
+    LOG_INFO_F("[TEST] call %u of %u, value %d\n", i, calls, -(int32_t)i);
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - call).count();
+    totalUs += us;
+    if (us > slowestUs) slowestUs = us;
+    // Drained now and then like the LOG_task, most calls find a full ring and drop
+    if (i % 1000 == 999) {
+      accepted += LogSink.getWritten() - before;
+      LogSink.flush();
+      before = LogSink.getWritten();
+    }
+  }
+  double meanUs = totalUs / calls;
+  LogSink.flush();
+  Serial.clear();
+  printf("  LOG_INFO_F: %.3f us per call, slowest %.1f us\n", meanUs, slowestUs);
+
+  CHECK(accepted > 0);
+  CHECK(meanUs < boundUs);
+  // A single call never waits for the consumer, a scheduler hiccup of the host stays below this
+  CHECK(slowestUs < 5000);
+}
+
+// Producers on several threads and one consumer, every record arrives once and in order
+TEST_CASE(logSinkConcurrentProducers) {
+  static LogSinkClass sink;
+  Serial.clear();
+  const uint32_t producers = 4, records = 20000;
+  std::atomic<bool> running(true);
+  std::thread consumer([&]() {
+    while (running) sink.flush();
+    sink.flush();
+  });
+  std::vector<std::thread> threads;
+  for (uint32_t p = 0; p < producers; p++) {
+    threads.emplace_back([p]() {
+      char line[24];
+      for (uint32_t i = 0; i < records; i++) {
+        int len = snprintf(line, sizeof(line), "%u:%u\n", p, i);
+        sink.push(line, len);
+      }
+    });
+  }
+  for (std::thread &thread : threads) thread.join();
+  running = false;
+  consumer.join();
+
+  CHECK_EQUAL(producers * records, sink.getWritten() + sink.getDropped());
+  int64_t last[producers];
+  for (uint32_t p = 0; p < producers; p++) last[p] = -1;
+  uint32_t lines = 0;
+  bool ordered = true;
+  size_t pos = 0;
+  while (pos < Serial.output.size()) {
+    size_t end = Serial.output.find('\n', pos);
+    std::string line = Serial.output.substr(pos, end - pos);
+    pos = end + 1;
+    if (line[0] == '[') continue;   // Report of the dropped records
+    uint32_t p, i;
+    if (sscanf(line.c_str(), "%u:%u", &p, &i) != 2 || p >= producers || (int64_t)i <= last[p]) ordered = false;
+    else last[p] = i;
+    lines++;
+  }
+  CHECK(ordered);
+  CHECK_EQUAL(sink.getWritten(), lines);
+}
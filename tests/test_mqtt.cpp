@@ -0,0 +1,187 @@
+/**
+ * @file test_mqtt.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Connection state machine of the MQTT client against a scripted broker and the host clock
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include "MQTTclient.h"
+#include "log.h"
+#include "test.h"
+
+// Delay of the last "Next connection attempt in X ms" line, 0 if there was none
+static uint32_t announcedDelay() {
+  LogSink.flush();
+  uint32_t delay = 0;
+  const char *marker = "[MQTT] Next connection attempt in ";
+  size_t pos = Serial.output.rfind(marker);
+  if (pos != std::string::npos) delay = strtoul(Serial.output.c_str() + pos + strlen(marker), NULL, 10);
+  Serial.clear();
+  return delay;
+}
+
+static void step(MQTTclient &mqtt) {
+  mqtt.handle();
+  LogSink.flush();
+  Serial.clear();
+}
+
+// The instances are static, the lock of a MQTTclient is never freed
+TEST_CASE(mqttConnectionStates) {
+  static MQTTclient mqtt;
+  PubSubClient &broker = mqtt.client;
+  hostMillis = 1000000;
+  hostRandom = NULL;
+  WiFi.hostStatus = WL_CONNECTED;
+
+  enableMqtt = false;
+  mqtt.prepare("192.168.1.2", 0, "ogo", "", "");
+  step(mqtt);
+  CHECK_EQUAL(MQTT_STATE_DISABLED, mqtt.getState());
+  CHECK_EQUAL(0, broker.connects);
+
+  // The settings are applied by the state machine, the broker waits for the WiFi
+  enableMqtt = true;
+  WiFi.hostStatus = WL_DISCONNECTED;
+  mqtt.connect();
+  step(mqtt);
+  CHECK_EQUAL(MQTT_STATE_WAITING, mqtt.getState());
+  CHECK_EQUAL(0, broker.connects);
+  CHECK_EQUAL(1883, broker.port);
+  CHECK_EQUAL(2, broker.ip.bytes[3]);
+
+  WiFi.hostStatus = WL_CONNECTED;
+  broker.connectResult = true;
+  broker.connectMillis = 120;
+  step(mqtt);
+  CHECK_EQUAL(MQTT_STATE_CONNECTED, mqtt.getState());
+  CHECK(mqtt.isReady());
+  CHECK_EQUAL(1, mqtt.getConnectAttempts());
+  CHECK_EQUAL(0, mqtt.getConnectFailures());
+  CHECK_EQUAL(120, mqtt.getLastLatency());
+
+  // A lost connection is retried after the shortest backoff, without jitter
+  broker.loopResult = false;
+  step(mqtt);
+  CHECK_EQUAL(MQTT_STATE_WAITING, mqtt.getState());
+  broker.loopResult = true;
+  hostMillis += MQTT_BACKOFF_MIN_MS - 1;
+  step(mqtt);
+  CHECK_EQUAL(1, broker.connects);
+  hostMillis += 1;
+  step(mqtt);
+  CHECK_EQUAL(2, broker.connects);
+  CHECK_EQUAL(MQTT_STATE_CONNECTED, mqtt.getState());
+
+  // The WiFi drops while connected
+  WiFi.hostStatus = WL_CONNECTION_LOST;
+  step(mqtt);
+  CHECK_EQUAL(MQTT_STATE_WAITING, mqtt.getState());
+  WiFi.hostStatus = WL_CONNECTED;
+
+  // Stays disconnected until the next connect()
+  mqtt.disconnect();
+  step(mqtt);
+  CHECK_EQUAL(MQTT_STATE_DISABLED, mqtt.getState());
+  CHECK_EQUAL(1, broker.disconnects);
+  hostMillis += MQTT_BACKOFF_MAX_MS * 2;
+  step(mqtt);
+  CHECK_EQUAL(MQTT_STATE_DISABLED, mqtt.getState());
+  CHECK_EQUAL(2, broker.connects);
+
+  mqtt.connect();
+  step(mqtt);
+  CHECK_EQUAL(MQTT_STATE_CONNECTED, mqtt.getState());
+  CHECK_EQUAL(3, broker.connects);
+
+  // Disabled in the settings
+  enableMqtt = false;
+  step(mqtt);
+  CHECK_EQUAL(MQTT_STATE_DISABLED, mqtt.getState());
+}
+
+static uint32_t fixedRandom = 0;
+static uint32_t fixedRandomSource() { return fixedRandom; }
+
+// Failed attempts double the delay from 1 s up to 5 min, each with +-25% jitter.
+// Once with the lowest, once with the highest and once with random jitter.
+TEST_CASE(mqttBackoffWithJitter) {
+  enum { JITTER_LOWEST, JITTER_HIGHEST, JITTER_RANDOM };
+  static MQTTclient clients[3];
+  for (uint8_t mode : { JITTER_LOWEST, JITTER_HIGHEST, JITTER_RANDOM }) {
+    MQTTclient &mqtt = clients[mode];
+    PubSubClient &broker = mqtt.client;
+    hostMillis = 5000000;
+    hostRandom = mode == JITTER_RANDOM ? NULL : fixedRandomSource;
+    WiFi.hostStatus = WL_CONNECTED;
+    enableMqtt = true;
+    mqtt.prepare("broker.local", 1884, "ogo", "user", "secret");
+
+    // connect() asks for an attempt right away, every failure waits longer
+    uint32_t previous = 0;
+    for (uint32_t attempt = 1; attempt <= 20; attempt++) {
+      uint32_t backoff = constrain(previous * 2, (uint32_t)MQTT_BACKOFF_MIN_MS, (uint32_t)MQTT_BACKOFF_MAX_MS);
+      fixedRandom = mode == JITTER_HIGHEST ? backoff / 2 : 0;
+      if (attempt > 1) {
+        // Due exactly after the delay and not a millisecond earlier
+        hostMillis += previous - 1;
+        step(mqtt);
+        CHECK_EQUAL(attempt - 1, broker.connects);
+        hostMillis += 1;
+      }
+      mqtt.handle();
+      if (!CHECK_EQUAL(attempt, broker.connects)) break;
+      uint32_t delay = announcedDelay();
+      uint32_t lowest = backoff - backoff / 4;
+      if (mode == JITTER_LOWEST) CHECK_EQUAL(lowest, delay);
+      if (mode == JITTER_HIGHEST) CHECK_EQUAL(lowest + backoff / 2, delay);
+      if (!CHECK(delay >= lowest && delay <= lowest + backoff / 2)) break;
+      previous = delay;
+    }
+    CHECK_EQUAL(MQTT_STATE_WAITING, mqtt.getState());
+    CHECK_EQUAL(20, mqtt.getConnectFailures());
+    // The cap was reached
+    CHECK(previous >= MQTT_BACKOFF_MAX_MS - MQTT_BACKOFF_MAX_MS / 4);
+    CHECK(previous <= MQTT_BACKOFF_MAX_MS + MQTT_BACKOFF_MAX_MS / 4);
+    CHECK(broker.host == "broker.local");
+    CHECK_EQUAL(1884, broker.port);
+  }
+  hostRandom = NULL;
+}
+
+TEST_CASE(mqttLatencyHistogram) {
+  static MQTTclient mqtt;
+  PubSubClient &broker = mqtt.client;
+  hostMillis = 9000000;
+  WiFi.hostStatus = WL_CONNECTED;
+  enableMqtt = true;
+  mqtt.prepare("10.0.0.1", 1883, "ogo", "", "");
+
+  // Two attempts per bucket, at both ends of it. The limits are 50, 100, 250, 500, 1000, 2500 and 5000 ms.
+  const uint32_t latencies[] = { 0, 49, 50, 99, 100, 249, 250, 499, 500, 999, 1000, 2499, 2500, 4999, 5000, 60000 };
+  for (uint32_t ms : latencies) {
+    broker.connectMillis = ms;
+    mqtt.connect();
+    step(mqtt);
+  }
+  for (uint8_t bucket = 0; bucket < MQTT_LATENCY_BUCKETS; bucket++) CHECK_EQUAL(2, mqtt.getLatencyHistogram(bucket));
+  CHECK_EQUAL(0, mqtt.getLatencyHistogram(MQTT_LATENCY_BUCKETS));
+  CHECK_EQUAL(16, mqtt.getConnectAttempts());
+  CHECK_EQUAL(16, mqtt.getConnectFailures());
+  CHECK_EQUAL(60000, mqtt.getLastLatency());
+
+  // A success is counted in the histogram as well
+  broker.connectResult = true;
+  broker.connectMillis = 75;
+  mqtt.connect();
+  step(mqtt);
+  CHECK_EQUAL(3, mqtt.getLatencyHistogram(1));
+  CHECK_EQUAL(16, mqtt.getConnectFailures());
+  CHECK_EQUAL(MQTT_STATE_CONNECTED, mqtt.getState());
+}
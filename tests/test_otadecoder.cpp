@@ -0,0 +1,195 @@
+/**
+ * @file test_otadecoder.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Round trip of images built by tools/ota-compress.py through the streaming decoder
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <initializer_list>
+#include <string>
+#include <vector>
+#include "otadecoder.h"
+#include "test.h"
+
+typedef std::vector<uint8_t> bytes_t;
+
+// The tool is run from the repository, found relative to this file
+static std::string repositoryPath(const char *path) {
+  std::string file = __FILE__;
+  size_t tests = file.rfind("tests/");
+  return (tests == std::string::npos ? std::string("") : file.substr(0, tests)) + path;
+}
+
+static bool writeFile(const std::string &path, const bytes_t &data) {
+  FILE *file = fopen(path.c_str(), "wb");
+  if (!file) return false;
+  bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+  return fclose(file) == 0 && written;
+}
+
+static bytes_t readFile(const std::string &path) {
+  bytes_t data;
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file) return data;
+  uint8_t buffer[4096];
+  size_t len;
+  while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0) data.insert(data.end(), buffer, buffer + len);
+  fclose(file);
+  return data;
+}
+
+// Runs "tools/ota-compress.py <command> <files...>" with the files in the work folder
+static bool compressTool(const std::string &folder, const char *command, std::initializer_list<const char *> files, const char *options = "") {
+  std::string line = "python3 '" + repositoryPath("tools/ota-compress.py") + "' " + command;
+  for (const char *file : files) line += " '" + folder + "/" + file + "'";
+  line += std::string(" ") + options + " > /dev/null";
+  return system(line.c_str()) == 0;
+}
+
+// An app image of repeating instruction words with a few literals, compresses like a firmware
+static bytes_t firmware(uint32_t seed, size_t size) {
+  bytes_t image = { 0xE9, 0x06, 0x02, 0x20 };
+  uint32_t words[48];
+  for (uint32_t &word : words) word = seed = seed * 1103515245 + 12345;
+  while (image.size() < size) {
+    seed = seed * 1103515245 + 12345;
+    uint32_t word = seed >> 28 ? words[(seed >> 8) % 48] : seed;
+    for (uint8_t i = 0; i < 4; i++) image.push_back(word >> (8 * i));
+  }
+  image.resize(size);
+  return image;
+}
+
+struct decodejob_t {
+  const bytes_t *source;
+  bytes_t output;
+};
+
+static bool sink(void *context, const uint8_t *data, size_t len) {
+  decodejob_t *job = (decodejob_t *)context;
+  job->output.insert(job->output.end(), data, data + len);
+  return true;
+}
+
+static bool source(void *context, uint32_t offset, uint8_t *data, size_t len) {
+  decodejob_t *job = (decodejob_t *)context;
+  if (!job->source || offset + len > job->source->size()) return false;
+  memcpy(data, job->source->data() + offset, len);
+  return true;
+}
+
+// Feeds the image in chunks of the given size, as the network delivers it
+static bool decode(OtaDecoder &decoder, decodejob_t &job, const bytes_t &image, size_t chunk) {
+  decoder.begin(sink, job.source ? source : NULL, &job);
+  for (size_t offset = 0; offset < image.size(); offset += chunk) {
+    if (!decoder.feed(image.data() + offset, std::min(chunk, image.size() - offset))) return false;
+  }
+  return decoder.finish();
+}
+
+struct otafixture_t {
+  std::string folder;
+  bytes_t source, target, gzip, delta, gzipDelta;
+  bool ready = false;
+
+  otafixture_t() {
+    char path[] = "/tmp/otadecoderXXXXXX";
+    if (!mkdtemp(path)) return;
+    folder = path;
+
+    // The new firmware: changed constants, new code in the middle and removed code later on
+    source = firmware(0x5EED, 48 * 1024);
+    target = source;
+    for (size_t i = 4096; i < target.size(); i += 997) target[i] += 3;
+    bytes_t inserted = firmware(0xC0DE, 700);
+    target.insert(target.begin() + 20000, inserted.begin() + 4, inserted.end());
+    target.erase(target.begin() + 35000, target.begin() + 35500);
+
+    ready = writeFile(folder + "/old.bin", source) && writeFile(folder + "/new.bin", target)
+      && compressTool(folder, "gzip", { "new.bin", "new.bin.gz" })
+      && compressTool(folder, "delta", { "old.bin", "new.bin", "new.delta" }, "--raw")
+      && compressTool(folder, "delta", { "old.bin", "new.bin", "new.delta.gz" });
+    gzip = readFile(folder + "/new.bin.gz");
+    delta = readFile(folder + "/new.delta");
+    gzipDelta = readFile(folder + "/new.delta.gz");
+  }
+  ~otafixture_t() {
+    for (const char *file : { "old.bin", "new.bin", "new.bin.gz", "new.delta", "new.delta.gz" }) {
+      unlink((folder + "/" + file).c_str());
+    }
+    if (!folder.empty()) rmdir(folder.c_str());
+  }
+};
+
+TEST_CASE(otaDecoderRoundTrip) {
+  otafixture_t fixture;
+  if (!CHECK(fixture.ready)) return;
+  // The delta has to be worth it, otherwise the tool or the test data is broken
+  CHECK(fixture.gzipDelta.size() < fixture.gzip.size() / 4);
+
+  struct { const bytes_t *image; ota_format_t format; } images[] = {
+    { &fixture.target, OTA_FORMAT_PLAIN },
+    { &fixture.gzip, OTA_FORMAT_GZIP },
+    { &fixture.delta, OTA_FORMAT_DELTA },
+    { &fixture.gzipDelta, OTA_FORMAT_GZIP_DELTA },
+  };
+  for (auto &image : images) {
+    for (size_t chunk : { (size_t)1, (size_t)7, (size_t)1436, (size_t)8192, image.image->size() }) {
+      OtaDecoder decoder;
+      decodejob_t job = { &fixture.source, {} };
+      if (!CHECK(decode(decoder, job, *image.image, chunk))) {
+        printf("  format %u in chunks of %zu: %s\n", image.format, chunk, decoder.getError());
+        continue;
+      }
+      CHECK_EQUAL(image.format, decoder.getFormat());
+      CHECK_EQUAL(fixture.target.size(), decoder.getOutputBytes());
+      CHECK(job.output == fixture.target);
+    }
+  }
+}
+
+TEST_CASE(otaDecoderRejectsBrokenImages) {
+  otafixture_t fixture;
+  if (!CHECK(fixture.ready)) return;
+  OtaDecoder decoder;
+
+  // CRC of the gzip trailer
+  bytes_t image = fixture.gzip;
+  image[image.size() - 8] ^= 0x01;
+  decodejob_t job = { NULL, {} };
+  CHECK(!decode(decoder, job, image, 1436));
+  CHECK_STRING("gzip CRC or size mismatch", decoder.getError());
+
+  // Truncated stream
+  image.assign(fixture.gzip.begin(), fixture.gzip.end() - 100);
+  job = { NULL, {} };
+  CHECK(!decode(decoder, job, image, 1436));
+  CHECK_STRING("Incomplete gzip stream", decoder.getError());
+
+  // The delta only applies to the exact running firmware, nothing is written otherwise
+  bytes_t other = fixture.source;
+  other[100] ^= 0xFF;
+  job = { &other, {} };
+  CHECK(!decode(decoder, job, fixture.gzipDelta, 1436));
+  CHECK_STRING("Delta does not match the running firmware", decoder.getError());
+  CHECK_EQUAL(0, job.output.size());
+
+  job = { NULL, {} };
+  CHECK(!decode(decoder, job, fixture.delta, 1436));
+  CHECK_STRING("No source for a delta update", decoder.getError());
+
+  // A changed literal passes the operations but not the SHA-256 of the target
+  image = fixture.delta;
+  image[image.size() - 1] ^= 0x01;
+  job = { &fixture.source, {} };
+  CHECK(!decode(decoder, job, image, 1436));
+  CHECK_STRING("Delta result does not match the target", decoder.getError());
+}
@@ -0,0 +1,145 @@
+/**
+ * @file test_scheduler.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Deadline scheduler with a virtual clock: order, idle time, late runs and clock resets
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <string>
+#include <vector>
+#include "scheduler.h"
+#include "test.h"
+
+// The virtual clock, jobs move the microseconds to take time
+static uint64_t virtualMs = 0;
+static uint64_t virtualUs = 0;
+static uint64_t clockMs() { return virtualMs; }
+static uint64_t clockUs() { return virtualMs * 1000 + virtualUs; }
+
+static std::vector<std::string> trace;
+static void record(const char *name) { trace.push_back(std::to_string(virtualMs) + ":" + name); }
+static void jobA() { record("A"); }
+static void jobB() { record("B"); }
+static void jobC() { virtualUs += 700; record("C"); }
+
+TEST_CASE(schedulerDeadlineOrder) {
+  SchedulerClass scheduler;
+  scheduler.begin(clockMs, clockUs);
+  uint64_t lastA = 0, lastB = 0, lastC = 0;
+  virtualMs = 0;
+  virtualUs = 0;
+  trace.clear();
+  // Added in a different order than the priorities
+  CHECK(scheduler.add("A", 100, 1, jobA, &lastA));
+  CHECK(scheduler.add("B", 30, 2, jobB, &lastB));
+  CHECK(scheduler.add("C", 100, 3, jobC, &lastC));
+  CHECK_STRING("C", scheduler.getJob(0).name);
+  CHECK_STRING("A", scheduler.getJob(2).name);
+
+  // Wakes up exactly at the deadlines the scheduler asks for
+  while (virtualMs < 200) virtualMs += scheduler.runDue();
+  std::vector<std::string> expected = {
+    "30:B", "60:B", "90:B", "100:C", "100:A", "120:B", "150:B", "180:B", "200:C", "200:A"
+  };
+  scheduler.runDue();
+  CHECK(trace == expected);
+  for (size_t i = 0; i < trace.size() && i < expected.size(); i++) {
+    if (trace[i] != expected[i]) printf("  run %zu: %s instead of %s\n", i, trace[i].c_str(), expected[i].c_str());
+  }
+  CHECK_EQUAL(2, scheduler.getJob(0).runs);
+  CHECK_EQUAL(700, scheduler.getJob(0).worstUs);
+  CHECK_EQUAL(700, scheduler.getAverageUs(0));
+  CHECK_EQUAL(0, scheduler.getJob(0).maxLateMs);
+
+  // Invalid jobs and more jobs than slots
+  CHECK(!scheduler.add("D", 0, 1, jobA, &lastA));
+  CHECK(!scheduler.add("D", 10, 1, NULL, &lastA));
+  CHECK(!scheduler.add("D", 10, 1, jobA, NULL));
+  uint64_t more[SCHEDULER_MAX_JOBS];
+  uint8_t added = 0;
+  for (uint64_t &last : more) added += scheduler.add("E", 1000, 0, jobA, &last);
+  CHECK_EQUAL(SCHEDULER_MAX_JOBS - 3, added);
+}
+
+TEST_CASE(schedulerUntilNextDeadline) {
+  SchedulerClass scheduler;
+  scheduler.begin(clockMs, clockUs);
+  virtualMs = 10000;
+  // Without jobs, and with deadlines further away than the cap
+  CHECK_EQUAL(SCHEDULER_MAX_IDLE_MS, scheduler.untilNextDeadline());
+  uint64_t slowLast = virtualMs;
+  scheduler.add("slow", 5000, 1, jobA, &slowLast);
+  CHECK_EQUAL(SCHEDULER_MAX_IDLE_MS, scheduler.untilNextDeadline());
+
+  uint64_t fastLast = virtualMs;
+  scheduler.add("fast", 300, 1, jobB, &fastLast);
+  CHECK_EQUAL(300, scheduler.untilNextDeadline());
+  virtualMs += 100;
+  CHECK_EQUAL(200, scheduler.untilNextDeadline());
+  virtualMs += 200;
+  CHECK_EQUAL(0, scheduler.untilNextDeadline());
+  virtualMs += 50;
+  CHECK_EQUAL(0, scheduler.untilNextDeadline());
+
+  // The run moves the deadline, the idle time is returned by runDue() as well
+  CHECK_EQUAL(250, scheduler.runDue());
+  CHECK_EQUAL(250, scheduler.untilNextDeadline());
+
+  CHECK(scheduler.setPeriod("fast", 100));
+  CHECK_EQUAL(50, scheduler.untilNextDeadline());
+  CHECK(!scheduler.setPeriod("fast", 0));
+  CHECK(!scheduler.setPeriod("missing", 100));
+}
+
+TEST_CASE(schedulerCatchUpOrResync) {
+  SchedulerClass scheduler;
+  scheduler.begin(clockMs, clockUs);
+  virtualMs = 0;
+  virtualUs = 0;
+  trace.clear();
+  uint64_t last = 0;
+  scheduler.add("A", 100, 1, jobA, &last);
+
+  // Late by less than a period, the next deadline stays on the grid
+  virtualMs = 150;
+  CHECK_EQUAL(50, scheduler.runDue());
+  CHECK_EQUAL(100, last);
+  CHECK_EQUAL(50, scheduler.getJob(0).maxLateMs);
+
+  // Late by exactly a period or more, e.g. after a blocking call, no burst of runs
+  virtualMs = 300;
+  CHECK_EQUAL(100, scheduler.runDue());
+  CHECK_EQUAL(300, last);
+  virtualMs = 950;
+  CHECK_EQUAL(100, scheduler.runDue());
+  CHECK_EQUAL(950, last);
+  CHECK_EQUAL(3, scheduler.getJob(0).runs);
+  CHECK_EQUAL(3, trace.size());
+  // Resyncs are not counted as late runs
+  CHECK_EQUAL(50, scheduler.getJob(0).maxLateMs);
+}
+
+TEST_CASE(schedulerClockReset) {
+  SchedulerClass scheduler;
+  scheduler.begin(clockMs, clockUs);
+  trace.clear();
+  // The deadline state survived in RTC memory, the clock started over
+  uint64_t last = 5000000;
+  scheduler.add("A", 100, 1, jobA, &last);
+  virtualMs = 500;
+  CHECK_EQUAL(100, scheduler.runDue());
+  CHECK_EQUAL(500, last);
+  CHECK_EQUAL(0, trace.size());
+
+  virtualMs = 600;
+  scheduler.runDue();
+  CHECK_EQUAL(1, trace.size());
+  CHECK_EQUAL(600, last);
+  CHECK_EQUAL(2, scheduler.getWakeups());
+}
@@ -0,0 +1,183 @@
+/**
+ * @file test_sensors.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief SHT3x and BME280 drivers against a fake I2C bus, aggregation of the samples
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <math.h>
+#include <vector>
+#include "bme280.h"
+#include "climatesensor.h"
+#include "sht3x.h"
+#include "test.h"
+
+// One device on the bus. Reads return the fixed response if there is one (SHT3x),
+// otherwise the registers from the last written register address on (BME280).
+class FakeI2CBus : public I2CBus {
+    public:
+        uint8_t address;
+        uint8_t registers[256] = {};
+        std::vector<uint8_t> response;
+        std::vector<std::vector<uint8_t>> writes;
+        bool present = true;
+
+        FakeI2CBus(uint8_t address) : address(address) {}
+
+        bool write(uint8_t address, const uint8_t *data, size_t length) {
+            if (!present || address != this->address) return false;
+            writes.push_back(std::vector<uint8_t>(data, data + length));
+            if (length) pointer = data[0];
+            return true;
+        }
+        bool read(uint8_t address, uint8_t *data, size_t length) {
+            if (!present || address != this->address) return false;
+            if (!response.empty()) {
+                if (length > response.size()) return false;
+                memcpy(data, response.data(), length);
+            } else {
+                for (size_t i = 0; i < length; i++) data[i] = registers[(uint8_t)(pointer + i)];
+            }
+            return true;
+        }
+        bool wrote(std::vector<uint8_t> data) {
+            for (const std::vector<uint8_t> &write : writes) if (write == data) return true;
+            return false;
+        }
+
+    private:
+        uint8_t pointer = 0;
+};
+
+static bool near(float expected, float actual, float tolerance = 0.01f) {
+  return fabsf(expected - actual) < tolerance;
+}
+
+TEST_CASE(sht3xCrc) {
+  // Example of the datasheet
+  const uint8_t word[2] = { 0xBE, 0xEF };
+  CHECK_EQUAL(0x92, Sht3xSensor::crc8(word, 2));
+}
+
+TEST_CASE(sht3xMeasurement) {
+  FakeI2CBus bus(SHT3X_ADDRESS);
+  Sht3xSensor sensor(bus);
+  CHECK(sensor.begin());
+  CHECK(bus.wrote({ 0x30, 0xA2 }));
+  CHECK(sensor.trigger());
+  CHECK(bus.wrote({ 0x24, 0x00 }));
+
+  // 0x6666 is 25.0 °C, 0x8000 is 50.0 %
+  uint8_t t[2] = { 0x66, 0x66 }, h[2] = { 0x80, 0x00 };
+  bus.response = { t[0], t[1], Sht3xSensor::crc8(t, 2), h[0], h[1], Sht3xSensor::crc8(h, 2) };
+  float temperature = 0, humidity = 0;
+  CHECK(sensor.collect(temperature, humidity));
+  CHECK(near(25.0f, temperature));
+  CHECK(near(50.0f, humidity));
+
+  // A corrupted transfer is rejected and leaves the values alone
+  bus.response[4] ^= 0x01;
+  temperature = humidity = -1;
+  CHECK(!sensor.collect(temperature, humidity));
+  CHECK_EQUAL(-1, temperature);
+
+  // Without an acknowledge
+  bus.present = false;
+  CHECK(!sensor.trigger());
+  CHECK(!sensor.collect(temperature, humidity));
+}
+
+// Calibration of the temperature example in the datasheet and of a typical chip for the humidity
+static void setupBme280(FakeI2CBus &bus) {
+  const uint16_t t1 = 27504;
+  const int16_t t2 = 26435, t3 = -1000;
+  const uint8_t h1 = 75, h3 = 0;
+  const int16_t h2 = 362, h4 = 313, h5 = 50;
+  const int8_t h6 = 30;
+
+  bus.registers[0xD0] = BME280_CHIP_ID;
+  uint8_t *t = bus.registers + 0x88;
+  t[0] = t1 & 0xFF; t[1] = t1 >> 8;
+  t[2] = t2 & 0xFF; t[3] = (uint16_t)t2 >> 8;
+  t[4] = t3 & 0xFF; t[5] = (uint16_t)t3 >> 8;
+  t[25] = h1;
+  uint8_t *h = bus.registers + 0xE1;
+  h[0] = h2 & 0xFF; h[1] = h2 >> 8;
+  h[2] = h3;
+  h[3] = h4 >> 4;
+  h[4] = (h4 & 0x0F) | ((h5 & 0x0F) << 4);
+  h[5] = h5 >> 4;
+  h[6] = h6;
+
+  // adc_T 519888 as in the datasheet, adc_H 30000
+  const int32_t adcT = 519888, adcH = 30000;
+  uint8_t *data = bus.registers + 0xFA;
+  data[0] = adcT >> 12; data[1] = (adcT >> 4) & 0xFF; data[2] = (adcT & 0x0F) << 4;
+  data[3] = adcH >> 8; data[4] = adcH & 0xFF;
+}
+
+TEST_CASE(bme280Measurement) {
+  FakeI2CBus bus(BME280_ADDRESS);
+  setupBme280(bus);
+  Bme280Sensor sensor(bus);
+  CHECK(sensor.begin());
+  CHECK(bus.wrote({ 0xF2, 0x01 }));
+  CHECK(sensor.trigger());
+  CHECK(bus.wrote({ 0xF4, 0x25 }));
+
+  float temperature = 0, humidity = 0;
+  CHECK(sensor.collect(temperature, humidity));
+  CHECK(near(25.08f, temperature));
+  // 55.0007 % with the floating point compensation of the datasheet
+  CHECK(near(55.0f, humidity, 0.01f));
+
+  // The humidity channel was skipped
+  bus.registers[0xFD] = 0x80;
+  bus.registers[0xFE] = 0x00;
+  CHECK(!sensor.collect(temperature, humidity));
+}
+
+TEST_CASE(bme280RejectsOtherChips) {
+  FakeI2CBus bus(BME280_ADDRESS);
+  setupBme280(bus);
+  bus.registers[0xD0] = 0x58;     // BMP280, no humidity
+  Bme280Sensor sensor(bus);
+  CHECK(!sensor.begin());
+
+  FakeI2CBus empty(0x10);
+  Bme280Sensor missing(empty);
+  CHECK(!missing.begin());
+}
+
+TEST_CASE(climateAggregateModes) {
+  climatesample_t samples[3];
+  samples[0] = { 20, 60, 1000, SENSOR_QUALITY_GOOD };
+  samples[1] = { 22, 50, 1000, SENSOR_QUALITY_GOOD };
+  samples[2] = { 30, 90, 1000, SENSOR_QUALITY_ERROR };
+  float temperature = 0, humidity = 0;
+
+  CHECK(climateAggregate(samples, 3, SENSOR_AGGREGATE_MEAN, 2000, temperature, humidity));
+  CHECK(near(21, temperature));
+  CHECK(near(55, humidity));
+  CHECK(climateAggregate(samples, 3, SENSOR_AGGREGATE_MINIMUM, 2000, temperature, humidity));
+  CHECK(near(20, temperature));
+  CHECK(near(50, humidity));
+  CHECK(climateAggregate(samples, 3, SENSOR_AGGREGATE_MAXIMUM, 2000, temperature, humidity));
+  CHECK(near(22, temperature));
+  CHECK(near(60, humidity));
+
+  // Stale samples are not used, without a usable one the values are kept
+  samples[1].timestamp = 2000;
+  CHECK(climateAggregate(samples, 3, SENSOR_AGGREGATE_MEAN, 1000 + SENSOR_MAX_AGE_MS + 1, temperature, humidity));
+  CHECK(near(22, temperature));
+  temperature = -1;
+  CHECK(!climateAggregate(samples, 3, SENSOR_AGGREGATE_MEAN, 2000 + SENSOR_MAX_AGE_MS + 1, temperature, humidity));
+  CHECK_EQUAL(-1, temperature);
+  CHECK(!climateAggregate(samples, 0, SENSOR_AGGREGATE_MEAN, 0, temperature, humidity));
+}
@@ -0,0 +1,160 @@
+/**
+ * @file test_telemetry.cpp
+ * @author Martin Verges <martin@verges.cc>
+ * @brief Telemetry against the AsyncWebSocket stand-in, clients come and go while tick() runs
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022 by the author alone
+ *            https://gitlab.womolin.de/martin.verges/ogo-ttt-fan-upgrade
+ *
+ * License: CC BY-NC-SA 4.0
+ */
+
+#include <atomic>
+#include <thread>
+#include "telemetry.h"
+#include "test.h"
+
+static status_t snapshot() {
+  status_t status = {};
+  status.stateFanRpm = 1234;
+  status.statePwmSpeed = 42;
+  status.stateTemperature = 21.5f;
+  status.stateHumidity = 63.0f;
+  return status;
+}
+
+// The instances are static, the lock of a TelemetryClass is never freed
+TEST_CASE(telemetryEncodesOncePerFieldSet) {
+  static TelemetryClass telemetry("/api/ws");
+  telemetry.begin();
+  hostMillis = 100000;
+  AsyncWebSocketClient *a = new AsyncWebSocketClient(&telemetry.getSocket(), 1);
+  AsyncWebSocketClient *b = new AsyncWebSocketClient(&telemetry.getSocket(), 2);
+  CHECK_EQUAL(2, telemetry.getClientCount());
+
+  status_t status = snapshot();
+  char json[STATUS_JSON_SIZE];
+  size_t length = StatusSerializer::serializeFields(status, STATUS_ALL_FIELDS, json, sizeof(json));
+  telemetry.tick(status);
+  std::vector<std::string> frames = a->take();
+  CHECK_EQUAL(1, frames.size());
+  CHECK(frames.size() == 1 && frames[0] == std::string(json, length));
+  CHECK_EQUAL(1, b->take().size());
+  telemetrystats_t stats = telemetry.getStats();
+  CHECK_EQUAL(1, stats.frames);
+  CHECK_EQUAL(2, stats.messages);
+
+  // Nothing is due before the interval is over
+  hostMillis += TELEMETRY_TICK_MS;
+  telemetry.tick(status);
+  CHECK_EQUAL(0, a->take().size());
+
+  // Low heap postpones the update without counting against the clients
+  ESP.maxAllocHeap = TELEMETRY_MIN_HEAP - 1;
+  hostMillis += TELEMETRY_DEFAULT_INTERVAL_MS;
+  telemetry.tick(status);
+  ESP.maxAllocHeap = 110000;
+  CHECK_EQUAL(0, a->take().size());
+  CHECK_EQUAL(2, telemetry.getStats().starved);
+  hostMillis += TELEMETRY_TICK_MS;
+  telemetry.tick(status);
+  CHECK_EQUAL(1, a->take().size());
+
+  delete a;
+  delete b;
+  CHECK_EQUAL(0, telemetry.getClientCount());
+}
+
+TEST_CASE(telemetryRejectsAndDropsClients) {
+  static TelemetryClass telemetry("/api/ws");
+  telemetry.begin();
+  hostMillis = 200000;
+  AsyncWebSocketClient *clients[TELEMETRY_MAX_CLIENTS + 1];
+  for (uint8_t i = 0; i <= TELEMETRY_MAX_CLIENTS; i++) clients[i] = new AsyncWebSocketClient(&telemetry.getSocket(), 10 + i);
+  CHECK_EQUAL(TELEMETRY_MAX_CLIENTS, telemetry.getClientCount());
+  CHECK_EQUAL(1, telemetry.getStats().rejected);
+  CHECK_EQUAL(1013, clients[TELEMETRY_MAX_CLIENTS]->getCloseCode());
+
+  // Only the first client never drains its queue
+  status_t status = snapshot();
+  for (uint32_t i = 0; i < WS_MAX_QUEUED_MESSAGES + TELEMETRY_SLOW_TICKS; i++) {
+    telemetry.tick(status);
+    for (uint8_t j = 1; j < TELEMETRY_MAX_CLIENTS; j++) clients[j]->take();
+    hostMillis += TELEMETRY_DEFAULT_INTERVAL_MS;
+  }
+  telemetrystats_t stats = telemetry.getStats();
+  CHECK_EQUAL(1008, clients[0]->getCloseCode());
+  CHECK_EQUAL(0, clients[1]->getCloseCode());
+  CHECK_EQUAL(TELEMETRY_SLOW_TICKS, stats.skipped);
+  CHECK_EQUAL(1, stats.dropped);
+
+  for (AsyncWebSocketClient *client : clients) delete client;
+  CHECK_EQUAL(0, telemetry.getClientCount());
+}
+
+// xorshift32, the runs are reproducible apart from the thread timing
+static uint32_t churnState = 0x6C8E9CF5;
+static uint32_t churnRandom(uint32_t range) {
+  churnState ^= churnState << 13;
+  churnState ^= churnState >> 17;
+  churnState ^= churnState << 5;
+  return churnState % range;
+}
+
+// This thread plays the async_tcp task and frees clients while another one sends to them.
+// A client used after its disconnect event shows up under ASan.
+TEST_CASE(telemetryClientsDisconnectDuringTick) {
+  static TelemetryClass telemetry("/api/ws");
+  telemetry.begin();
+  hostMillis = 300000;
+  std::atomic<bool> running(true);
+  std::atomic<uint32_t> ticks(0);
+  status_t status = snapshot();
+
+  // Every client is due on each tick
+  std::thread scheduler([&]() {
+    while (running) {
+      telemetry.tick(status);
+      hostMillis = hostMillis + TELEMETRY_DEFAULT_INTERVAL_MS;
+      ticks++;
+    }
+  });
+
+  AsyncWebSocketClient *clients[TELEMETRY_MAX_CLIENTS + 2] = {};
+  const uint8_t slots = sizeof(clients) / sizeof(clients[0]);
+  uint32_t id = 1000, received = 0;
+  for (uint32_t round = 0; round < 20000; round++) {
+    AsyncWebSocketClient *&client = clients[churnRandom(slots)];
+    switch (churnRandom(4)) {
+      case 0:
+        if (client) break;
+        client = new AsyncWebSocketClient(&telemetry.getSocket(), ++id);
+        break;
+      case 1:
+        if (!client) break;
+        received += client->take().size();
+        if (churnRandom(2)) client->close(1000);
+        delete client;
+        client = NULL;
+        break;
+      default:
+        if (client) received += client->take().size();
+        break;
+    }
+    if (round % 64 == 0) std::this_thread::yield();
+  }
+  running = false;
+  scheduler.join();
+
+  for (AsyncWebSocketClient *client : clients) {
+    if (client) received += client->take().size();
+    delete client;
+  }
+  CHECK_EQUAL(0, telemetry.getClientCount());
+  CHECK(ticks > 0);
+  CHECK(received > 0);
+  // Frames still queued when a client went away are lost, never more arrive than were sent
+  CHECK(received <= telemetry.getStats().messages);
+}
@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+
+# Build and verify the UI bundle for the "assets" partition. The firmware
+# maps the partition and serves the files straight from flash, the layout
+# must match src/assetbundle.h. Compressible files are stored as gzip if
+# that saves at least 10%, files that are already gzip compressed (".gz")
+# are taken as they are.
+#
+#   tools/assetbundle.py build ui/build .pio/assets.bin
+#   tools/assetbundle.py verify .pio/assets.bin --source ui/build
+#   tools/assetbundle.py partition assets        (offset and size from partitions.csv)
+
+import argparse
+import gzip
+import hashlib
+import os
+import struct
+import sys
+import zlib
+
+MAGIC = 0x4241474F
+VERSION = 1
+FLAG_GZIP = 0x01
+HEADER = struct.Struct('<IHHII')
+ENTRY = struct.Struct('<IHBBII20s')
+COMPRESSIBLE = ('.html', '.js', '.css', '.json', '.svg', '.txt', '.map', '.ico', '.xml', '.webmanifest')
+SKIP = ('/assets.manifest',)
+PARTITIONS = os.path.normpath(os.path.dirname(__file__) + '/../partitions.csv')
+
+def align(value, boundary=4):
+  return (value + boundary - 1) & ~(boundary - 1)
+
+def etag(data):
+  return hashlib.sha256(data).hexdigest()[:16]
+
+def collect(source):
+  files = {}
+  for root, dirs, names in os.walk(source):
+    for name in names:
+      file = os.path.join(root, name)
+      path = '/' + os.path.relpath(file, source).replace(os.sep, '/')
+      if path in SKIP:
+        continue
+      with open(file, 'rb') as f:
+        data = f.read()
+      gz = path.endswith('.gz')
+      if gz:
+        path = path[:-3]
+      elif name.endswith(COMPRESSIBLE):
+        # mtime=0 keeps the output and the ETag stable between builds
+        packed = gzip.compress(data, compresslevel=9, mtime=0)
+        if len(packed) < len(data) * 0.9:
+          data, gz = packed, True
+      files[path] = (data, gz)
+  return files
+
+def build(source):
+  files = collect(source)
+  paths = sorted(files, key=lambda p: p.encode())
+  offset = HEADER.size + ENTRY.size * len(paths)
+
+  names = bytearray()
+  pathOffsets = []
+  for path in paths:
+    pathOffsets.append(offset + len(names))
+    names += path.encode() + b'\0'
+  offset = align(offset + len(names))
+
+  entries = bytearray()
+  data = bytearray()
+  for path, pathOffset in zip(paths, pathOffsets):
+    content, gz = files[path]
+    entries += ENTRY.pack(pathOffset, len(path.encode()), FLAG_GZIP if gz else 0, 0,
+                          offset + len(data), len(content), etag(content).encode())
+    data += content + b'\0' * (align(len(content)) - len(content))
+
+  body = bytes(entries + names + b'\0' * (align(len(names)) - len(names)) + data)
+  size = HEADER.size + len(body)
+  return HEADER.pack(MAGIC, VERSION, len(paths), size, zlib.crc32(body)) + body
+
+def parse(bundle):
+  magic, version, count, size, crc = HEADER.unpack_from(bundle)
+  if magic != MAGIC or version != VERSION:
+    raise ValueError("not a version %d bundle" % VERSION)
+  if size > len(bundle) or zlib.crc32(bundle[HEADER.size:size]) != crc:
+    raise ValueError("size or CRC mismatch")
+  files = {}
+  last = b''
+  for i in range(count):
+    pathOffset, pathLength, flags, _, dataOffset, dataSize, tag = ENTRY.unpack_from(bundle, HEADER.size + i * ENTRY.size)
+    path = bytes(bundle[pathOffset:pathOffset + pathLength])
+    if bundle[pathOffset + pathLength] != 0 or path <= last:
+      raise ValueError("path %r is not terminated or not sorted" % path)
+    if dataOffset + dataSize > size:
+      raise ValueError("data of %r out of bounds" % path)
+    content = bytes(bundle[dataOffset:dataOffset + dataSize])
+    if tag.rstrip(b'\0').decode() != etag(content):
+      raise ValueError("ETag of %r does not match" % path)
+    files[path.decode()] = (content, bool(flags & FLAG_GZIP))
+    last = path
+  return files, size
+
+def partition(label, table=PARTITIONS):
+  units = {'K': 1024, 'M': 1024 * 1024}
+  with open(table) as f:
+    for line in f:
+      fields = [field.strip() for field in line.split('#')[0].split(',')]
+      if len(fields) >= 5 and fields[0] == label:
+        size = fields[4]
+        size = int(size[:-1], 0) * units[size[-1].upper()] if size[-1].upper() in units else int(size, 0)
+        return int(fields[3], 0), size
+  raise ValueError("no partition %s in %s" % (label, table))
+
+def main():
+  parser = argparse.ArgumentParser()
+  commands = parser.add_subparsers(dest='command', required=True)
+  cmd = commands.add_parser('build', help="Pack a folder into a bundle")
+  cmd.add_argument('source', metavar='<folder>')
+  cmd.add_argument('output', metavar='<bundle>')
+  cmd.add_argument('-p', '--partition', help="Fail if the bundle exceeds this partition",
+                   action='store', metavar='<label>', default='assets')
+  cmd = commands.add_parser('verify', help="Check the structure, CRC and ETags of a bundle")
+  cmd.add_argument('bundle', metavar='<bundle>')
+  cmd.add_argument('-s', '--source', help="Also compare the content with this folder",
+                   action='store', metavar='<folder>')
+  cmd = commands.add_parser('partition', help="Print offset and size of a partition")
+  cmd.add_argument('label', metavar='<label>')
+  args = parser.parse_args()
+
+  if args.command == 'build':
+    bundle = build(args.source)
+    offset, size = partition(args.partition)
+    if len(bundle) > size:
+      sys.exit("[ERROR] Bundle of %d bytes exceeds the %s partition of %d bytes" % (len(bundle), args.partition, size))
+    with open(args.output, 'wb') as f:
+      f.write(bundle)
+    count = HEADER.unpack_from(bundle)[2]
+    print("Bundle with %d files, %d of %d bytes (%.0f%%) of the %s partition at 0x%x"
+          % (count, len(bundle), size, len(bundle) * 100 / size, args.partition, offset))
+
+  elif args.command == 'verify':
+    with open(args.bundle, 'rb') as f:
+      bundle = f.read()
+    try:
+      files, size = parse(bundle)
+      if args.source:
+        expected = collect(args.source)
+        for path in sorted(set(files) | set(expected)):
+          if path not in files or path not in expected:
+            raise ValueError("%s only in the %s" % (path, 'folder' if path in expected else 'bundle'))
+          content, gz = files[path]
+          original, originalGz = expected[path]
+          if (gzip.decompress(content) if gz else content) != (gzip.decompress(original) if originalGz else original):
+            raise ValueError("content of %s differs" % path)
+    except (ValueError, struct.error) as error:
+      sys.exit("[ERROR] %s: %s" % (args.bundle, error))
+    print("%s: %d files, %d bytes, OK" % (args.bundle, len(files), size))
+
+  elif args.command == 'partition':
+    offset, size = partition(args.label)
+    print("0x%x 0x%x" % (offset, size))
+
+if __name__ == '__main__':
+  main()
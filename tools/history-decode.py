@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+
+# Decode the binary history log as CSV. Accepts the segment files from the
+# /history folder of the LittleFS partition or a download of /api/history/log.
+# The record layout must match historyrecord_t in src/historylog.h.
+
+import argparse
+import csv
+import struct
+import sys
+
+RECORD = struct.Struct('<IhhhBBHBB')
+NO_TEMPERATURE = -32768
+NO_HUMIDITY = 0xFF
+FLAGS = ['dplus', 'mixer', 'dehumidification', 'stalled']
+
+def crc8(data):
+  crc = 0
+  for byte in data:
+    crc ^= byte
+    for _ in range(8):
+      crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+  return crc
+
+def temperature(value):
+  return '' if value == NO_TEMPERATURE else '%.2f' % (value / 100)
+
+parser = argparse.ArgumentParser()
+parser.add_argument('files', help="Segment files or /api/history/log downloads, in time order",
+                    nargs='+', metavar='<file>')
+parser.add_argument('-o', '--outfile', help="Write the CSV to this file instead of stdout",
+                    action='store', metavar='<filename>')
+parser.add_argument('-s', '--strict', help="Abort on records with a bad checksum instead of skipping them",
+                    action='store_true')
+args = vars(parser.parse_args())
+
+out = open(args['outfile'], 'w', newline='') if args['outfile'] else sys.stdout
+writer = csv.writer(out)
+writer.writerow(['time', 'temperature', 'temperatureMin', 'temperatureMax', 'humidity', 'pwm', 'rpm'] + FLAGS)
+
+bad = 0
+for filename in args['files']:
+  with open(filename, 'rb') as f:
+    data = f.read()
+  if len(data) % RECORD.size:
+    print("[WARN] %s has a torn record at the end, ignoring %d bytes" % (filename, len(data) % RECORD.size), file=sys.stderr)
+
+  for offset in range(0, len(data) - RECORD.size + 1, RECORD.size):
+    raw = data[offset:offset + RECORD.size]
+    time, temp, tempMin, tempMax, humidity, pwm, rpm, flags, crc = RECORD.unpack(raw)
+    if crc8(raw[:-1]) != crc:
+      bad += 1
+      if args['strict']:
+        sys.exit("[ERROR] Bad checksum in %s at offset %d" % (filename, offset))
+      continue
+    writer.writerow([
+      time, temperature(temp), temperature(tempMin), temperature(tempMax),
+      '' if humidity == NO_HUMIDITY else '%.1f' % (humidity / 2), pwm, rpm
+    ] + [1 if flags & (1 << i) else 0 for i in range(len(FLAGS))])
+
+if bad:
+  print("[WARN] Skipped %d records with a bad checksum" % bad, file=sys.stderr)
@@ -16,7 +16,10 @@
 # else than an ESP32 microcontroller.
 # ===============================================================
 
+import gzip
+import hashlib
 import os
+import shutil
 import stat
 import sys
 from sys import platform, path
@@ -58,3 +61,112 @@ elif platform == "win32":
     print("[WARN] No automatic UI build for this platform", file=sys.stderr)
 
 env.Replace(MKFSTOOL=file)
+
+# Pack the UI into the "assets" partition, served from mapped flash
+# ===============================================================
+# The bundle is built with tools/assetbundle.py into
+# $BUILD_DIR/assets.bin by buildfs and by
+# "platformio run -t uploadassets", which also writes it to the
+# partition offset from partitions.csv.
+# ===============================================================
+UI_DIR = os.path.join(env.get("PROJECT_DIR"), "ui", "build")
+
+def build_bundle(env):
+  sys.path.insert(0, os.path.join(env.get("PROJECT_DIR"), "tools"))
+  import assetbundle
+
+  bundle = assetbundle.build(UI_DIR)
+  offset, size = assetbundle.partition("assets", os.path.join(env.get("PROJECT_DIR"), "partitions.csv"))
+  file = os.path.join(env.subst("$BUILD_DIR"), "assets.bin")
+  if len(bundle) > size:
+    if os.path.exists(file):
+      os.remove(file)
+    print("[WARN] Bundle of %d bytes exceeds the assets partition of %d bytes" % (len(bundle), size), file=sys.stderr)
+    return None, offset
+  with open(file, 'wb') as f:
+    f.write(bundle)
+  print("Asset bundle of %d bytes for the partition at 0x%x" % (len(bundle), offset))
+  return file, offset
+
+def upload_assets(source, target, env):
+  file, offset = build_bundle(env)
+  if file is None:
+    sys.exit("[ERROR] The UI does not fit into the assets partition, use uploadfs instead")
+
+  env.AutodetectUploadPort()
+  env.Execute(env.VerboseAction(
+    '"$PYTHONEXE" "$UPLOADER" --chip esp32 --port "$UPLOAD_PORT" --baud $UPLOAD_SPEED write_flash 0x%x "%s"' % (offset, file),
+    "Uploading the asset bundle"))
+
+env.AddCustomTarget(name="uploadassets", dependencies=None, actions=upload_assets,
+                    title="Upload Asset Bundle", description="Pack the UI into the assets partition")
+
+# Stage the LittleFS image
+# ===============================================================
+# The image is built from data_dir (see platformio.ini), the UI
+# build itself is never modified. When the UI fits into assets.bin
+# the image holds no UI, the firmware serves it from the bundle and
+# LittleFS only keeps the data of the firmware (e.g. the history).
+# Otherwise the staged UI is precompressed: compressible files are
+# replaced by a gzip variant ("file.gz") if that saves at least 10%.
+# Brotli is not used as browsers only accept it over HTTPS. The
+# manifest "/assets.manifest" has one line per served file, sorted
+# by path: "<etag> <gz 0|1> <path>". The ETag is a hash of the
+# stored bytes, see src/assets.cpp.
+# ===============================================================
+COMPRESSIBLE = ('.html', '.js', '.css', '.json', '.svg', '.txt', '.map', '.ico', '.xml', '.webmanifest')
+MANIFEST = 'assets.manifest'
+
+if os.path.realpath(env.subst("$PROJECT_DATA_DIR")) == os.path.realpath(UI_DIR):
+  sys.exit("[ERROR] data_dir must be a staging directory, not the UI build")
+os.makedirs(env.subst("$PROJECT_DATA_DIR"), exist_ok=True)
+
+def stage_littlefs(source, target, env):
+  data_dir = env.subst("$PROJECT_DATA_DIR")
+  if not os.path.isdir(UI_DIR):
+    sys.exit("[ERROR] No UI build in %s, run 'npm run build' in ui/" % UI_DIR)
+  shutil.rmtree(data_dir)
+
+  bundle, offset = build_bundle(env)
+  if bundle is not None:
+    os.makedirs(data_dir)
+    print("The UI ships in assets.bin, the LittleFS image is built without it")
+    return
+
+  print("[WARN] Packing the UI into the LittleFS image instead", file=sys.stderr)
+  shutil.copytree(UI_DIR, data_dir)
+
+  entries = []
+  saved = 0
+  for root, dirs, files in os.walk(data_dir):
+    for name in files:
+      file = os.path.join(root, name)
+      rel = '/' + os.path.relpath(file, data_dir).replace(os.sep, '/')
+      if rel == '/' + MANIFEST:
+        continue
+
+      gz = rel.endswith('.gz')
+      if not gz and name.endswith(COMPRESSIBLE):
+        with open(file, 'rb') as f:
+          raw = f.read()
+        # mtime=0 keeps the output and the ETag stable between builds
+        packed = gzip.compress(raw, compresslevel=9, mtime=0)
+        if len(packed) < len(raw) * 0.9:
+          with open(file + '.gz', 'wb') as f:
+            f.write(packed)
+          os.remove(file)
+          saved += len(raw) - len(packed)
+          file, gz = file + '.gz', True
+      if gz:
+        rel = rel[:-3]
+
+      with open(file, 'rb') as f:
+        etag = hashlib.sha256(f.read()).hexdigest()[:16]
+      entries.append((rel, etag, gz))
+
+  with open(os.path.join(data_dir, MANIFEST), 'w') as f:
+    for rel, etag, gz in sorted(entries):
+      f.write("%s %d %s\n" % (etag, 1 if gz else 0, rel))
+  print("Precompressed the UI, saved %d bytes, %d files in the manifest" % (saved, len(entries)))
+
+env.AddPreAction("$BUILD_DIR/${ESP32_FS_IMAGE_NAME}.bin", stage_littlefs)
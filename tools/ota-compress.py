@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+
+# Compress an OTA image or build a delta against the running firmware. The
+# device detects the format by the first bytes, the layout must match
+# src/otadecoder.h. Both are uploaded like a plain image with ota-upload.py,
+# keep "littlefs" in the name of a compressed filesystem image.
+#
+#   tools/ota-compress.py gzip .pio/build/wemos_d1_mini32/firmware.bin firmware.bin.gz
+#   tools/ota-compress.py delta old/firmware.bin new/firmware.bin firmware.delta
+#   tools/ota-compress.py verify firmware.delta new/firmware.bin --source old/firmware.bin
+#
+# A delta only applies to the exact firmware.bin the device is running, it
+# is checked against the SHA-256 in the header before anything is written.
+
+import argparse
+import gzip
+import hashlib
+import struct
+import sys
+
+MAGIC = b'OGOD'
+VERSION = 1
+HEADER = struct.Struct('<4sHHII32s32s')
+OP_ADD = 0x01
+OP_INSERT = 0x02
+KEY = 16          # Bytes of a match to look up
+STRIDE = 4        # Source offsets in the index, ESP32 code is mostly 4 byte aligned
+SLACK = 64        # Stop the approximate extension after this many bytes without gain
+
+def compress(data):
+  # mtime=0 keeps the output stable between builds
+  return gzip.compress(data, compresslevel=9, mtime=0)
+
+def index(source):
+  table = {}
+  for offset in range(0, len(source) - KEY + 1, STRIDE):
+    table.setdefault(source[offset:offset + KEY], offset)
+  return table
+
+def extend(source, target, s, t):
+  # Exact match first, then bsdiff style: keep going while more than half
+  # of the bytes match, the differences compress to almost nothing
+  length = KEY
+  limit = min(len(source) - s, len(target) - t)
+  while length + 32 <= limit and source[s + length:s + length + 32] == target[t + length:t + length + 32]:
+    length += 32
+  while length < limit and source[s + length] == target[t + length]:
+    length += 1
+  score = best = 0
+  i = length
+  while i < limit and i - length - best < SLACK:
+    score += 1 if source[s + i] == target[t + i] else -1
+    i += 1
+    if score > best:
+      best, end = score, i
+  return end if best else length
+
+def diff(source, target):
+  table = index(source)
+  ops = []
+  literal = pos = 0
+  while pos <= len(target) - KEY:
+    s = table.get(target[pos:pos + KEY])
+    if s is None:
+      pos += 1
+      continue
+    while pos > literal and s > 0 and source[s - 1] == target[pos - 1]:
+      pos, s = pos - 1, s - 1
+    length = extend(source, target, s, pos)
+    if pos > literal:
+      ops.append(struct.pack('<BI', OP_INSERT, pos - literal) + target[literal:pos])
+    delta = bytes((t - o) & 0xFF for t, o in zip(target[pos:pos + length], source[s:s + length]))
+    ops.append(struct.pack('<BII', OP_ADD, s, length) + delta)
+    pos = literal = pos + length
+  if literal < len(target):
+    ops.append(struct.pack('<BI', OP_INSERT, len(target) - literal) + target[literal:])
+  header = HEADER.pack(MAGIC, VERSION, 0, len(source), len(target),
+                       hashlib.sha256(source).digest(), hashlib.sha256(target).digest())
+  return header + b''.join(ops), len(ops)
+
+def decode(image, source=None):
+  # Reference of the firmware decoder, raises ValueError like it fails
+  if image[:2] == b'\x1f\x8b':
+    image = gzip.decompress(image)
+  if image[:4] != MAGIC:
+    return image
+  magic, version, flags, sourceSize, targetSize, sourceSha, targetSha = HEADER.unpack_from(image)
+  if version != VERSION:
+    raise ValueError("unsupported delta version %d" % version)
+  if source is None:
+    raise ValueError("a delta needs --source")
+  source = source[:sourceSize]
+  if hashlib.sha256(source).digest() != sourceSha:
+    raise ValueError("delta does not match the source")
+  target = bytearray()
+  pos = HEADER.size
+  while pos < len(image):
+    op = image[pos]
+    if op == OP_ADD:
+      offset, length = struct.unpack_from('<II', image, pos + 1)
+      pos += 9
+      if offset + length > sourceSize:
+        raise ValueError("delta reads beyond the source")
+      target += bytes((o + d) & 0xFF for o, d in zip(source[offset:offset + length], image[pos:pos + length]))
+    elif op == OP_INSERT:
+      length, = struct.unpack_from('<I', image, pos + 1)
+      pos += 5
+      target += image[pos:pos + length]
+    else:
+      raise ValueError("invalid operation 0x%02x at %d" % (op, pos))
+    pos += length
+    if len(target) > targetSize:
+      raise ValueError("delta exceeds the target size")
+  if len(target) != targetSize or hashlib.sha256(target).digest() != targetSha:
+    raise ValueError("delta result does not match the target")
+  return bytes(target)
+
+def read(file):
+  with open(file, 'rb') as f:
+    return f.read()
+
+def main():
+  parser = argparse.ArgumentParser()
+  commands = parser.add_subparsers(dest='command', required=True)
+  cmd = commands.add_parser('gzip', help="Compress an image")
+  cmd.add_argument('image', metavar='<image>')
+  cmd.add_argument('output', metavar='<output>')
+  cmd = commands.add_parser('delta', help="Build a delta from the running to the new firmware")
+  cmd.add_argument('source', metavar='<running firmware.bin>')
+  cmd.add_argument('target', metavar='<new firmware.bin>')
+  cmd.add_argument('output', metavar='<output>')
+  cmd.add_argument('-r', '--raw', help="Do not compress the delta", action='store_true')
+  cmd = commands.add_parser('verify', help="Decode a compressed image or delta and compare it")
+  cmd.add_argument('image', metavar='<image>')
+  cmd.add_argument('target', metavar='<expected firmware.bin>')
+  cmd.add_argument('-s', '--source', help="Running firmware of a delta", action='store', metavar='<firmware.bin>')
+  args = parser.parse_args()
+
+  if args.command == 'gzip':
+    image = read(args.image)
+    output = compress(image)
+    print("%d of %d bytes (%.0f%%)" % (len(output), len(image), len(output) * 100 / len(image)))
+
+  elif args.command == 'delta':
+    source, target = read(args.source), read(args.target)
+    output, count = diff(source, target)
+    if not args.raw:
+      output = compress(output)
+    print("%d operations, %d of %d bytes (%.1f%%)" % (count, len(output), len(target), len(output) * 100 / len(target)))
+
+  elif args.command == 'verify':
+    try:
+      decoded = decode(read(args.image), read(args.source) if args.source else None)
+      if decoded != read(args.target):
+        raise ValueError("result differs from %s" % args.target)
+    except (ValueError, OSError, EOFError, struct.error) as error:
+      sys.exit("[ERROR] %s: %s" % (args.image, error))
+    print("%s: %d bytes, OK" % (args.image, len(decoded)))
+    return
+
+  with open(args.output, 'wb') as f:
+    f.write(output)
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+
+# Serve a folder with firmware images and the manifest for the pull update of
+# the devices, with HTTP range requests so interrupted downloads resume.
+# Prints the throughput and the resumes of each device.
+#
+#   tools/webinstaller-manifest-generator.py -p ogo -n ogo -f partitions.csv -s http://<ip>:8000 -b ota -d .pio/build/wemos_d1_mini32 -o ota/ogo/manifest.json
+#   cp .pio/build/wemos_d1_mini32/firmware.bin ota/ogo/
+#   tools/ota-serve.py . --port 8000
+#
+# Then set http://<ip>:8000/ota/ogo/manifest.json as update URL of the devices.
+# --drop <bytes> closes every download after that many bytes to test the resume.
+
+import argparse
+import functools
+import http.server
+import os
+import re
+import sys
+import threading
+import time
+
+class Stats:
+  def __init__(self):
+    self.lock = threading.Lock()
+    self.clients = {}
+
+  def add(self, client, path, start, sent, seconds, complete):
+    with self.lock:
+      entry = self.clients.setdefault((client, path), { 'requests': 0, 'resumes': 0, 'bytes': 0, 'seconds': 0.0 })
+      entry['requests'] += 1
+      entry['resumes'] += 1 if start else 0
+      entry['bytes'] += sent
+      entry['seconds'] += seconds
+      kbps = entry['bytes'] / 1024 / entry['seconds'] if entry['seconds'] else 0
+      print("[%s] %s %s at %d: %d bytes in %.1f s, total %d bytes at %.0f KiB/s, %d resumes"
+            % (client, path, 'complete' if complete else 'interrupted', start, sent, seconds,
+               entry['bytes'], kbps, entry['resumes']), flush=True)
+
+class Handler(http.server.SimpleHTTPRequestHandler):
+  def __init__(self, *args, stats=None, drop=0, rate=0, **kwargs):
+    self.stats, self.drop, self.rate = stats, drop, rate
+    super().__init__(*args, **kwargs)
+
+  def do_GET(self):
+    path = self.translate_path(self.path)
+    if not os.path.isfile(path) or path.endswith('.json'):
+      return super().do_GET()
+
+    size = os.path.getsize(path)
+    start, end = 0, size - 1
+    match = re.fullmatch(r'bytes=(\d*)-(\d*)', self.headers.get('Range', ''))
+    if match and (match.group(1) or match.group(2)):
+      if match.group(1):
+        start = int(match.group(1))
+        end = min(int(match.group(2)), size - 1) if match.group(2) else size - 1
+      else:
+        start = max(size - int(match.group(2)), 0)
+      if start > end:
+        self.send_response(416)
+        self.send_header('Content-Range', 'bytes */%d' % size)
+        self.end_headers()
+        return
+      self.send_response(206)
+      self.send_header('Content-Range', 'bytes %d-%d/%d' % (start, end, size))
+    else:
+      self.send_response(200)
+    self.send_header('Content-Type', 'application/octet-stream')
+    self.send_header('Content-Length', str(end - start + 1))
+    self.send_header('Accept-Ranges', 'bytes')
+    self.end_headers()
+
+    sent, began = 0, time.monotonic()
+    remaining = end - start + 1
+    if self.drop:
+      remaining = min(remaining, self.drop)
+    try:
+      with open(path, 'rb') as f:
+        f.seek(start)
+        while remaining:
+          chunk = f.read(min(remaining, 16 * 1024))
+          if not chunk:
+            break
+          self.wfile.write(chunk)
+          sent += len(chunk)
+          remaining -= len(chunk)
+          if self.rate:
+            time.sleep(len(chunk) / 1024 / self.rate)
+    except (BrokenPipeError, ConnectionResetError):
+      pass
+    complete = start + sent == end + 1
+    self.stats.add(self.client_address[0], self.path, start, sent, time.monotonic() - began, complete)
+    if not complete:
+      self.close_connection = True
+
+  def log_message(self, format, *args):
+    sys.stderr.write("[%s] %s\n" % (self.client_address[0], format % args))
+
+def main():
+  parser = argparse.ArgumentParser()
+  parser.add_argument('folder', help="Served folder", metavar='<folder>', nargs='?', default='.')
+  parser.add_argument('-P', '--port', help="HTTP port", action='store', type=int, default=8000)
+  parser.add_argument('-d', '--drop', help="Close each download after this many bytes",
+                      action='store', type=int, metavar='<bytes>', default=0)
+  parser.add_argument('-r', '--rate', help="Limit each download to this many KiB/s",
+                      action='store', type=int, metavar='<KiB/s>', default=0)
+  args = parser.parse_args()
+
+  handler = functools.partial(Handler, directory=args.folder, stats=Stats(), drop=args.drop, rate=args.rate)
+  server = http.server.ThreadingHTTPServer(('', args.port), handler)
+  print("Serving %s on port %d" % (os.path.abspath(args.folder), args.port), flush=True)
+  try:
+    server.serve_forever()
+  except KeyboardInterrupt:
+    pass
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+
+# Upload a firmware, asset bundle or LittleFS image to /api/update/upload and measure the
+# throughput. The SHA-256 of the file is sent along, so the device rejects
+# an image that was corrupted on the way.
+#
+#   tools/ota-upload.py -H ogo-toilet.local -p <otapassword> .pio/build/wemos_d1_mini32/firmware.bin
+
+import argparse
+import base64
+import hashlib
+import http.client
+import json
+import os
+import sys
+import time
+import uuid
+
+CHUNK = 16 * 1024
+
+parser = argparse.ArgumentParser()
+parser.add_argument('file', help="firmware.bin, assets.bin or littlefs.bin, the name selects the partition", metavar='<file>')
+parser.add_argument('-H', '--host', help="Hostname or IP of the device", action='store', metavar='<host>', required=True)
+parser.add_argument('-P', '--port', help="HTTP port", action='store', type=int, default=80)
+parser.add_argument('-p', '--password', help="OTA password", action='store', metavar='<password>', default='')
+parser.add_argument('-n', '--no-verify', help="Do not send the SHA-256 of the file", action='store_true')
+args = parser.parse_args()
+
+with open(args.file, 'rb') as f:
+  image = f.read()
+digest = hashlib.sha256(image).hexdigest()
+
+boundary = uuid.uuid4().hex
+head = ('--%s\r\nContent-Disposition: form-data; name="file"; filename="%s"\r\n'
+        'Content-Type: application/octet-stream\r\n\r\n' % (boundary, os.path.basename(args.file))).encode()
+tail = ('\r\n--%s--\r\n' % boundary).encode()
+
+headers = {
+  'Content-Type': 'multipart/form-data; boundary=%s' % boundary,
+  'Content-Length': str(len(head) + len(image) + len(tail)),
+}
+if args.password:
+  headers['Authorization'] = 'Basic ' + base64.b64encode(('ota:' + args.password).encode()).decode()
+if not args.no_verify:
+  headers['X-Update-SHA256'] = digest
+
+connection = http.client.HTTPConnection(args.host, args.port, timeout=60)
+start = time.monotonic()
+connection.putrequest('POST', '/api/update/upload')
+for key, value in headers.items():
+  connection.putheader(key, value)
+connection.endheaders()
+connection.send(head)
+for offset in range(0, len(image), CHUNK):
+  connection.send(image[offset:offset + CHUNK])
+connection.send(tail)
+response = connection.getresponse()
+body = response.read().decode(errors='replace')
+duration = time.monotonic() - start
+
+print("%s: %d bytes in %.2f s, %.1f KiB/s, SHA-256 %s" % (args.file, len(image), duration, len(image) / 1024 / duration, digest))
+print("HTTP %d %s" % (response.status, body))
+try:
+  result = json.loads(body)
+  if 'sha256' in result and result['sha256'] != digest:
+    sys.exit("[ERROR] The device computed a different SHA-256")
+except ValueError:
+  pass
+sys.exit(0 if response.status == 200 else 1)
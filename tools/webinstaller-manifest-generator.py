@@ -1,6 +1,7 @@
 #!/usr/bin/env python3
 
 import argparse
+import hashlib
 import json
 import csv
 import os
@@ -31,11 +32,15 @@ parser.add_argument('-f', '--file', help="Partition layout csv file",
                     action='store', metavar='partitions.csv', required=True)
 parser.add_argument('-o', '--outfile', help="Filename of the output manifest file",
                     action='store', metavar='<filename>', default="manifest.json")
+parser.add_argument('-d', '--dir', help="Folder with the built files, adds their size and SHA-256 for the pull update of the firmware",
+                    action='store', metavar='<folder>')
 parser.add_argument('-t', '--type', help="Manifest including all partitions (full) or just firmware/littlefs (update)",
                     action='store', metavar='<full|update>', default='update')
 args = vars(parser.parse_args())
 
 prefix = '%s/%s/%s/' % (args['url'], args['bucket'], args['project'])
+# Only built if the UI fits into the partition, littlefs.bin contains the UI otherwise
+assetsBuilt = not args['dir'] or os.path.isfile(os.path.join(args['dir'], 'assets.bin'))
 
 data = [
     { "path": prefix + "bootloader_dio_80m.bin", "offset": 4096 },
@@ -49,12 +54,25 @@ with open(args['file']) as csvfile:
         row['OffsetDec'] = int(row['Offset'], base=16)
         if row['SubType'].startswith('ota_'):
             row['file'] = prefix + 'firmware.bin'
-        if row['SubType'].startswith('spiffs'):
+        # An update keeps LittleFS and the history on it, unless the UI is stored there
+        if row['SubType'].startswith('spiffs') and (args['type'] == 'full' or not assetsBuilt):
             row['file'] = prefix + 'littlefs.bin'
+        if row['# Name'] == 'assets' and assetsBuilt:
+            row['file'] = prefix + 'assets.bin'
         
         if 'file' in row:
             data.append({ "path": row['file'], "offset": row['OffsetDec'] })
 
+# The firmware checks the download against them, see src/otapull.cpp
+if args['dir']:
+    for part in data:
+        file = os.path.join(args['dir'], os.path.basename(part['path']))
+        if os.path.isfile(file):
+            with open(file, 'rb') as f:
+                content = f.read()
+            part['size'] = len(content)
+            part['sha256'] = hashlib.sha256(content).hexdigest()
+
 with open(os.path.dirname(__file__) + '/webinstaller-manifest-template.json') as user_file:
   manifest = json.load(user_file)
   manifest['name'] = args['name']
@@ -19,7 +19,21 @@ export function GET() {
 		overrideSpeedPoti: false,
 		overrideSpeed: 50,
 		humidityThr: 75,
-		humiditySpeed: 80
+		humiditySpeed: 80,
+		statusDelta: false,
+		tachoPulsesPerRev: 2,
+		closedLoop: false,
+		maxFanRpm: 3000,
+		pidKp: 0.5,
+		pidKi: 0.5,
+		pidKd: 0,
+		powerMode: 0,
+		sensorAggregate: 0,
+		perfEnabled: true,
+		perfMqtt: false,
+		updateUrl: 'http://192.168.255.1:8000/manifest.json',
+		updateInterval: 360,
+		autoUpdate: false
 	};
 	return new Response(JSON.stringify(responseBody), { status: 200 });
 }
@@ -0,0 +1,22 @@
+/** @type {import('./$types').RequestHandler} */
+export function GET() {
+	let responseBody = {
+		state: 3,
+		version: 'v2.1-1-g76566b3',
+		available: 'v2.2-0-g1a2b3c4',
+		checks: 4,
+		downloads: 0,
+		resumes: 0,
+		bytes: 0,
+		size: 1048576,
+		durationMs: 0,
+		kbps: 0
+	};
+	return new Response(JSON.stringify(responseBody), { status: 200 });
+}
+
+/** @type {import('./$types').RequestHandler} */
+export function POST() {
+	let responseBody = { message: 'Checking for updates' };
+	return new Response(JSON.stringify(responseBody), { status: 202 });
+}